@@ -34,6 +34,7 @@
 #include "../Battlescape/Pathfinding.h"
 #include "../Engine/RNG.h"
 #include "../Engine/Logger.h"
+#include "../Engine/ThreadPool.h"
 #include "../Engine/Game.h"
 #include "../Ruleset/Armor.h"
 #include "../Resource/ResourcePack.h"
@@ -43,6 +44,135 @@
 namespace OpenXcom
 {
 
+/**
+ * Checks which candidate fire points have a line of fire to the target.
+ */
+class FirePointJob : public ThreadJob
+{
+private:
+	SavedBattleGame *_save;
+	BattleUnit *_unit, *_target;
+	const std::vector<Position> &_candidates;
+	std::vector<char> &_lineOfFire;
+public:
+	FirePointJob(SavedBattleGame *save, BattleUnit *unit, BattleUnit *target, const std::vector<Position> &candidates, std::vector<char> &lineOfFire) :
+		_save(save), _unit(unit), _target(target), _candidates(candidates), _lineOfFire(lineOfFire)
+	{
+	}
+	void run(int index)
+	{
+		const Position &pos = _candidates[index];
+		Tile *tile = _save->getTile(pos);
+		// i should really make a function for this
+		Position origin = (pos * Position(16,16,24)) +
+			// 4 because -2 is eyes and 2 below that is the rifle (or at least that's my understanding)
+			Position(8,8, _unit->getHeight() + _unit->getFloatHeight() - tile->getTerrainLevel() - 4);
+		Position target;
+		_lineOfFire[index] = _save->getTileEngine()->canTargetUnit(&origin, _target->getTile(), &target, _unit);
+	}
+};
+
+/**
+ * Counts how many enemies could spot the unit at each of a few positions.
+ */
+class SpottingJob : public ThreadJob
+{
+private:
+	AlienBAIState *_ai;
+	const std::vector<Position> &_positions;
+	std::vector<int> &_spotting;
+public:
+	SpottingJob(AlienBAIState *ai, const std::vector<Position> &positions, std::vector<int> &spotting) :
+		_ai(ai), _positions(positions), _spotting(spotting)
+	{
+	}
+	void run(int index)
+	{
+		_spotting[index] = _ai->getSpottingUnits(_positions[index]);
+	}
+};
+
+/**
+ * Checks which candidate ambush points are out of sight of the target
+ * and of every other enemy.
+ */
+class AmbushJob : public ThreadJob
+{
+private:
+	AlienBAIState *_ai;
+	SavedBattleGame *_save;
+	BattleUnit *_unit, *_target;
+	Position _origin;
+	const std::vector<Position> &_candidates;
+	std::vector<char> &_hidden;
+public:
+	AmbushJob(AlienBAIState *ai, SavedBattleGame *save, BattleUnit *unit, BattleUnit *target, const Position &origin, const std::vector<Position> &candidates, std::vector<char> &hidden) :
+		_ai(ai), _save(save), _unit(unit), _target(target), _origin(origin), _candidates(candidates), _hidden(hidden)
+	{
+	}
+	void run(int index)
+	{
+		Position origin = _origin;
+		Position target;
+		const Position &pos = _candidates[index];
+		_hidden[index] = !_save->getTileEngine()->canTargetUnit(&origin, _save->getTile(pos), &target, _target, _unit) && !_ai->getSpottingUnits(pos);
+	}
+};
+
+/**
+ * Scores the nodes a unit could aim an explosive at.
+ */
+class EfficacyJob : public ThreadJob
+{
+private:
+	SavedBattleGame *_save;
+	BattleUnit *_unit;
+	const AlienBAIState *_ai;
+	int _radius;
+	std::vector<int> &_points;
+public:
+	EfficacyJob(const AlienBAIState *ai, SavedBattleGame *save, BattleUnit *unit, int radius, std::vector<int> &points) :
+		_save(save), _unit(unit), _ai(ai), _radius(radius), _points(points)
+	{
+	}
+	void run(int index)
+	{
+		Node *node = _save->getNodes()->at(index);
+		Position originVoxel = _save->getTileEngine()->getSightOriginVoxel(_unit);
+		Position targetVoxel;
+		int dist = _save->getTileEngine()->distance(node->getPosition(), _unit->getPosition());
+		_points[index] = INT_MIN;
+		if (dist <= 20 && dist > _radius &&
+			_save->getTileEngine()->canTargetTile(&originVoxel, _save->getTile(node->getPosition()), MapData::O_FLOOR, &targetVoxel, _unit))
+		{
+			int nodePoints = 0;
+			for (std::vector<BattleUnit*>::const_iterator j = _save->getUnits()->begin(); j != _save->getUnits()->end(); ++j)
+			{
+				dist = _save->getTileEngine()->distance(node->getPosition(), (*j)->getPosition());
+				if (!(*j)->isOut() && dist < _radius)
+				{
+					Position targetOriginVoxel = _save->getTileEngine()->getSightOriginVoxel(*j);
+					if (_save->getTileEngine()->canTargetTile(&targetOriginVoxel, _save->getTile(node->getPosition()), MapData::O_FLOOR, &targetVoxel, *j))
+					{
+						if (_ai->isEnemy(*j))
+						{
+							if (_ai->isKnown(*j))
+							{
+								nodePoints++;
+							}
+						}
+						else if ((*j)->getFaction() == _unit->getFaction())
+						{
+							nodePoints -= 2;
+						}
+					}
+				}
+			}
+			_points[index] = nodePoints;
+		}
+	}
+};
+
 
 /**
  * Sets up a BattleAIState.
@@ -276,7 +406,7 @@ void AlienBAIState::think(BattleAction *action)
 	}
 	if (_spottingEnemies > 2
 		|| _unit->getHealth() < 2 * _unit->getBaseStats()->health / 3
-		|| (_aggroTarget && _aggroTarget->getTurnsSinceSpotted() > _intelligence))
+		|| (_aggroTarget && !isKnown(_aggroTarget)))
 	{
 		evaluate = true;
 	}
@@ -550,7 +680,7 @@ void AlienBAIState::setupPatrol()
 
 		if (_toNode != 0)
 		{
-			_save->getPathfinding()->calculate(_unit, _toNode->getPosition());
+			_save->getPathfinding()->calculateLongRange(_unit, _toNode->getPosition());
 			if (_save->getPathfinding()->getStartDirection() == -1)
 			{
 				_toNode = 0;
@@ -588,13 +718,13 @@ void AlienBAIState::setupAmbush()
 
 	if (selectClosestKnownEnemy())
 	{
-		Position target;
 		const int BASE_SYSTEMATIC_SUCCESS = 100;
 		const int COVER_BONUS = 25;
 		const int FAST_PASS_THRESHOLD = 80;
 		Position origin = _save->getTileEngine()->getSightOriginVoxel(_aggroTarget);
 
 		// we'll use node positions for this, as it gives map makers a good degree of control over how the units will use the environment.
+		std::vector<Position> candidates;
 		for (std::vector<Node*>::const_iterator i = _save->getNodes()->begin(); i != _save->getNodes()->end(); ++i)
 		{
 			Position pos = (*i)->getPosition();
@@ -609,9 +739,20 @@ void AlienBAIState::setupAmbush()
 				tile->setPreview(10);
 				tile->setMarkerColor(13);
 			}
+			candidates.push_back(pos);
+		}
+
+		// the sight checks only read the map, so do them all at once
+		std::vector<char> hidden(candidates.size());
+		_save->getTileEngine()->prepareLineTracing();
+		AmbushJob job(this, _save, _unit, _aggroTarget, origin, candidates, hidden);
+		ThreadPool::get()->run(&job, candidates.size());
 
+		for (size_t i = 0; i < candidates.size(); ++i)
+		{
+			Position pos = candidates[i];
 			// make sure we can't be seen here.
-			if (!_save->getTileEngine()->canTargetUnit(&origin, tile, &target, _aggroTarget, _unit) && !getSpottingUnits(pos))
+			if (hidden[i])
 			{
 				_save->getPathfinding()->calculate(_unit, pos);
 				int ambushTUs = _save->getPathfinding()->getTotalTUCost();
@@ -1424,11 +1565,11 @@ bool AlienBAIState::findFirePoint()
 		return false;
 	std::vector<Position> randomTileSearch = _save->getTileSearch();
 	RNG::shuffle(randomTileSearch);
-	Position target;
 	const int BASE_SYSTEMATIC_SUCCESS = 100;
 	const int FAST_PASS_THRESHOLD = 125;
 	int bestScore = 0;
 	_attackAction->type = BA_RETHINK;
+	std::vector<Position> candidates;
 	for (std::vector<Position>::const_iterator i = randomTileSearch.begin(); i != randomTileSearch.end(); ++i)
 	{
 		Position pos = _unit->getPosition() + *i;
@@ -1436,33 +1577,63 @@ bool AlienBAIState::findFirePoint()
 		if (tile == 0  ||
 			std::find(_reachableWithAttack.begin(), _reachableWithAttack.end(), _save->getTileIndex(pos))  == _reachableWithAttack.end())
 			continue;
-		int score = 0;
-		// i should really make a function for this
-		Position origin = (pos * Position(16,16,24)) + 
-			// 4 because -2 is eyes and 2 below that is the rifle (or at least that's my understanding)
-			Position(8,8, _unit->getHeight() + _unit->getFloatHeight() - tile->getTerrainLevel() - 4);
+		candidates.push_back(pos);
+	}
+
+	// the line of fire checks only read the map, so do them all at once
+	std::vector<char> lineOfFire(candidates.size());
+	_save->getTileEngine()->prepareLineTracing();
+	FirePointJob job(_save, _unit, _aggroTarget, candidates, lineOfFire);
+	ThreadPool::get()->run(&job, candidates.size());
 
-		if (_save->getTileEngine()->canTargetUnit(&origin, _aggroTarget->getTile(), &target, _unit))
+	// counting who could spot us is the expensive part, so it's only done for the
+	// points we can move to that could still beat the best score, a few at a time
+	const size_t batchSize = ThreadPool::get()->getThreadCount();
+	std::vector<Position> batch;
+	std::vector<int> batchScores, spotting;
+	size_t next = 0;
+	bool fastPass = false;
+	while (!fastPass && next < candidates.size())
+	{
+		batch.clear();
+		batchScores.clear();
+		for (; next < candidates.size() && batch.size() < batchSize; ++next)
 		{
+			if (!lineOfFire[next])
+				continue;
+			Position pos = candidates[next];
 			_save->getPathfinding()->calculate(_unit, pos);
 			// can move here
-			if (_save->getPathfinding()->getStartDirection() != -1)
+			if (_save->getPathfinding()->getStartDirection() == -1)
+				continue;
+			int score = BASE_SYSTEMATIC_SUCCESS + _unit->getTimeUnits() - _save->getPathfinding()->getTotalTUCost();
+			if (!_aggroTarget->checkViewSector(pos))
 			{
-				score = BASE_SYSTEMATIC_SUCCESS - getSpottingUnits(pos) * 10;
-				score += _unit->getTimeUnits() - _save->getPathfinding()->getTotalTUCost();
-				if (!_aggroTarget->checkViewSector(pos))
-				{
-					score += 10;
-				}
-				if (score > bestScore)
+				score += 10;
+			}
+			// being spotted only lowers the score
+			if (score <= bestScore)
+				continue;
+			batch.push_back(pos);
+			batchScores.push_back(score);
+		}
+
+		spotting.resize(batch.size());
+		SpottingJob spottingJob(this, batch, spotting);
+		ThreadPool::get()->run(&spottingJob, batch.size());
+
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			int score = batchScores[i] - spotting[i] * 10;
+			if (score > bestScore)
+			{
+				bestScore = score;
+				_attackAction->target = batch[i];
+				_attackAction->finalFacing = _save->getTileEngine()->getDirectionTo(batch[i], _aggroTarget->getPosition());
+				if (score > FAST_PASS_THRESHOLD)
 				{
-					bestScore = score;
-					_attackAction->target = pos;
-					_attackAction->finalFacing = _save->getTileEngine()->getDirectionTo(pos, _aggroTarget->getPosition());
-					if (score > FAST_PASS_THRESHOLD)
-					{
-						break;
-					}
+					fastPass = true;
+					break;
 				}
 			}
 		}
@@ -1553,7 +1724,7 @@ bool AlienBAIState::explosiveEfficacy(Position targetPos, BattleUnit *attackingU
 				// don't count people who were already grenaded this turn
 			if ((*i)->getTile()->getDangerous() ||
 				// don't count units we don't know about
-				((*i)->getFaction() == FACTION_PLAYER && (*i)->getTurnsSinceSpotted() > _intelligence))
+				(isEnemy(*i) && !isKnown(*i)))
 				continue;
 
 			// trace a line from the grenade origin to the unit we're checking against
@@ -1564,7 +1735,7 @@ bool AlienBAIState::explosiveEfficacy(Position targetPos, BattleUnit *attackingU
 
 			if (collidesWith == V_UNIT && traj.front() / Position(16,16,24) == (*i)->getPosition())
 			{
-				if ((*i)->getFaction() == FACTION_PLAYER)
+				if (isEnemy(*i) && (*i)->getFaction() != FACTION_NEUTRAL)
 				{
 					++enemiesAffected;
 					++efficacy;
@@ -1965,11 +2136,11 @@ bool AlienBAIState::validTarget(BattleUnit *unit, bool assessDanger, bool includ
 		// ignore units that are dead/unconscious
 	if (unit->isOut() ||
 		// they must be units that we "know" about
-		_intelligence < unit->getTurnsSinceSpotted() ||
+		!isKnown(unit) ||
 		// they haven't been grenaded
 		(assessDanger && unit->getTile()->getDangerous()) ||
 		// and they mustn't be on our side
-		unit->getFaction() == FACTION_HOSTILE)
+		!isEnemy(unit))
 	{
 		return false;
 	}
@@ -1979,7 +2150,39 @@ bool AlienBAIState::validTarget(BattleUnit *unit, bool assessDanger, bool includ
 		return true;
 	}
 
-	return unit->getFaction() == FACTION_PLAYER;
+	return unit->getFaction() != FACTION_NEUTRAL;
+}
+
+/**
+ * Checks if a unit is on the other side of the fight. Aliens fight
+ * X-COM and the civilians, while X-COM soldiers left to the AI
+ * (in the battle benchmark) only fight the aliens.
+ * @param unit The unit to check.
+ * @return True if it's an enemy.
+ */
+bool AlienBAIState::isEnemy(BattleUnit *unit) const
+{
+	if (_unit->getFaction() == FACTION_PLAYER)
+	{
+		return unit->getFaction() == FACTION_HOSTILE;
+	}
+	return unit->getFaction() != FACTION_HOSTILE;
+}
+
+/**
+ * Checks if our side knows where a unit is. Aliens remember the units
+ * they spotted for as many turns as their intelligence, while X-COM
+ * only knows about the aliens it can see right now.
+ * @param unit The unit to check.
+ * @return True if it's known.
+ */
+bool AlienBAIState::isKnown(BattleUnit *unit) const
+{
+	if (_unit->getFaction() == FACTION_PLAYER)
+	{
+		return unit->getVisible();
+	}
+	return unit->getTurnsSinceSpotted() <= _intelligence;
 }
 
 /**
@@ -2063,42 +2266,17 @@ bool AlienBAIState::getNodeOfBestEfficacy(BattleAction *action)
 		return false;
 
 	int bestScore = 2;
-	Position originVoxel = _save->getTileEngine()->getSightOriginVoxel(_unit);
-	Position targetVoxel;
-	for (std::vector<Node*>::const_iterator i = _save->getNodes()->begin(); i != _save->getNodes()->end(); ++i)
+	// score every node side by side, then pick the first best one as before
+	std::vector<int> points(_save->getNodes()->size());
+	_save->getTileEngine()->prepareLineTracing();
+	EfficacyJob job(this, _save, _unit, action->weapon->getRules()->getExplosionRadius(), points);
+	ThreadPool::get()->run(&job, points.size());
+	for (size_t i = 0; i < points.size(); ++i)
 	{
-		int dist = _save->getTileEngine()->distance((*i)->getPosition(), _unit->getPosition());
-		if (dist <= 20 && dist > action->weapon->getRules()->getExplosionRadius() &&
-			_save->getTileEngine()->canTargetTile(&originVoxel, _save->getTile((*i)->getPosition()), MapData::O_FLOOR, &targetVoxel, _unit))
+		if (points[i] > bestScore)
 		{
-			int nodePoints = 0;
-			for (std::vector<BattleUnit*>::const_iterator j = _save->getUnits()->begin(); j != _save->getUnits()->end(); ++j)
-			{
-				dist = _save->getTileEngine()->distance((*i)->getPosition(), (*j)->getPosition());
-				if (!(*j)->isOut() && dist < action->weapon->getRules()->getExplosionRadius())
-				{
-					Position targetOriginVoxel = _save->getTileEngine()->getSightOriginVoxel(*j);
-					if (_save->getTileEngine()->canTargetTile(&targetOriginVoxel, _save->getTile((*i)->getPosition()), MapData::O_FLOOR, &targetVoxel, *j))
-					{
-						if ((*j)->getFaction() != FACTION_HOSTILE)
-						{
-							if ((*j)->getTurnsSinceSpotted() <= _intelligence)
-							{
-								nodePoints++;
-							}
-						}
-						else
-						{
-							nodePoints -= 2;
-						}
-					}
-				}
-			}
-			if (nodePoints > bestScore)
-			{
-				bestScore = nodePoints;
-				action->target = (*i)->getPosition();
-			}
+			bestScore = points[i];
+			action->target = _save->getNodes()->at(i)->getPosition();
 		}
 	}
 	return bestScore > 2;
@@ -110,6 +110,10 @@ public:
 	void meleeAttack();
 	/// Checks to make sure a target is valid, given the parameters
 	bool validTarget(BattleUnit* unit, bool assessDanger, bool includeCivs) const;
+	/// Checks if a unit is on the other side.
+	bool isEnemy(BattleUnit *unit) const;
+	/// Checks if our side knows where a unit is.
+	bool isKnown(BattleUnit *unit) const;
 	/// Checks the alien's TU reservation setting.
 	BattleActionType getReserveMode();
 	/// Assuming we have both a ranged and a melee weapon, we have to select one.
@@ -0,0 +1,435 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <iostream>
+#include <sstream>
+#include "BattleBenchmark.h"
+#include "BattlescapeState.h"
+#include "Map.h"
+#include "UnitSpriteCache.h"
+#include "TileEngine.h"
+#include "Pathfinding.h"
+#include "AlienBAIState.h"
+#include "CivilianBAIState.h"
+#include "../Engine/Game.h"
+#include "../Engine/RNG.h"
+#include "../Engine/Logger.h"
+#include "../Engine/Exception.h"
+#include "../Engine/SpriteAtlas.h"
+#include "../Resource/XcomResourcePack.h"
+#include "../Ruleset/Armor.h"
+#include "../Ruleset/RuleItem.h"
+#include "../Savegame/SavedGame.h"
+#include "../Savegame/SavedBattleGame.h"
+#include "../Savegame/BattleItem.h"
+#include "../Savegame/Tile.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Sets up a benchmark.
+ * @param game Pointer to the core game.
+ */
+BattleBenchmark::BattleBenchmark(Game *game) : _game(game), _save(0), _lighting(0), _fov(0), _pathfinding(0), _ai(0), _reactions(0), _explosions(0), _steps(0), _attacks(0), _reactionAttacks(0)
+{
+}
+
+/**
+ * Deletes the benchmark.
+ */
+BattleBenchmark::~BattleBenchmark()
+{
+}
+
+/**
+ * Loads the game data and a saved battle, then plays it for
+ * a number of turns and reports how long each phase took.
+ * @param filename Name of the save file, in the user folder.
+ * @param turns Number of turns to play.
+ * @param seed Seed for the random number generator.
+ */
+void BattleBenchmark::run(const std::string &filename, int turns, int seed)
+{
+	_game->loadRulesets();
+	_game->setResourcePack(new XcomResourcePack(_game->getRuleset()));
+	_game->defaultLanguage();
+
+	SavedGame *save = new SavedGame();
+	_game->setSavedGame(save);
+	save->load(filename, _game->getRuleset());
+	_save = save->getSavedBattle();
+	if (_save == 0)
+	{
+		throw Exception(filename + " is not a battlescape save");
+	}
+	_save->loadMapResources(_game);
+	// the AI gets to the ruleset through the battle state, so one
+	// has to exist even though it's never shown
+	BattlescapeState *state = new BattlescapeState;
+	_game->pushState(state);
+	_save->setBattleState(state);
+
+	RNG::setSeed(seed);
+	Uint32 start = SDL_GetTicks();
+	for (int turn = 0; turn < turns; ++turn)
+	{
+		// every side plays in order until it's X-COM's turn again
+		do
+		{
+			playSide(_save->getSide());
+			_save->endTurn();
+		}
+		while (_save->getSide() != FACTION_PLAYER);
+	}
+	Uint32 total = SDL_GetTicks() - start;
+
+	std::ostringstream ss;
+	ss << "Battle benchmark: " << filename << ", " << _save->getMapSizeX() << "x" << _save->getMapSizeY() << "x" << _save->getMapSizeZ()
+		<< ", " << _save->getUnits()->size() << " units, " << turns << " turns, seed " << seed << std::endl;
+	ss << "  lighting:    " << _lighting << "ms" << std::endl;
+	ss << "  fov:         " << _fov << "ms" << std::endl;
+	ss << "  pathfinding: " << _pathfinding << "ms (" << _steps << " steps walked)" << std::endl;
+	ss << "  ai:          " << _ai << "ms" << std::endl;
+	ss << "  reactions:   " << _reactions << "ms (" << _reactionAttacks << " reaction attacks)" << std::endl;
+	ss << "  explosions:  " << _explosions << "ms (" << _attacks << " attacks)" << std::endl;
+	ss << "  total:       " << total << "ms" << std::endl;
+	ss << "  state hash:  " << std::hex << hashState() << std::dec << std::endl;
+	drawFrames(state->getMap(), ss);
+	std::cout << ss.str() << std::endl;
+	Log(LOG_INFO) << ss.str();
+}
+
+/**
+ * Draws the map a number of times on one thread, then across the
+ * thread pool, and checks both ways give the same picture. Everything
+ * is revealed first, so all the terrain and units are drawn.
+ * @param map The battlescape map.
+ * @param ss Stream to write the results to.
+ */
+void BattleBenchmark::drawFrames(Map *map, std::ostringstream &ss)
+{
+	const int frames = 50;
+	_save->setDebugMode();
+	map->cacheUnits();
+	Uint32 time[2], hash[2];
+	for (int threaded = 0; threaded < 2; ++threaded)
+	{
+		map->setThreadedDrawing(threaded != 0);
+		Uint32 start = SDL_GetTicks();
+		for (int i = 0; i < frames; ++i)
+		{
+			map->invalidate();
+			map->draw();
+		}
+		time[threaded] = SDL_GetTicks() - start;
+
+		hash[threaded] = 2166136261u;
+		SDL_Surface *surface = map->getSurface();
+		for (int y = 0; y < surface->h; ++y)
+		{
+			const Uint8 *row = (const Uint8*)surface->pixels + y * surface->pitch;
+			for (int x = 0; x < surface->w; ++x)
+			{
+				hash[threaded] ^= row[x];
+				hash[threaded] *= 16777619u;
+			}
+		}
+	}
+	ss << "  drawing:     " << time[0] << "ms on one thread, " << time[1] << "ms threaded (" << frames << " frames, "
+		<< (hash[0] == hash[1] ? "same picture" : "PICTURES DIFFER") << "), sprite atlases " << SpriteAtlas::getMemoryUsed() / 1024 << "KB, unit sprite cache "
+		<< map->getUnitSpriteCache()->getHits() << " hits, " << map->getUnitSpriteCache()->getMisses() << " misses";
+}
+
+/**
+ * Plays the turn of one side, one unit at a time like the battlescape does.
+ * The units of the side were already readied by the end of the last turn.
+ * @param side Faction whose turn it is.
+ */
+void BattleBenchmark::playSide(UnitFaction side)
+{
+	Uint32 start = SDL_GetTicks();
+	_save->getTileEngine()->calculateTerrainLighting();
+	_save->getTileEngine()->calculateUnitLighting();
+	_lighting += SDL_GetTicks() - start;
+	start = SDL_GetTicks();
+	_save->getTileEngine()->recalculateFOV();
+	_fov += SDL_GetTicks() - start;
+
+	// units can be killed along the way, but they stay in the list
+	for (size_t i = 0; i < _save->getUnits()->size(); ++i)
+	{
+		BattleUnit *unit = _save->getUnits()->at(i);
+		if (unit->getFaction() != side || unit->isOut() || !unit->getTile())
+			continue;
+		think(unit);
+	}
+}
+
+/**
+ * Lets the AI of a unit choose what to do, then does it: walking,
+ * or an attack with its damage worked out right away. Soldiers get
+ * the alien AI, the same as when they're mind controlled, so both
+ * sides fight.
+ * @param unit The unit.
+ */
+void BattleBenchmark::think(BattleUnit *unit)
+{
+	Uint32 start = SDL_GetTicks();
+	_save->getTileEngine()->calculateFOV(unit->getPosition());
+	_fov += SDL_GetTicks() - start;
+
+	if (!unit->getCurrentAIState())
+	{
+		if (unit->getFaction() != FACTION_NEUTRAL)
+			unit->setAIState(new AlienBAIState(_save, unit, 0));
+		else
+			unit->setAIState(new CivilianBAIState(_save, unit, 0));
+	}
+	start = SDL_GetTicks();
+	BattleAction action;
+	action.actor = unit;
+	action.number = 1;
+	unit->think(&action);
+	if (action.type == BA_RETHINK)
+	{
+		unit->think(&action);
+	}
+	_ai += SDL_GetTicks() - start;
+
+	if (action.type == BA_WALK && _save->getTile(action.target))
+	{
+		start = SDL_GetTicks();
+		_save->getPathfinding()->calculateLongRange(unit, action.target);
+		_pathfinding += SDL_GetTicks() - start;
+		walk(unit);
+	}
+	else if ((action.type == BA_SNAPSHOT || action.type == BA_AUTOSHOT || action.type == BA_AIMEDSHOT ||
+		action.type == BA_THROW || action.type == BA_LAUNCH || action.type == BA_HIT) && action.weapon)
+	{
+		if (attack(action))
+		{
+			reactionFire(unit);
+		}
+	}
+}
+
+/**
+ * Works out the damage of an attack where it lands, without
+ * flying a projectile there: explosives blow up at the target,
+ * everything else hits it directly.
+ * @param action The attack.
+ * @return True if the unit had the time units to attack.
+ */
+bool BattleBenchmark::attack(BattleAction &action)
+{
+	BattleItem *item = action.weapon;
+	if (action.type != BA_THROW && action.type != BA_HIT && item->getAmmoItem())
+	{
+		item = item->getAmmoItem();
+	}
+	if (!action.actor->spendTimeUnits(action.actor->getActionTUs(action.type, action.weapon)))
+		return false;
+	++_attacks;
+
+	Uint32 start = SDL_GetTicks();
+	Position center = action.target * Position(16,16,24) + Position(8,8,12);
+	RuleItem *rules = item->getRules();
+	if (rules->getExplosionRadius() > 0)
+	{
+		_save->getTileEngine()->explode(center, rules->getPower(), rules->getDamageType(), rules->getExplosionRadius(), action.actor);
+	}
+	else
+	{
+		_save->getTileEngine()->hit(center, rules->getPower(), rules->getDamageType(), action.actor);
+	}
+	removeCasualties();
+	_explosions += SDL_GetTicks() - start;
+	return true;
+}
+
+/**
+ * Lets the units that can see a unit react to what it did, like
+ * TileEngine::checkReactionFire() does, except the reaction
+ * attacks are worked out right away like any other attack.
+ * @param unit The unit that moved or attacked.
+ */
+void BattleBenchmark::reactionFire(BattleUnit *unit)
+{
+	TileEngine *tileEngine = _save->getTileEngine();
+	Uint32 start = SDL_GetTicks();
+	std::vector<std::pair<BattleUnit*, int> > spotters = tileEngine->getSpottingUnits(unit);
+	int attackType;
+	BattleUnit *reactor = tileEngine->getReactor(spotters, attackType, unit);
+	_reactions += SDL_GetTicks() - start;
+	while (reactor != unit && unit->getTile() != 0)
+	{
+		BattleAction action;
+		action.actor = reactor;
+		action.type = (BattleActionType)attackType;
+		action.target = unit->getPosition();
+		action.weapon = (attackType == BA_HIT) ? reactor->getMeleeWeapon() : reactor->getMainHandWeapon(reactor->getFaction() != FACTION_PLAYER);
+		bool reacted = false;
+		if (action.weapon && action.weapon->getAmmoItem() && action.weapon->getAmmoItem()->getAmmoQuantity() &&
+			reactor->getActionTUs(action.type, action.weapon) > 0)
+		{
+			// aliens don't blow themselves up to react
+			AlienBAIState *ai = dynamic_cast<AlienBAIState*>(reactor->getCurrentAIState());
+			int radius = action.weapon->getAmmoItem()->getRules()->getExplosionRadius();
+			if (reactor->getFaction() != FACTION_HOSTILE || ai == 0 || radius == 0 || ai->explosiveEfficacy(action.target, reactor, radius, -1))
+			{
+				reacted = attack(action);
+			}
+		}
+		start = SDL_GetTicks();
+		if (reacted)
+		{
+			++_reactionAttacks;
+		}
+		else
+		{
+			// this one can't react, but the others still might
+			for (std::vector<std::pair<BattleUnit*, int> >::iterator i = spotters.begin(); i != spotters.end(); ++i)
+			{
+				if (i->first == reactor)
+				{
+					spotters.erase(i);
+					break;
+				}
+			}
+		}
+		reactor = tileEngine->getReactor(spotters, attackType, unit);
+		_reactions += SDL_GetTicks() - start;
+	}
+}
+
+/**
+ * Walks a unit along the current path until it gets
+ * there or runs out of time units.
+ * @param unit The unit.
+ */
+void BattleBenchmark::walk(BattleUnit *unit)
+{
+	Pathfinding *pf = _save->getPathfinding();
+	int size = unit->getArmor()->getSize();
+	while (pf->getStartDirection() != -1)
+	{
+		Position destination;
+		int tu = pf->getTUCost(unit->getPosition(), pf->getStartDirection(), &destination, unit, 0, false);
+		if (tu >= 255 || !unit->spendTimeUnits(tu) || !_save->setUnitPosition(unit, destination, true))
+			break;
+		pf->dequeuePath();
+		Position origin = unit->getPosition();
+		for (int x = 0; x < size; ++x)
+		{
+			for (int y = 0; y < size; ++y)
+			{
+				_save->getTile(origin + Position(x, y, 0))->setUnit(0);
+			}
+		}
+		_save->setUnitPosition(unit, destination);
+		++_steps;
+		reactionFire(unit);
+		if (unit->getTile() == 0)
+			break;
+	}
+	pf->abortPath();
+	if (unit->getTile() == 0)
+		return;
+	Uint32 start = SDL_GetTicks();
+	_save->getTileEngine()->calculateFOV(unit);
+	_fov += SDL_GetTicks() - start;
+}
+
+/**
+ * Takes the units that were killed or knocked out off the map, skipping
+ * the falling animation and leaving no bodies behind.
+ */
+void BattleBenchmark::removeCasualties()
+{
+	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	{
+		BattleUnit *unit = *i;
+		if (unit->isOut() || !unit->getTile() || (unit->getHealth() > 0 && unit->getStunlevel() < unit->getHealth()))
+			continue;
+		unit->startFalling();
+		while (unit->getStatus() == STATUS_COLLAPSING)
+		{
+			unit->keepFalling();
+		}
+		int size = unit->getArmor()->getSize();
+		for (int x = 0; x < size; ++x)
+		{
+			for (int y = 0; y < size; ++y)
+			{
+				Tile *tile = _save->getTile(unit->getPosition() + Position(x, y, 0));
+				if (tile->getUnit() == unit)
+				{
+					tile->setUnit(0);
+				}
+			}
+		}
+		unit->setTile(0);
+	}
+}
+
+/**
+ * Gets a hash of everything the phases can change: the terrain,
+ * fire and smoke of every tile, and where the units are and how they are.
+ * @return FNV-1a hash.
+ */
+Uint32 BattleBenchmark::hashState() const
+{
+	Uint32 hash = 2166136261u;
+	std::vector<int> values;
+	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
+	{
+		Tile *tile = _save->getTiles()[i];
+		for (int part = 0; part < 4; ++part)
+		{
+			int mapDataID, mapDataSetID;
+			tile->getMapData(&mapDataID, &mapDataSetID, part);
+			values.push_back(mapDataID);
+			values.push_back(mapDataSetID);
+		}
+		values.push_back(tile->getFire());
+		values.push_back(tile->getSmoke());
+	}
+	for (std::vector<BattleUnit*>::const_iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	{
+		values.push_back((*i)->getId());
+		values.push_back((*i)->getPosition().x);
+		values.push_back((*i)->getPosition().y);
+		values.push_back((*i)->getPosition().z);
+		values.push_back((*i)->getHealth());
+		values.push_back((*i)->getStunlevel());
+		values.push_back((*i)->getTimeUnits());
+		values.push_back((*i)->getStatus());
+	}
+	for (std::vector<int>::const_iterator i = values.begin(); i != values.end(); ++i)
+	{
+		for (int byte = 0; byte < 4; ++byte)
+		{
+			hash ^= (*i >> (byte * 8)) & 0xFF;
+			hash *= 16777619u;
+		}
+	}
+	return hash;
+}
+
+}
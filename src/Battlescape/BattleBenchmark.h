@@ -0,0 +1,79 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_BATTLEBENCHMARK_H
+#define OPENXCOM_BATTLEBENCHMARK_H
+
+#include <string>
+#include <sstream>
+#include <SDL.h>
+#include "BattlescapeGame.h"
+#include "../Savegame/BattleUnit.h"
+
+namespace OpenXcom
+{
+
+class Game;
+class SavedBattleGame;
+class BattleUnit;
+class Map;
+
+/**
+ * Plays a saved battle without drawing anything, for profiling.
+ * Every unit uses the AI, soldiers the same one as the aliens, and
+ * reaction fire is checked after every step and attack.
+ * Every turn is timed by phase (lighting, FOV, pathfinding, AI,
+ * reactions, explosions), and a hash of the final battle state is given so
+ * runs with the same seed can be compared. Then the final map is
+ * drawn off screen, on one thread and across the thread pool.
+ */
+class BattleBenchmark
+{
+private:
+	Game *_game;
+	SavedBattleGame *_save;
+	Uint32 _lighting, _fov, _pathfinding, _ai, _reactions, _explosions;
+	int _steps, _attacks, _reactionAttacks;
+	/// Plays the turn of one side.
+	void playSide(UnitFaction side);
+	/// Lets the AI of a unit choose an action and carries it out.
+	void think(BattleUnit *unit);
+	/// Carries out an attack.
+	bool attack(BattleAction &action);
+	/// Lets the units that saw a unit act react to it.
+	void reactionFire(BattleUnit *unit);
+	/// Walks a unit along the current path.
+	void walk(BattleUnit *unit);
+	/// Takes the units that were killed or knocked out off the map.
+	void removeCasualties();
+	/// Gets a hash of the state of the map and the units.
+	Uint32 hashState() const;
+	/// Times drawing the map on one thread and across the thread pool.
+	void drawFrames(Map *map, std::ostringstream &ss);
+public:
+	/// Creates a benchmark for the game.
+	BattleBenchmark(Game *game);
+	/// Cleans up the benchmark.
+	~BattleBenchmark();
+	/// Plays a saved battle for a number of turns.
+	void run(const std::string &filename, int turns, int seed);
+};
+
+}
+
+#endif
@@ -264,7 +264,7 @@ void BattlescapeGame::handleAI(BattleUnit *unit)
 
 		if (_save->getTile(action.target))
 		{
-			_save->getPathfinding()->calculate(action.actor, action.target);//, _save->getTile(action.target)->getUnit());
+			_save->getPathfinding()->calculateLongRange(action.actor, action.target);
 		}
 		if (_save->getPathfinding()->getStartDirection() != -1)
 		{
@@ -1526,6 +1526,11 @@ inline void BattlescapeState::handle(Action *action)
 							}
 						}
 					}
+					// "ctrl-p" - pathfinding benchmark
+					else if (_save->getDebugMode() && action->getDetails()->key.keysym.sym == SDLK_p && (SDL_GetModState() & KMOD_CTRL) != 0)
+					{
+						benchmarkPathfinding();
+					}
 					// f11 - voxel map dump
 					else if (action->getDetails()->key.keysym.sym == SDLK_F11)
 					{
@@ -1817,6 +1822,42 @@ void BattlescapeState::saveVoxelView()
 	return;
 }
 
+/**
+ * Measures the speed of the pathfinding on the current map: every unit
+ * looks for all the tiles it can reach and for a path to the next unit,
+ * the same kind of searches the AI runs every turn.
+ * The results are written to the log.
+ */
+void BattlescapeState::benchmarkPathfinding()
+{
+	Pathfinding *pathfinding = _save->getPathfinding();
+	size_t nodes = pathfinding->getNodesChecked();
+	int searches = 0;
+	Uint32 start = SDL_GetTicks();
+
+	std::vector<BattleUnit*> units;
+	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
+	{
+		if (!(*i)->isOut() && (*i)->getTile())
+		{
+			units.push_back(*i);
+		}
+	}
+	for (size_t i = 0; i < units.size(); ++i)
+	{
+		pathfinding->findReachable(units[i], units[i]->getBaseStats()->tu);
+		pathfinding->calculate(units[i], units[(i + 1) % units.size()]->getPosition());
+		searches += 2;
+	}
+	pathfinding->abortPath();
+
+	nodes = pathfinding->getNodesChecked() - nodes;
+	Uint32 time = std::max<Uint32>(SDL_GetTicks() - start, 1);
+	Log(LOG_INFO) << "Pathfinding benchmark on a " << _save->getMapSizeX() << "x" << _save->getMapSizeY() << "x" << _save->getMapSizeZ() << " map: "
+		<< searches << " searches, " << nodes << " nodes checked in " << time << "ms (" << (Uint64)nodes * 1000 / time << " nodes/sec).";
+	debug(L"Pathfinding benchmark written to log");
+}
+
 /**
  * Saves each layer of voxels on the bettlescape as a png.
  */
@@ -189,6 +189,8 @@ public:
 	BattlescapeGame *getBattleGame();
 	/// Saves a map as used by the AI.
 	void saveAIMap();
+	/// Measures the speed of the pathfinding on the current map.
+	void benchmarkPathfinding();
 	/// Saves each layer of voxels on the bettlescape as a png.
 	void saveVoxelMap();
 	/// Saves a first-person voxel view of the battlescape.
@@ -37,7 +37,10 @@
 #include "../Ruleset/Ruleset.h"
 #include "../Ruleset/AlienDeployment.h"
 #include "../Ruleset/RuleUfo.h"
+#include "../Ruleset/Armor.h"
+#include "../Savegame/BattleUnit.h"
 #include <sstream>
+#include <algorithm>
 #include "../Engine/Options.h"
 #include "../Engine/Screen.h"
 #include "../Menu/CutsceneState.h"
@@ -149,6 +152,23 @@ BriefingState::BriefingState(Craft *craft, Base *base)
 		// And make sure the base is unmarked.
 		base->setRetaliationTarget(false);
 	}
+
+	// start loading the unit sprites while the briefing is read
+	std::vector<std::string> sets;
+	sets.push_back("HANDOB.PCK");
+	sets.push_back("HANDOB2.PCK");
+	sets.push_back("FLOOROB.PCK");
+	sets.push_back("BIGOBS.PCK");
+	std::vector<BattleUnit*> *units = _game->getSavedGame()->getSavedBattle()->getUnits();
+	for (std::vector<BattleUnit*>::iterator i = units->begin(); i != units->end(); ++i)
+	{
+		std::string sheet = (*i)->getArmor()->getSpriteSheet();
+		if (std::find(sets.begin(), sets.end(), sheet) == sets.end())
+		{
+			sets.push_back(sheet);
+		}
+	}
+	_game->getResourcePack()->prefetchSurfaceSets(sets);
 }
 
 /**
@@ -506,7 +506,7 @@ void CivilianBAIState::setupPatrol()
 
 		if (_toNode != 0)
 		{
-			_save->getPathfinding()->calculate(_unit, _toNode->getPosition());
+			_save->getPathfinding()->calculateLongRange(_unit, _toNode->getPosition());
 			if (_save->getPathfinding()->getStartDirection() == -1)
 			{
 				_toNode = 0;
@@ -261,6 +261,8 @@ void DebriefingState::btnOkClick(Action *)
 		}
 	}
 	_game->getSavedGame()->setBattleGame(0);
+	// the unit sprites aren't needed until the next mission
+	_game->getResourcePack()->releaseSurfaceSets();
 	_game->popState();
 	if (_game->getSavedGame()->getMonthsPassed() == -1)
 	{
@@ -18,10 +18,13 @@
  */
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <cstring>
+#include <algorithm>
 #include <fstream>
 #include "Map.h"
 #include "Camera.h"
 #include "UnitSprite.h"
+#include "UnitSpriteCache.h"
 #include "Position.h"
 #include "Pathfinding.h"
 #include "TileEngine.h"
@@ -38,6 +41,7 @@
 #include "../Engine/RNG.h"
 #include "../Engine/Game.h"
 #include "../Engine/Screen.h"
+#include "../Engine/ThreadPool.h"
 #include "../Savegame/SavedBattleGame.h"
 #include "../Savegame/Tile.h"
 #include "../Savegame/BattleUnit.h"
@@ -80,7 +84,7 @@ namespace OpenXcom
  * @param y Y position in pixels.
  * @param visibleMapHeight Current visible map height.
  */
-Map::Map(Game *game, int width, int height, int x, int y, int visibleMapHeight) : InteractiveSurface(width, height, x, y), _game(game), _arrow(0), _selectorX(0), _selectorY(0), _mouseX(0), _mouseY(0), _cursorType(CT_NORMAL), _cursorSize(1), _animFrame(0), _projectile(0), _projectileInFOV(false), _explosionInFOV(false), _launch(false), _visibleMapHeight(visibleMapHeight), _unitDying(false), _smoothingEngaged(false), _flashScreen(false)
+Map::Map(Game *game, int width, int height, int x, int y, int visibleMapHeight) : InteractiveSurface(width, height, x, y), _game(game), _arrow(0), _selectorX(0), _selectorY(0), _mouseX(0), _mouseY(0), _cursorType(CT_NORMAL), _cursorSize(1), _animFrame(0), _projectile(0), _projectileInFOV(false), _explosionInFOV(false), _launch(false), _visibleMapHeight(visibleMapHeight), _unitDying(false), _smoothingEngaged(false), _flashScreen(false), _threadedDrawing(true)
 {
 	_iconHeight = _game->getRuleset()->getInterface("battlescape")->getElement("icons")->h;
 	_iconWidth = _game->getRuleset()->getInterface("battlescape")->getElement("icons")->w;
@@ -118,6 +122,7 @@ Map::Map(Game *game, int width, int height, int x, int y, int visibleMapHeight)
 	_txtAccuracy->setPalette(_game->getScreen()->getPalette());
 	_txtAccuracy->setHighContrast(true);
 	_txtAccuracy->initText(_res->getFont("FONT_BIG"), _res->getFont("FONT_SMALL"), _game->getLanguage());
+	_unitSprites = new UnitSpriteCache(UNIT_SPRITE_CACHE_SIZE);
 }
 
 /**
@@ -131,6 +136,11 @@ Map::~Map()
 	delete _message;
 	delete _camera;
 	delete _txtAccuracy;
+	delete _unitSprites;
+	for (std::vector<Surface*>::iterator i = _bands.begin(); i != _bands.end(); ++i)
+	{
+		delete *i;
+	}
 }
 
 /**
@@ -168,6 +178,17 @@ void Map::init()
 	{
 		_projectileSet = _res->getSurfaceSet("UnderwaterProjectiles");
 	}
+	// look the sets up once, the tiles are drawn from several threads
+	_res->waitPrefetch();
+	_cursorSet = _res->getSurfaceSet("CURSOR.PCK");
+	_smokeSet = _res->getSurfaceSet("SMOKE.PCK");
+	_hitSet = _res->getSurfaceSet("HIT.PCK");
+	_explosionSet = _res->getSurfaceSet("X1.PCK");
+	_floorObSet = _res->getSurfaceSet("FLOOROB.PCK");
+	_breathSet = _res->getSurfaceSet("BREATH-1.PCK");
+	_pathfindingSet = _res->getSurfaceSet("Pathfinding");
+	_handObSet = _res->getSurfaceSet("HANDOB.PCK");
+	_handOb2Set = _res->getSurfaceSet("HANDOB2.PCK");
 }
 
 /**
@@ -249,6 +270,44 @@ void Map::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 	_message->setText(_game->getLanguage()->getString("STR_HIDDEN_MOVEMENT"));
 }
 
+/**
+ * Draws the tiles of one band of screen rows on a copy
+ * of those rows, then puts them back on the screen.
+ */
+class DrawBandJob : public ThreadJob
+{
+private:
+	Map *_map;
+	Surface *_surface;
+	const MapDrawArea &_area;
+	int _bandHeight;
+
+	/// Copies screen rows between two surfaces.
+	static void copyRows(Surface *from, int fromY, Surface *to, int toY, int rows)
+	{
+		SDL_Surface *src = from->getSurface(), *dst = to->getSurface();
+		for (int y = 0; y < rows; ++y)
+		{
+			memcpy((Uint8*)dst->pixels + (toY + y) * dst->pitch, (Uint8*)src->pixels + (fromY + y) * src->pitch, from->getWidth());
+		}
+	}
+public:
+	DrawBandJob(Map *map, Surface *surface, const MapDrawArea &area, int bandHeight) : _map(map), _surface(surface), _area(area), _bandHeight(bandHeight)
+	{
+	}
+	void run(int index)
+	{
+		int top = index * _bandHeight;
+		int rows = std::min(_bandHeight, _area.height - top);
+		if (rows <= 0)
+			return;
+		Surface *band = _map->_bands[index];
+		copyRows(_surface, top, band, 0, rows);
+		_map->drawTiles(band, top, _area);
+		copyRows(band, 0, _surface, top, rows);
+	}
+};
+
 /**
  * Draw the terrain.
  * Keep this function as optimised as possible. It's big to minimise overhead of function calls.
@@ -256,7 +315,6 @@ void Map::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
  */
 void Map::drawTerrain(Surface *surface)
 {
-	int frameNumber = 0;
 	Surface *tmpSurface;
 	Tile *tile;
 	int beginX = 0, endX = _save->getMapSizeX() - 1;
@@ -266,8 +324,6 @@ void Map::drawTerrain(Surface *surface)
 	int bulletLowX=16000, bulletLowY=16000, bulletLowZ=16000, bulletHighX=0, bulletHighY=0, bulletHighZ=0;
 	int dummy;
 	BattleUnit *unit = 0;
-	bool invalid;
-	int tileShade, wallShade, tileColor;
 	static const int arrowBob[8] = {0,1,2,1,0,1,2,1};
 	
 	NumberText *_numWaypid = 0;
@@ -386,28 +442,302 @@ void Map::drawTerrain(Surface *surface)
 
 	bool pathfinderTurnedOn = _save->getPathfinding()->isPathPreviewed();
 
+	_numWaypid = newWaypointNumbers();
+
+	surface->lock();
+	MapDrawArea area;
+	area.width = surface->getWidth();
+	area.height = surface->getHeight();
+	area.beginX = beginX;
+	area.endX = endX;
+	area.beginY = beginY;
+	area.endY = endY;
+	area.beginZ = beginZ;
+	area.endZ = endZ;
+	area.bulletLowX = bulletLowX;
+	area.bulletLowY = bulletLowY;
+	area.bulletHighX = bulletHighX;
+	area.bulletHighY = bulletHighY;
+
+	if (_cursorType == CT_AIM && Options::battleUFOExtenderAccuracy)
+	{
+		updateAccuracy(Position(_selectorX, _selectorY, _camera->getViewLevel()));
+	}
+
+	int bands = _threadedDrawing ? std::min(ThreadPool::get()->getThreadCount(), area.height / MIN_BAND_HEIGHT) : 1;
+	if (bands > 1)
+	{
+		// every band draws on its own copy of its screen rows
+		int bandHeight = (area.height + bands - 1) / bands;
+		for (int i = 0; i < bands; ++i)
+		{
+			if (i == (int)_bands.size())
+			{
+				_bands.push_back(new Surface(area.width, bandHeight));
+			}
+			else if (_bands[i]->getWidth() != area.width || _bands[i]->getHeight() != bandHeight)
+			{
+				delete _bands[i];
+				_bands[i] = new Surface(area.width, bandHeight);
+			}
+		}
+		DrawBandJob job(this, surface, area, bandHeight);
+		ThreadPool::get()->run(&job, bands);
+	}
+	else
+	{
+		drawTiles(surface, 0, area);
+	}
+
+	if (pathfinderTurnedOn)
+	{
+		if (_numWaypid)
+		{
+			_numWaypid->setBordered(true); // give it a border for the pathfinding display, makes it more visible on snow, etc.
+		}
+		for (int itZ = beginZ; itZ <= endZ; itZ++)
+		{
+			for (int itX = beginX; itX <= endX; itX++)
+			{
+				for (int itY = beginY; itY <= endY; itY++)
+				{
+					mapPosition = Position(itX, itY, itZ);
+					_camera->convertMapToScreen(mapPosition, &screenPosition);
+					screenPosition += _camera->getMapOffset();
+
+					// only render cells that are inside the surface
+					if (screenPosition.x > -_spriteWidth && screenPosition.x < surface->getWidth() + _spriteWidth &&
+						screenPosition.y > -_spriteHeight && screenPosition.y < surface->getHeight() + _spriteHeight )
+					{
+						tile = _save->getTile(mapPosition);
+						Tile *tileBelow = _save->getTile(mapPosition - Position(0,0,1));
+						if (!tile || !tile->isDiscovered(0) || tile->getPreview() == -1)
+							continue;
+						int adjustment = -tile->getTerrainLevel();
+						if (_previewSetting & PATH_ARROWS)
+						{
+							if (itZ > 0 && tile->hasNoFloor(tileBelow))
+							{
+								tmpSurface = _pathfindingSet->getFrame(23);
+								if (tmpSurface)
+								{
+									tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y+2, 0, false, tile->getMarkerColor());
+								}
+							}
+							int overlay = tile->getPreview() + 12;
+							tmpSurface = _pathfindingSet->getFrame(overlay);
+							if (tmpSurface)
+							{
+								tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - adjustment, 0, false, tile->getMarkerColor());
+							}
+						}
+
+						if (_previewSetting & PATH_TU_COST && tile->getTUMarker() > -1)
+						{
+							int off = tile->getTUMarker() > 9 ? 5 : 3;
+							if (_save->getSelectedUnit() && _save->getSelectedUnit()->getArmor()->getSize() > 1)
+							{
+								adjustment += 1;
+								if (!(_previewSetting & PATH_ARROWS))
+								{
+									adjustment += 7;
+								}
+							}
+							_numWaypid->setValue(tile->getTUMarker());
+							_numWaypid->draw();
+							if ( !(_previewSetting & PATH_ARROWS) )
+							{
+								_numWaypid->blitNShade(surface, screenPosition.x + 16 - off, screenPosition.y + (29-adjustment), 0, false, tile->getMarkerColor() );
+							}
+							else
+							{
+								_numWaypid->blitNShade(surface, screenPosition.x + 16 - off, screenPosition.y + (22-adjustment), 0);
+							}
+						}
+					}
+				}
+			}
+		}
+		if (_numWaypid)
+		{
+			_numWaypid->setBordered(false); // make sure we remove the border in case it's being used for missile waypoints.
+		}
+	}
+	unit = (BattleUnit*)_save->getSelectedUnit();
+	if (unit && (_save->getSide() == FACTION_PLAYER || _save->getDebugMode()) && unit->getPosition().z <= _camera->getViewLevel())
+	{
+		_camera->convertMapToScreen(unit->getPosition(), &screenPosition);
+		screenPosition += _camera->getMapOffset();
+		Position offset;
+		calculateWalkingOffset(unit, &offset);
+		if (unit->getArmor()->getSize() > 1)
+		{
+			offset.y += 4;
+		}
+		offset.y += 24 - unit->getHeight();
+		if (unit->isKneeled())
+		{
+			offset.y -= 2;
+		}
+		if (this->getCursorType() != CT_NONE)
+		{
+			_arrow->blitNShade(surface, screenPosition.x + offset.x + (_spriteWidth / 2) - (_arrow->getWidth() / 2), screenPosition.y + offset.y - _arrow->getHeight() + arrowBob[_animFrame], 0);
+		}
+	}
+	delete _numWaypid;
+
+	// check if we got big explosions
+	if (_explosionInFOV)
+	{
+		// big explosions cause the screen to flash as bright as possible before any explosions are actually drawn.
+		// this causes everything to look like EGA for a single frame.
+		if (_flashScreen)
+		{
+			for (int x = 0, y = 0; x < surface->getWidth() && y < surface->getHeight();)
+			{
+				Uint8 pixel = surface->getPixel(x, y);
+				pixel = (pixel / 16) * 16;
+				surface->setPixelIterative(&x, &y, pixel);
+			}
+			_flashScreen = false;
+		}
+		else
+		{
+			for (std::list<Explosion*>::const_iterator i = _explosions.begin(); i != _explosions.end(); ++i)
+			{
+				_camera->convertVoxelToScreen((*i)->getPosition(), &bulletPositionScreen);
+				if ((*i)->isBig())
+				{
+					if ((*i)->getCurrentFrame() >= 0)
+					{
+						tmpSurface = _explosionSet->getFrame((*i)->getCurrentFrame());
+						tmpSurface->blitNShade(surface, bulletPositionScreen.x - 64, bulletPositionScreen.y - 64, 0);
+					}
+				}
+				else if ((*i)->isHit())
+				{
+					tmpSurface = _hitSet->getFrame((*i)->getCurrentFrame());
+					tmpSurface->blitNShade(surface, bulletPositionScreen.x - 15, bulletPositionScreen.y - 25, 0);
+				}
+				else
+				{
+					tmpSurface = _smokeSet->getFrame((*i)->getCurrentFrame());
+					tmpSurface->blitNShade(surface, bulletPositionScreen.x - 15, bulletPositionScreen.y - 15, 0);
+				}
+			}
+		}
+	}
+	surface->unlock();
+}
+
+/**
+ * Creates the number text for the waypoints and the path preview, if any are shown.
+ * @return New number text, or 0 if there are no numbers to draw.
+ */
+NumberText *Map::newWaypointNumbers()
+{
+	bool pathfinderTurnedOn = _save->getPathfinding()->isPathPreviewed();
 	if (!_waypoints.empty() || (pathfinderTurnedOn && (_previewSetting & PATH_TU_COST)))
 	{
-		_numWaypid = new NumberText(15, 15, 20, 30);
-		_numWaypid->setPalette(getPalette());
-		_numWaypid->setColor(pathfinderTurnedOn ? _messageColor + 1 : Palette::blockOffset(1));
+		NumberText *numbers = new NumberText(15, 15, 20, 30);
+		numbers->setPalette(getPalette());
+		numbers->setColor(pathfinderTurnedOn ? _messageColor + 1 : Palette::blockOffset(1));
+		return numbers;
 	}
+	return 0;
+}
 
-	surface->lock();
-	for (int itZ = beginZ; itZ <= endZ; itZ++)
+/**
+ * Works out the accuracy shown on the aiming cursor, so the
+ * text is ready before the tiles are drawn.
+ * @param target Position of the tile under the cursor.
+ */
+void Map::updateAccuracy(const Position &target)
+{
+	BattleAction *action = _save->getBattleGame()->getCurrentAction();
+	RuleItem *weapon = action->weapon->getRules();
+	std::ostringstream ss;
+	int accuracy = action->actor->getFiringAccuracy(action->type, action->weapon);
+	int distance = _save->getTileEngine()->distance(target, action->actor->getPosition());
+	int upperLimit = 200;
+	int lowerLimit = weapon->getMinRange();
+	switch (action->type)
+	{
+	case BA_AIMEDSHOT:
+		upperLimit = weapon->getAimRange();
+		break;
+	case BA_SNAPSHOT:
+		upperLimit = weapon->getSnapRange();
+		break;
+	case BA_AUTOSHOT:
+		upperLimit = weapon->getAutoRange();
+		break;
+	default:
+		break;
+	}
+	// at this point, let's assume the shot is adjusted and set the text amber.
+	_txtAccuracy->setColor(Palette::blockOffset(1)-1);
+
+	if (distance > upperLimit)
+	{
+		accuracy -= (distance - upperLimit) * weapon->getDropoff();
+	}
+	else if (distance < lowerLimit)
+	{
+		accuracy -= (lowerLimit - distance) * weapon->getDropoff();
+	}
+	else
 	{
-		for (int itX = beginX; itX <= endX; itX++)
+		// no adjustment made? set it to green.
+		_txtAccuracy->setColor(Palette::blockOffset(4)-1);
+	}
+
+	// zero accuracy or out of range: set it red.
+	if (accuracy <= 0 || distance > weapon->getMaxRange())
+	{
+		accuracy = 0;
+		_txtAccuracy->setColor(Palette::blockOffset(2)-1);
+	}
+	ss << accuracy;
+	ss << "%";
+	_txtAccuracy->setText(Language::utf8ToWstr(ss.str().c_str()).c_str());
+	_txtAccuracy->draw();
+}
+
+/**
+ * Draws the tiles of the map in painter's order, onto a surface holding a band of
+ * screen rows. Every band goes through all the visible tiles the same way, so the
+ * rows come out exactly as if the whole screen was drawn at once.
+ * @param surface The surface to draw on.
+ * @param top Screen row of the top of the surface.
+ * @param area The part of the map on the screen.
+ */
+void Map::drawTiles(Surface *surface, int top, const MapDrawArea &area)
+{
+	int frameNumber = 0;
+	Surface *tmpSurface;
+	Tile *tile;
+	Position mapPosition, screenPosition, bulletPositionScreen;
+	BattleUnit *unit = 0;
+	bool invalid;
+	int tileShade, wallShade, tileColor;
+	NumberText *_numWaypid = newWaypointNumbers();
+
+	for (int itZ = area.beginZ; itZ <= area.endZ; itZ++)
+	{
+		for (int itX = area.beginX; itX <= area.endX; itX++)
 		{
-			for (int itY = beginY; itY <= endY; itY++)
+			for (int itY = area.beginY; itY <= area.endY; itY++)
 			{
 				mapPosition = Position(itX, itY, itZ);
 				_camera->convertMapToScreen(mapPosition, &screenPosition);
 				screenPosition += _camera->getMapOffset();
 
 				// only render cells that are inside the surface
-				if (screenPosition.x > -_spriteWidth && screenPosition.x < surface->getWidth() + _spriteWidth &&
-					screenPosition.y > -_spriteHeight && screenPosition.y < surface->getHeight() + _spriteHeight )
+				if (screenPosition.x > -_spriteWidth && screenPosition.x < area.width + _spriteWidth &&
+					screenPosition.y > -_spriteHeight && screenPosition.y < area.height + _spriteHeight )
 				{
+					screenPosition.y -= top;
 					tile = _save->getTile(mapPosition);
 
 					if (!tile) continue;
@@ -448,13 +778,13 @@ void Map::drawTerrain(Surface *surface)
 								else
 									frameNumber = 6; // red static crosshairs
 							}
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
+							tmpSurface = _cursorSet->getFrame(frameNumber);
 							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
 						}
 						else if (_camera->getViewLevel() > itZ)
 						{
 							frameNumber = 2; // blue box
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
+							tmpSurface = _cursorSet->getFrame(frameNumber);
 							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
 						}
 					}
@@ -490,13 +820,13 @@ void Map::drawTerrain(Surface *surface)
 							{
 								// draw unit
 								Position offset;
-								calculateWalkingOffset(bu, &offset);
+								calculateWalkingOffset(bu, &offset, top == 0);
 								tmpSurface->blitNShade(surface, screenPosition.x + offset.x + tileOffset.x, screenPosition.y + offset.y  + tileOffset.y, tileNorthShade);
 								// draw fire
 								if (bu->getFire() > 0)
 								{
 									frameNumber = 4 + (_animFrame / 2);
-									tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
+									tmpSurface = _smokeSet->getFrame(frameNumber);
 									tmpSurface->blitNShade(surface, screenPosition.x + offset.x + tileOffset.x, screenPosition.y + offset.y + tileOffset.y, 0);
 								}
 							}
@@ -560,7 +890,7 @@ void Map::drawTerrain(Surface *surface)
 								 * only render half so it won't overlap other areas that are already drawn
 								 * and only apply this to movement in a north easterly or south westerly direction.
 								 */
-								if ( (bu->getDirection() == 1 || bu->getDirection() == 5) && mapPosition.y < endY-1)
+								if ( (bu->getDirection() == 1 || bu->getDirection() == 5) && mapPosition.y < area.endY-1)
 								{
 									Tile *tileSouthWest = _save->getTile(mapPosition + Position(-1, 1, 0));
 									if (tileSouthWest->isDiscovered(2))
@@ -628,7 +958,7 @@ void Map::drawTerrain(Surface *surface)
 								int sprite = tileWest->getTopItemSprite();
 								if (sprite != -1)
 								{
-									tmpSurface = _res->getSurfaceSet("FLOOROB.PCK")->getFrame(sprite);
+									tmpSurface = _floorObSet->getFrame(sprite);
 									tmpSurface->blitNShade(surface, screenPosition.x - tileOffset.x, screenPosition.y + tileWest->getTerrainLevel() + tileOffset.y, tileWestShade, true);
 								}
 								// Draw soldier
@@ -645,7 +975,7 @@ void Map::drawTerrain(Surface *surface)
 										if (westUnit->getFire() > 0)
 										{
 											frameNumber = 4 + (_animFrame / 2);
-											tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
+											tmpSurface = _smokeSet->getFrame(frameNumber);
 											tmpSurface->blitNShade(surface, screenPosition.x - tileOffset.x, screenPosition.y + tileOffset.y + getTerrainLevel(westUnit->getPosition(), westUnit->getArmor()->getSize()), 0, true);
 										}
 									}
@@ -678,7 +1008,7 @@ void Map::drawTerrain(Surface *surface)
 									{
 										frameNumber += (_animFrame / 2) + tileWest->getAnimationOffset();
 									}
-									tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
+									tmpSurface = _smokeSet->getFrame(frameNumber);
 									tmpSurface->blitNShade(surface, screenPosition.x - tileOffset.x, screenPosition.y + tileOffset.y, shade, true);
 								}
 								// Draw object
@@ -735,7 +1065,7 @@ void Map::drawTerrain(Surface *surface)
 						int sprite = tile->getTopItemSprite();
 						if (sprite != -1)
 						{
-							tmpSurface = _res->getSurfaceSet("FLOOROB.PCK")->getFrame(sprite);
+							tmpSurface = _floorObSet->getFrame(sprite);
 							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y + tile->getTerrainLevel(), tileShade, false);
 						}
 
@@ -760,6 +1090,7 @@ void Map::drawTerrain(Surface *surface)
 								_save->getTileEngine()->isVoxelVisible(voxelPos))
 							{
 								_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+								bulletPositionScreen.y -= top;
 								tmpSurface->blitNShade(surface, bulletPositionScreen.x - 16, bulletPositionScreen.y - 26, 16);
 							}
 
@@ -773,6 +1104,7 @@ void Map::drawTerrain(Surface *surface)
 								_save->getTileEngine()->isVoxelVisible(voxelPos))
 							{
 								_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+								bulletPositionScreen.y -= top;
 								tmpSurface->blitNShade(surface, bulletPositionScreen.x - 16, bulletPositionScreen.y - 26, 0);
 							}
 
@@ -780,7 +1112,7 @@ void Map::drawTerrain(Surface *surface)
 						else
 						{
 							// draw bullet on the correct tile
-							if (itX >= bulletLowX && itX <= bulletHighX && itY >= bulletLowY && itY <= bulletHighY)
+							if (itX >= area.bulletLowX && itX <= area.bulletHighX && itY >= area.bulletLowY && itY <= area.bulletHighY)
 							{
 								int begin = 0;
 								int end = BULLET_SPRITES;
@@ -806,6 +1138,7 @@ void Map::drawTerrain(Surface *surface)
 											_save->getTileEngine()->isVoxelVisible(voxelPos))
 										{
 											_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+											bulletPositionScreen.y -= top;
 											bulletPositionScreen.x -= tmpSurface->getWidth() / 2;
 											bulletPositionScreen.y -= tmpSurface->getHeight() / 2;
 											tmpSurface->blitNShade(surface, bulletPositionScreen.x, bulletPositionScreen.y, 16);
@@ -819,6 +1152,7 @@ void Map::drawTerrain(Surface *surface)
 											_save->getTileEngine()->isVoxelVisible(voxelPos))
 										{
 											_camera->convertVoxelToScreen(voxelPos, &bulletPositionScreen);
+											bulletPositionScreen.y -= top;
 											bulletPositionScreen.x -= tmpSurface->getWidth() / 2;
 											bulletPositionScreen.y -= tmpSurface->getHeight() / 2;
 											tmpSurface->blitNShade(surface, bulletPositionScreen.x, bulletPositionScreen.y, 0);
@@ -840,17 +1174,17 @@ void Map::drawTerrain(Surface *surface)
 						if (tmpSurface)
 						{
 							Position offset;
-							calculateWalkingOffset(unit, &offset);
+							calculateWalkingOffset(unit, &offset, top == 0);
 							tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, tileShade);
 							if (unit->getFire() > 0)
 							{
 								frameNumber = 4 + (_animFrame / 2);
-								tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
+								tmpSurface = _smokeSet->getFrame(frameNumber);
 								tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, 0);
 							}
 							if (unit->getBreathFrame() > 0)
 							{
-								tmpSurface = _res->getSurfaceSet("BREATH-1.PCK")->getFrame(unit->getBreathFrame() - 1);
+								tmpSurface = _breathSet->getFrame(unit->getBreathFrame() - 1);
 								// we enlarge the unit sprite when aiming to accomodate the weapon. so adjust as necessary.
 								if (unit->getStatus() == STATUS_AIMING)
 								{
@@ -882,7 +1216,7 @@ void Map::drawTerrain(Surface *surface)
 							if (tmpSurface)
 							{
 								Position offset;
-								calculateWalkingOffset(tunit, &offset);
+								calculateWalkingOffset(tunit, &offset, top == 0);
 								offset.y += 24;
 								tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, ttile->getShade());
 								if (tunit->getArmor()->getSize() > 1)
@@ -892,7 +1226,7 @@ void Map::drawTerrain(Surface *surface)
 								if (tunit->getFire() > 0)
 								{
 									frameNumber = 4 + (_animFrame / 2);
-									tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
+									tmpSurface = _smokeSet->getFrame(frameNumber);
 									tmpSurface->blitNShade(surface, screenPosition.x + offset.x, screenPosition.y + offset.y, 0);
 								}
 							}
@@ -926,7 +1260,7 @@ void Map::drawTerrain(Surface *surface)
 						{
 							frameNumber += (_animFrame / 2) + tile->getAnimationOffset();
 						}
-						tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame(frameNumber);
+						tmpSurface = _smokeSet->getFrame(frameNumber);
 						tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, shade);
 					}
 
@@ -957,13 +1291,13 @@ void Map::drawTerrain(Surface *surface)
 					{
 						if (itZ > 0 && tile->hasNoFloor(tileBelow))
 						{
-							tmpSurface = _res->getSurfaceSet("Pathfinding")->getFrame(11);
+							tmpSurface = _pathfindingSet->getFrame(11);
 							if (tmpSurface)
 							{
 								tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y+2, 0, false, tile->getMarkerColor());
 							}
 						}
-						tmpSurface = _res->getSurfaceSet("Pathfinding")->getFrame(tile->getPreview());
+						tmpSurface = _pathfindingSet->getFrame(tile->getPreview());
 						if (tmpSurface)
 						{
 							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y + tile->getTerrainLevel(), 0, false, tileColor);
@@ -998,73 +1332,25 @@ void Map::drawTerrain(Surface *surface)
 								else
 									frameNumber = 6; // red static crosshairs
 							}
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
+							tmpSurface = _cursorSet->getFrame(frameNumber);
 							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
 
 							// UFO extender accuracy: display adjusted accuracy value on crosshair in real-time.
 							if (_cursorType == CT_AIM && Options::battleUFOExtenderAccuracy)
 							{
-								BattleAction *action = _save->getBattleGame()->getCurrentAction();
-								RuleItem *weapon = action->weapon->getRules();
-								std::ostringstream ss;
-								int accuracy = action->actor->getFiringAccuracy(action->type, action->weapon);
-								int distance = _save->getTileEngine()->distance(Position (itX, itY,itZ), action->actor->getPosition());
-								int upperLimit = 200;
-								int lowerLimit = weapon->getMinRange();
-								switch (action->type)
-								{
-								case BA_AIMEDSHOT:
-									upperLimit = weapon->getAimRange();
-									break;
-								case BA_SNAPSHOT:
-									upperLimit = weapon->getSnapRange();
-									break;
-								case BA_AUTOSHOT:
-									upperLimit = weapon->getAutoRange();
-									break;
-								default:
-									break;
-								}
-								// at this point, let's assume the shot is adjusted and set the text amber.
-								_txtAccuracy->setColor(Palette::blockOffset(1)-1);
-
-								if (distance > upperLimit)
-								{
-									accuracy -= (distance - upperLimit) * weapon->getDropoff();
-								}
-								else if (distance < lowerLimit)
-								{
-									accuracy -= (lowerLimit - distance) * weapon->getDropoff();
-								}
-								else
-								{
-									// no adjustment made? set it to green.
-									_txtAccuracy->setColor(Palette::blockOffset(4)-1);
-								}
-
-								// zero accuracy or out of range: set it red.
-								if (accuracy <= 0 || distance > weapon->getMaxRange())
-								{
-									accuracy = 0;
-									_txtAccuracy->setColor(Palette::blockOffset(2)-1);
-								}
-								ss << accuracy;
-								ss << "%";
-								_txtAccuracy->setText(Language::utf8ToWstr(ss.str().c_str()).c_str());
-								_txtAccuracy->draw();
 								_txtAccuracy->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
 							}
 						}
 						else if (_camera->getViewLevel() > itZ)
 						{
 							frameNumber = 5; // blue box
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frameNumber);
+							tmpSurface = _cursorSet->getFrame(frameNumber);
 							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
 						}
 						if (_cursorType > 2 && _camera->getViewLevel() == itZ)
 						{
 							int frame[6] = {0, 0, 0, 11, 13, 15};
-							tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(frame[_cursorType] + (_animFrame / 4));
+							tmpSurface = _cursorSet->getFrame(frame[_cursorType] + (_animFrame / 4));
 							tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
 						}
 					}
@@ -1080,7 +1366,7 @@ void Map::drawTerrain(Surface *surface)
 						{
 							if (waypXOff == 2 && waypYOff == 2)
 							{
-								tmpSurface = _res->getSurfaceSet("CURSOR.PCK")->getFrame(7);
+								tmpSurface = _cursorSet->getFrame(7);
 								tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y, 0);
 							}
 							if (_save->getBattleGame()->getCurrentAction()->type == BA_LAUNCH)
@@ -1103,145 +1389,7 @@ void Map::drawTerrain(Surface *surface)
 			}
 		}
 	}
-	if (pathfinderTurnedOn)
-	{
-		if (_numWaypid)
-		{
-			_numWaypid->setBordered(true); // give it a border for the pathfinding display, makes it more visible on snow, etc.
-		}
-		for (int itZ = beginZ; itZ <= endZ; itZ++)
-		{
-			for (int itX = beginX; itX <= endX; itX++)
-			{
-				for (int itY = beginY; itY <= endY; itY++)
-				{
-					mapPosition = Position(itX, itY, itZ);
-					_camera->convertMapToScreen(mapPosition, &screenPosition);
-					screenPosition += _camera->getMapOffset();
-
-					// only render cells that are inside the surface
-					if (screenPosition.x > -_spriteWidth && screenPosition.x < surface->getWidth() + _spriteWidth &&
-						screenPosition.y > -_spriteHeight && screenPosition.y < surface->getHeight() + _spriteHeight )
-					{
-						tile = _save->getTile(mapPosition);
-						Tile *tileBelow = _save->getTile(mapPosition - Position(0,0,1));
-						if (!tile || !tile->isDiscovered(0) || tile->getPreview() == -1)
-							continue;
-						int adjustment = -tile->getTerrainLevel();
-						if (_previewSetting & PATH_ARROWS)
-						{
-							if (itZ > 0 && tile->hasNoFloor(tileBelow))
-							{
-								tmpSurface = _res->getSurfaceSet("Pathfinding")->getFrame(23);
-								if (tmpSurface)
-								{
-									tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y+2, 0, false, tile->getMarkerColor());
-								}
-							}
-							int overlay = tile->getPreview() + 12;
-							tmpSurface = _res->getSurfaceSet("Pathfinding")->getFrame(overlay);
-							if (tmpSurface)
-							{
-								tmpSurface->blitNShade(surface, screenPosition.x, screenPosition.y - adjustment, 0, false, tile->getMarkerColor());
-							}
-						}
-
-						if (_previewSetting & PATH_TU_COST && tile->getTUMarker() > -1)
-						{
-							int off = tile->getTUMarker() > 9 ? 5 : 3;
-							if (_save->getSelectedUnit() && _save->getSelectedUnit()->getArmor()->getSize() > 1)
-							{
-								adjustment += 1;
-								if (!(_previewSetting & PATH_ARROWS))
-								{
-									adjustment += 7;
-								}
-							}
-							_numWaypid->setValue(tile->getTUMarker());
-							_numWaypid->draw();
-							if ( !(_previewSetting & PATH_ARROWS) )
-							{
-								_numWaypid->blitNShade(surface, screenPosition.x + 16 - off, screenPosition.y + (29-adjustment), 0, false, tile->getMarkerColor() );
-							}
-							else
-							{
-								_numWaypid->blitNShade(surface, screenPosition.x + 16 - off, screenPosition.y + (22-adjustment), 0);
-							}
-						}
-					}
-				}
-			}
-		}
-		if (_numWaypid)
-		{
-			_numWaypid->setBordered(false); // make sure we remove the border in case it's being used for missile waypoints.
-		}
-	}
-	unit = (BattleUnit*)_save->getSelectedUnit();
-	if (unit && (_save->getSide() == FACTION_PLAYER || _save->getDebugMode()) && unit->getPosition().z <= _camera->getViewLevel())
-	{
-		_camera->convertMapToScreen(unit->getPosition(), &screenPosition);
-		screenPosition += _camera->getMapOffset();
-		Position offset;
-		calculateWalkingOffset(unit, &offset);
-		if (unit->getArmor()->getSize() > 1)
-		{
-			offset.y += 4;
-		}
-		offset.y += 24 - unit->getHeight();
-		if (unit->isKneeled())
-		{
-			offset.y -= 2;
-		}
-		if (this->getCursorType() != CT_NONE)
-		{
-			_arrow->blitNShade(surface, screenPosition.x + offset.x + (_spriteWidth / 2) - (_arrow->getWidth() / 2), screenPosition.y + offset.y - _arrow->getHeight() + arrowBob[_animFrame], 0);
-		}
-	}
 	delete _numWaypid;
-
-	// check if we got big explosions
-	if (_explosionInFOV)
-	{
-		// big explosions cause the screen to flash as bright as possible before any explosions are actually drawn.
-		// this causes everything to look like EGA for a single frame.
-		if (_flashScreen)
-		{
-			for (int x = 0, y = 0; x < surface->getWidth() && y < surface->getHeight();)
-			{
-				Uint8 pixel = surface->getPixel(x, y);
-				pixel = (pixel / 16) * 16;
-				surface->setPixelIterative(&x, &y, pixel);
-			}
-			_flashScreen = false;
-		}
-		else
-		{
-			for (std::list<Explosion*>::const_iterator i = _explosions.begin(); i != _explosions.end(); ++i)
-			{
-				_camera->convertVoxelToScreen((*i)->getPosition(), &bulletPositionScreen);
-				if ((*i)->isBig())
-				{
-					if ((*i)->getCurrentFrame() >= 0)
-					{
-						tmpSurface = _res->getSurfaceSet("X1.PCK")->getFrame((*i)->getCurrentFrame());
-						tmpSurface->blitNShade(surface, bulletPositionScreen.x - 64, bulletPositionScreen.y - 64, 0);
-					}
-				}
-				else if ((*i)->isHit())
-				{
-					tmpSurface = _res->getSurfaceSet("HIT.PCK")->getFrame((*i)->getCurrentFrame());
-					tmpSurface->blitNShade(surface, bulletPositionScreen.x - 15, bulletPositionScreen.y - 25, 0);
-				}
-				else
-				{
-					tmpSurface = _res->getSurfaceSet("SMOKE.PCK")->getFrame((*i)->getCurrentFrame());
-					tmpSurface->blitNShade(surface, bulletPositionScreen.x - 15, bulletPositionScreen.y - 15, 0);
-				}
-			}
-		}
-	}
-	surface->unlock();
 }
 
 /**
@@ -1367,8 +1515,9 @@ void Map::getSelectorPosition(Position *pos) const
  * Calculates the offset of a soldier, when it is walking in the middle of 2 tiles.
  * @param unit Pointer to BattleUnit.
  * @param offset Pointer to the offset to return the calculation.
+ * @param updateFloor Also update whether the unit is under a floor? Only one of the threads drawing a frame does it.
  */
-void Map::calculateWalkingOffset(BattleUnit *unit, Position *offset)
+void Map::calculateWalkingOffset(BattleUnit *unit, Position *offset, bool updateFloor)
 {
 	int offsetX[8] = { 1, 1, 1, 0, -1, -1, -1, 0 };
 	int offsetY[8] = { 1, 0, -1, -1, -1, 0, 1, 1 };
@@ -1456,7 +1605,7 @@ void Map::calculateWalkingOffset(BattleUnit *unit, Position *offset)
 				offset->x = -16;
 			}
 		}
-		if (_save->getDepth() > 0)
+		if (_save->getDepth() > 0 && updateFloor)
 		{
 			unit->setFloorAbove(false);
 
@@ -1541,30 +1690,43 @@ void Map::cacheUnits()
  */
 void Map::cacheUnit(BattleUnit *unit)
 {
-	UnitSprite *unitSprite = new UnitSprite(unit->getStatus() == STATUS_AIMING ? _spriteWidth * 2: _spriteWidth, _spriteHeight, 0, 0, _save->getDepth() != 0);
-	unitSprite->setPalette(this->getPalette());
 	bool invalid, dummy;
+	unit->getCache(&invalid);
+	if (!invalid)
+	{
+		return;
+	}
+
+	UnitSprite *unitSprite = 0;
+	int width = unit->getStatus() == STATUS_AIMING ? _spriteWidth * 2: _spriteWidth;
 	int numOfParts = unit->getArmor()->getSize() * unit->getArmor()->getSize();
+	BattleItem *rhandItem = unit->getItem("STR_RIGHT_HAND");
+	BattleItem *lhandItem = unit->getItem("STR_LEFT_HAND");
 
-	unit->getCache(&invalid);
-	if (invalid)
+	// 1 or 4 iterations, depending on unit size
+	for (int i = 0; i < numOfParts; i++)
 	{
-		// 1 or 4 iterations, depending on unit size
-		for (int i = 0; i < numOfParts; i++)
+		Surface *cache = unit->getCache(&dummy, i);
+		if (!cache) // no cache created yet
+		{
+			cache = new Surface(_spriteWidth, _spriteHeight);
+			cache->setPalette(this->getPalette());
+		}
+
+		cache->setWidth(width);
+
+		// units that look the same share their sprites
+		UnitSpriteKey key(unit, i, rhandItem, lhandItem, _animFrame, _save->getDepth() != 0, width);
+		if (!_unitSprites->get(key, cache))
 		{
-			Surface *cache = unit->getCache(&dummy, i);
-			if (!cache) // no cache created yet
+			if (!unitSprite)
 			{
-				cache = new Surface(_spriteWidth, _spriteHeight);
-				cache->setPalette(this->getPalette());
+				unitSprite = new UnitSprite(width, _spriteHeight, 0, 0, _save->getDepth() != 0);
+				unitSprite->setPalette(this->getPalette());
 			}
 
-			cache->setWidth(unitSprite->getWidth());
-
 			unitSprite->setBattleUnit(unit, i);
 
-			BattleItem *rhandItem = unit->getItem("STR_RIGHT_HAND");
-			BattleItem *lhandItem = unit->getItem("STR_LEFT_HAND");
 			if (rhandItem && !rhandItem->getRules()->isFixed())
 			{
 				unitSprite->setBattleItem(rhandItem);
@@ -1579,13 +1741,14 @@ void Map::cacheUnit(BattleUnit *unit)
 				unitSprite->setBattleItem(0);
 			}
 			unitSprite->setSurfaces(_res->getSurfaceSet(unit->getArmor()->getSpriteSheet()),
-									_res->getSurfaceSet("HANDOB.PCK"),
-									_res->getSurfaceSet("HANDOB2.PCK"));
+									_handObSet,
+									_handOb2Set);
 			unitSprite->setAnimationFrame(_animFrame);
 			cache->clear();
 			unitSprite->blit(cache);
-			unit->setCache(cache, i);
+			_unitSprites->add(key, cache);
 		}
+		unit->setCache(cache, i);
 	}
 	delete unitSprite;
 }
@@ -1778,4 +1941,24 @@ bool Map::getBlastFlash()
 	return _flashScreen;
 }
 
+/**
+ * Sets whether the tiles are drawn in bands of screen rows across the
+ * thread pool, or all at once on this thread. Both give the same frame.
+ * @param threaded Draw across the thread pool?
+ */
+void Map::setThreadedDrawing(bool threaded)
+{
+	_threadedDrawing = threaded;
+}
+
+/**
+ * Gets the cache the map keeps the sprites of units in, so units
+ * that look the same don't have to be drawn again.
+ * @return Pointer to the cache.
+ */
+UnitSpriteCache *Map::getUnitSpriteCache() const
+{
+	return _unitSprites;
+}
+
 }
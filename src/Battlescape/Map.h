@@ -39,6 +39,16 @@ class BattlescapeMessage;
 class Camera;
 class Timer;
 class Text;
+class NumberText;
+class UnitSpriteCache;
+
+/// The part of the map shown in a frame, worked out before the tiles are drawn.
+struct MapDrawArea
+{
+	int width, height;
+	int beginX, endX, beginY, endY, beginZ, endZ;
+	int bulletLowX, bulletLowY, bulletHighX, bulletHighY;
+};
 
 enum CursorType { CT_NONE, CT_NORMAL, CT_AIM, CT_PSI, CT_WAYPOINT, CT_THROW };
 /**
@@ -49,6 +59,8 @@ class Map : public InteractiveSurface
 private:
 	static const int SCROLL_INTERVAL = 15;
 	static const int BULLET_SPRITES = 35;
+	static const int MIN_BAND_HEIGHT = 32;
+	static const int UNIT_SPRITE_CACHE_SIZE = 1024;
 	Timer *_scrollMouseTimer, *_scrollKeyTimer;
 	Game *_game;
 	SavedBattleGame *_save;
@@ -71,9 +83,20 @@ private:
 	bool _unitDying, _smoothCamera, _smoothingEngaged, _flashScreen;
 	PathPreview _previewSetting;
 	Text *_txtAccuracy;
-	SurfaceSet *_projectileSet;
+	SurfaceSet *_projectileSet, *_cursorSet, *_smokeSet, *_hitSet, *_explosionSet, *_floorObSet, *_breathSet, *_pathfindingSet, *_handObSet, *_handOb2Set;
+
+	bool _threadedDrawing;
+	std::vector<Surface*> _bands;
+	UnitSpriteCache *_unitSprites;
 
 	void drawTerrain(Surface *surface);
+	/// Draws the tiles onto a band of screen rows.
+	void drawTiles(Surface *surface, int top, const MapDrawArea &area);
+	/// Creates the numbers for waypoints and the path preview.
+	NumberText *newWaypointNumbers();
+	/// Works out the accuracy shown on the aiming cursor.
+	void updateAccuracy(const Position &target);
+	friend class DrawBandJob;
 	int getTerrainLevel(Position pos, int size);
 	int _iconHeight, _iconWidth, _messageColor;
 	const std::vector<Uint8> *_transparencies;
@@ -107,7 +130,7 @@ public:
 	/// Gets the currently selected position.
 	void getSelectorPosition(Position *pos) const;
 	/// Calculates the offset of a soldier, when it is walking in the middle of 2 tiles.
-	void calculateWalkingOffset(BattleUnit *unit, Position *offset);
+	void calculateWalkingOffset(BattleUnit *unit, Position *offset, bool updateFloor = true);
 	/// Sets the 3D cursor type.
 	void setCursorType(CursorType type, int size = 1);
 	/// Gets the 3D cursor type.
@@ -154,6 +177,10 @@ public:
 	void setBlastFlash(bool flash);
 	/// Check if the screen is flashing this.
 	bool getBlastFlash();
+	/// Sets whether the map is drawn across the thread pool.
+	void setThreadedDrawing(bool threaded);
+	/// Gets the cache of composed unit sprites.
+	UnitSpriteCache *getUnitSpriteCache() const;
 };
 
 }
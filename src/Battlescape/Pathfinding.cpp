@@ -17,9 +17,9 @@
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <list>
+#include <math.h>
 #include "Pathfinding.h"
-#include "PathfindingNode.h"
-#include "PathfindingOpenSet.h"
+#include "PathfindingHierarchy.h"
 #include "../Savegame/SavedBattleGame.h"
 #include "../Savegame/Tile.h"
 #include "../Ruleset/Armor.h"
@@ -35,6 +35,27 @@
 namespace OpenXcom
 {
 
+/**
+ * Orders node indices by the TU cost of the nodes.
+ */
+class MinNodeCosts
+{
+private:
+	const std::vector<int> *_costs;
+public:
+	MinNodeCosts(const std::vector<int> *costs) : _costs(costs) { }
+	/**
+	 * Compares nodes @a a and @a b.
+	 * @param a Index of first node.
+	 * @param b Index of second node.
+	 * @return True if node @a a must come before @a b.
+	 */
+	bool operator()(int a, int b) const
+	{
+		return (*_costs)[a] < (*_costs)[b];
+	}
+};
+
 int Pathfinding::red = 3;
 int Pathfinding::yellow = 10;
 int Pathfinding::green = 4;
@@ -43,36 +64,127 @@ int Pathfinding::green = 4;
  * Sets up a Pathfinding.
  * @param save pointer to SavedBattleGame object.
  */
-Pathfinding::Pathfinding(SavedBattleGame *save) : _save(save), _unit(0), _pathPreviewed(false), _strafeMove(false), _totalTUCost(0), _modifierUsed(false), _movementType(MT_WALK)
+Pathfinding::Pathfinding(SavedBattleGame *save) : _save(save), _generation(0), _nodesChecked(0), _unit(0), _pathPreviewed(false), _strafeMove(false), _totalTUCost(0), _modifierUsed(false), _movementType(MT_WALK)
 {
 	_size = _save->getMapSizeXYZ();
 	// Initialize one node per tile
-	_nodes.reserve(_size);
-	Position p;
+	_nodePos.resize(_size);
 	for (int i = 0; i < _size; ++i)
 	{
-		_save->getTileCoords(i, &p.x, &p.y, &p.z);
-		_nodes.push_back(PathfindingNode(p));
+		_save->getTileCoords(i, &_nodePos[i].x, &_nodePos[i].y, &_nodePos[i].z);
 	}
+	_nodeVisited.resize(_size, 0);
+	_nodeChecked.resize(_size, 0);
+	_nodeTUCost.resize(_size, 0);
+	_nodeTUGuess.resize(_size, 0);
+	_nodePrev.resize(_size, -1);
+	_nodePrevDir.resize(_size, 0);
+	_nodeOpenEntry.resize(_size, -1);
+	_stepGraphs.resize(2 * 4 * 2);
+	_hierarchy = new PathfindingHierarchy(_save, this);
 }
 
 /**
  * Deletes the Pathfinding.
- * @internal This is required to be here because it requires the PathfindingNode class definition.
  */
 Pathfinding::~Pathfinding()
 {
-	// Nothing more to do here.
+	delete _hierarchy;
 }
 
 /**
  * Gets the Node on a given position on the map.
  * @param pos Position.
- * @return Pointer to node.
+ * @return Index of the node.
+ */
+int Pathfinding::getNode(const Position& pos) const
+{
+	return _save->getTileIndex(pos);
+}
+
+/**
+ * Starts a new search: bumps the generation, so every node
+ * counts as unvisited again, and empties the open set.
+ */
+void Pathfinding::startSearch()
+{
+	++_generation;
+	if (_generation == 0)
+	{
+		// the stamps wrapped around, old ones could look current
+		std::fill(_nodeVisited.begin(), _nodeVisited.end(), 0);
+		std::fill(_nodeChecked.begin(), _nodeChecked.end(), 0);
+		_generation = 1;
+	}
+	_openSet.clear();
+}
+
+/**
+ * Connects a node to the previous node along the path to @a target
+ * and updates the approximate cost to reach the target.
+ * @param node Index of the node.
+ * @param tuCost The total cost of the path so far.
+ * @param prevNode The previous node along the path.
+ * @param prevDir The direction FROM the previous node.
+ * @param target The target position (used to update our guess cost).
  */
-PathfindingNode *Pathfinding::getNode(const Position& pos)
+void Pathfinding::connect(int node, int tuCost, int prevNode, int prevDir, const Position &target)
 {
-	return &_nodes[_save->getTileIndex(pos)];
+	if (_nodeVisited[node] != _generation)
+	{
+		_nodeVisited[node] = _generation;
+		_nodeOpenEntry[node] = -1;
+	}
+	_nodeTUCost[node] = tuCost;
+	_nodePrev[node] = prevNode;
+	_nodePrevDir[node] = prevDir;
+	if (_nodeOpenEntry[node] == -1) // Otherwise we have this already.
+	{
+		Position d = target - _nodePos[node];
+		d *= d;
+		_nodeTUGuess[node] = 4 * sqrt((double)d.x + d.y + d.z);
+	}
+}
+
+/**
+ * Connects a node to the previous node along a visit.
+ * @param node Index of the node.
+ * @param tuCost The total cost of the path so far.
+ * @param prevNode The previous node along the path.
+ * @param prevDir The direction FROM the previous node.
+ */
+void Pathfinding::connect(int node, int tuCost, int prevNode, int prevDir)
+{
+	if (_nodeVisited[node] != _generation)
+	{
+		_nodeVisited[node] = _generation;
+		_nodeOpenEntry[node] = -1;
+	}
+	_nodeTUCost[node] = tuCost;
+	_nodePrev[node] = prevNode;
+	_nodePrevDir[node] = prevDir;
+	_nodeTUGuess[node] = 0;
+}
+
+/**
+ * Places a connected node in the open set, ordered by its cost plus its guess cost.
+ * @param node Index of the node.
+ */
+void Pathfinding::pushNode(int node)
+{
+	_openSet.push(node, _nodeTUCost[node] + _nodeTUGuess[node], _nodeOpenEntry[node]);
+}
+
+/**
+ * Takes the node with the least cost out of the open set.
+ * @return Index of the node.
+ */
+int Pathfinding::popNode()
+{
+	int node = _openSet.pop();
+	_nodeOpenEntry[node] = -1;
+	++_nodesChecked;
+	return node;
 }
 
 /**
@@ -174,6 +286,31 @@ void Pathfinding::calculate(BattleUnit *unit, Position endPosition, BattleUnit *
 	}
 }
 
+/**
+ * Calculates a path for an AI unit going far away. The route is planned
+ * over the map blocks first, and only the part the unit can walk this
+ * turn is searched exactly. Short paths, or any the hierarchy can't
+ * help with, are calculated as usual.
+ * @param unit Unit taking the path.
+ * @param endPosition The position we want to reach.
+ */
+void Pathfinding::calculateLongRange(BattleUnit *unit, Position endPosition)
+{
+	_movementType = unit->getMovementType();
+	_unit = unit;
+	Position waypoint;
+	if (unit->getArmor()->getSize() <= 2 && _save->getTile(endPosition) &&
+		_hierarchy->findWaypoint(unit, getStepGraphIndex(unit), unit->getPosition(), endPosition, unit->getTimeUnits(), waypoint))
+	{
+		calculate(unit, waypoint);
+		if (!_path.empty())
+		{
+			return;
+		}
+	}
+	calculate(unit, endPosition);
+}
+
 /**
  * Calculates the shortest path using a simple A-Star algorithm.
  * The unit information and movement type must have already been set.
@@ -187,51 +324,49 @@ void Pathfinding::calculate(BattleUnit *unit, Position endPosition, BattleUnit *
  */
 bool Pathfinding::aStarPath(const Position &startPosition, const Position &endPosition, BattleUnit *target, bool sneak, int maxTUCost)
 {
-	// reset every node, so we have to check them all
-	for (std::vector<PathfindingNode>::iterator it = _nodes.begin(); it != _nodes.end(); ++it)
-		it->reset();
+	startSearch();
 
 	// start position is the first one in our "open" list
-	PathfindingNode *start = getNode(startPosition);
-	start->connect(0, 0, 0, endPosition);
-	PathfindingOpenSet openList;
-	openList.push(start);
+	int start = getNode(startPosition);
+	connect(start, 0, -1, 0, endPosition);
+	pushNode(start);
 	bool missile = (target && maxTUCost == -1);
 	// if the open list is empty, we've reached the end
-	while (!openList.empty())
+	while (!_openSet.empty())
 	{
-		PathfindingNode *currentNode = openList.pop();
-		Position const &currentPos = currentNode->getPosition();
-		currentNode->setChecked();
+		int currentNode = popNode();
+		Position const &currentPos = _nodePos[currentNode];
+		_nodeChecked[currentNode] = _generation;
 		if (currentPos == endPosition) // We found our target.
 		{
 			_path.clear();
-			PathfindingNode *pf = currentNode;
-			while (pf->getPrevNode())
+			int pf = currentNode;
+			while (_nodePrev[pf] != -1)
 			{
-				_path.push_back(pf->getPrevDir());
-				pf = pf->getPrevNode();
+				_path.push_back(_nodePrevDir[pf]);
+				pf = _nodePrev[pf];
 			}
 			return true;
 		}
 
 		// Try all reachable neighbours.
+		const int currentCost = missile ? 0 : _nodeTUCost[currentNode];
 		for (int direction = 0; direction < 10; direction++)
 		{
 			Position nextPos;
-			int tuCost = getTUCost(currentPos, direction, &nextPos, _unit, target, missile);
+			int tuCost = target ? getTUCost(currentPos, direction, &nextPos, _unit, target, missile) : getStepCost(currentPos, direction, &nextPos, _unit);
 			if (tuCost >= 255) // Skip unreachable / blocked
 				continue;
 			if (sneak && _save->getTile(nextPos)->getVisible()) tuCost *= 2; // avoid being seen
-			PathfindingNode *nextNode = getNode(nextPos);
-			if (nextNode->isChecked()) // Our algorithm means this node is already at minimum cost.
+			int nextNode = getNode(nextPos);
+			if (isChecked(nextNode)) // Our algorithm means this node is already at minimum cost.
 				continue;
-			_totalTUCost = currentNode->getTUCost(missile) + tuCost;
+			_totalTUCost = currentCost + tuCost;
 			// If this node is unvisited or has only been visited from inferior paths...
-			if ((!nextNode->inOpenSet() || nextNode->getTUCost(missile) > _totalTUCost) && _totalTUCost <= maxTUCost)
+			if ((!inOpenSet(nextNode) || (missile ? 0 : _nodeTUCost[nextNode]) > _totalTUCost) && _totalTUCost <= maxTUCost)
 			{
-				nextNode->connect(_totalTUCost, currentNode, direction, endPosition);
-				openList.push(nextNode);
+				connect(nextNode, _totalTUCost, currentNode, direction, endPosition);
+				pushNode(nextNode);
 			}
 		}
 	}
@@ -252,6 +387,25 @@ bool Pathfinding::aStarPath(const Position &startPosition, const Position &endPo
  * @return TU cost or 255 if movement is impossible.
  */
 int Pathfinding::getTUCost(const Position &startPosition, int direction, Position *endPosition, BattleUnit *unit, BattleUnit *target, bool missile)
+{
+	return calculateTUCost(startPosition, direction, endPosition, unit, target, missile, 0);
+}
+
+/**
+ * Calculates the TU cost to move from 1 tile to the other (ONE STEP ONLY).
+ * When @a step is given, only the terrain part of the cost is worked out and
+ * stored there for the step graph: the per-part costs, leaving out fire, and
+ * the tiles whose units still have to be checked when the step is taken.
+ * @param startPosition The position to start from.
+ * @param direction The direction we are facing.
+ * @param endPosition The position we want to reach.
+ * @param unit The unit moving.
+ * @param target The target unit.
+ * @param missile Is this a guided missile?
+ * @param step Step graph entry to record into, or 0 for the full cost.
+ * @return TU cost or 255 if movement is impossible.
+ */
+int Pathfinding::calculateTUCost(const Position &startPosition, int direction, Position *endPosition, BattleUnit *unit, BattleUnit *target, bool missile, int *step)
 {
 	_unit = unit;
 	directionToVector(direction, endPosition);
@@ -265,9 +419,10 @@ int Pathfinding::getTUCost(const Position &startPosition, int direction, Positio
 	int numberOfPartsFalling = 0;
 	int numberOfPartsChangingHeight = 0;
 	int totalCost = 0;
+	int part = 0;
 
 	for (int x = 0; x <= size; ++x)
-		for (int y = 0; y <= size; ++y)
+		for (int y = 0; y <= size; ++y, ++part)
 		{
 			Position offset = Position (x, y, 0);
 			Tile *startTile = _save->getTile(startPosition + offset);
@@ -317,12 +472,19 @@ int Pathfinding::getTUCost(const Position &startPosition, int direction, Positio
 						fellDown = true;
 					}
 			}
-			else if (_movementType == MT_FLY && belowDestination && belowDestination->getUnit() && belowDestination->getUnit() != unit)
+			else if (_movementType == MT_FLY && belowDestination)
 			{
-				// 2 or more voxels poking into this tile = no go
-				if (belowDestination->getUnit()->getHeight() + belowDestination->getUnit()->getFloatHeight() - belowDestination->getTerrainLevel() > 26)
+				if (step)
 				{
-					return 255;
+					step[STEP_PARTS + part * 2 + 1] = _save->getTileIndex(belowDestination->getPosition());
+				}
+				else if (belowDestination->getUnit() && belowDestination->getUnit() != unit)
+				{
+					// 2 or more voxels poking into this tile = no go
+					if (belowDestination->getUnit()->getHeight() + belowDestination->getUnit()->getFloatHeight() - belowDestination->getTerrainLevel() > 26)
+					{
+						return 255;
+					}
 				}
 			}
 
@@ -398,7 +560,16 @@ int Pathfinding::getTUCost(const Position &startPosition, int direction, Positio
 				}
 			}
 			// check if the destination tile can be walked over
-			if (isBlocked(destinationTile, MapData::O_FLOOR, target) || isBlocked(destinationTile, MapData::O_OBJECT, target))
+			if (step)
+			{
+				// units standing there are only known when the step is taken
+				step[STEP_PARTS + part * 2] = _save->getTileIndex(destinationTile->getPosition());
+				if (isBlocked(destinationTile, MapData::O_OBJECT, target))
+				{
+					return 255;
+				}
+			}
+			else if (isBlocked(destinationTile, MapData::O_FLOOR, target) || isBlocked(destinationTile, MapData::O_OBJECT, target))
 			{
 				return 255;
 			}
@@ -430,6 +601,13 @@ int Pathfinding::getTUCost(const Position &startPosition, int direction, Positio
 				cost = (int)((double)cost * 1.5);
 			}
 			cost += wallcost;
+			if (step)
+			{
+				// fire and strafing are added when the step is taken
+				totalCost += cost;
+				cost = 0;
+				continue;
+			}
 			if (_unit->getFaction() == FACTION_HOSTILE &&
 				destinationTile->getFire() > 0)
 				cost += 32; // try to find a better path, but don't exclude this path entirely.
@@ -469,7 +647,8 @@ int Pathfinding::getTUCost(const Position &startPosition, int direction, Positio
 	// for bigger sized units, check the path between part 1,1 and part 0,0 at end position
 	if (size)
 	{
-		totalCost /= (size+1)*(size+1);
+		if (!step)
+			totalCost /= (size+1)*(size+1);
 		Tile *startTile = _save->getTile(*endPosition + Position(1,1,0));
 		Tile *destinationTile = _save->getTile(*endPosition);
 		int tmpDirection = 7;
@@ -483,12 +662,233 @@ int Pathfinding::getTUCost(const Position &startPosition, int direction, Positio
 			return 255;
 	}
 
+	if (step)
+	{
+		Position offset = *endPosition - startPosition;
+		step[STEP_END] = (offset.x + 1) + (offset.y + 1) * 3 + (offset.z + 1) * 9;
+	}
+
 	if (missile)
 		return 0;
 	else
 		return totalCost;
 }
 
+/**
+ * Gets the index of the step graph to use for a unit, which
+ * depends on its size and on the current movement type.
+ * @param unit The unit moving (at most 2x2).
+ * @return Index of the step graph.
+ */
+int Pathfinding::getStepGraphIndex(BattleUnit *unit) const
+{
+	return ((unit->getArmor()->getSize() - 1) * 4 + _movementType) * 2 + (unit->getMovementType() == MT_FLY ? 1 : 0);
+}
+
+/**
+ * Gets the entry of the step graph for a step of a unit, working out
+ * the terrain part of the step the first time it's needed.
+ * @param startPosition The position to start from.
+ * @param direction The direction we are facing.
+ * @param unit The unit moving (at most 2x2).
+ * @param terrainCost Returns the summed terrain cost of all the unit's parts, STEP_BLOCKED if blocked.
+ * @return Pointer to the step graph entry.
+ */
+int *Pathfinding::getStep(const Position &startPosition, int direction, BattleUnit *unit, int &terrainCost)
+{
+	const int size = unit->getArmor()->getSize();
+	const int stride = STEP_PARTS + size * size * 2;
+	std::vector<int> &graph = _stepGraphs[getStepGraphIndex(unit)];
+	if (graph.empty())
+	{
+		graph.resize(_size * 10 * stride, STEP_UNKNOWN);
+	}
+	int *step = &graph[(getNode(startPosition) * 10 + direction) * stride];
+
+	terrainCost = step[STEP_COST];
+	if (terrainCost == STEP_UNKNOWN)
+	{
+		for (int i = STEP_END; i < stride; ++i)
+		{
+			step[i] = -1;
+		}
+		Position endPosition;
+		terrainCost = calculateTUCost(startPosition, direction, &endPosition, unit, 0, false, step);
+		if (step[STEP_END] == -1)
+		{
+			// the end is only recorded if the step can be taken
+			terrainCost = STEP_BLOCKED;
+		}
+		// half open ufo doors change their cost as they animate, don't keep those
+		if (!isNearOpeningDoor(startPosition, size))
+		{
+			step[STEP_COST] = terrainCost;
+		}
+	}
+	return step;
+}
+
+/**
+ * Gets the TU cost to move from 1 tile to the other during a search.
+ * The terrain part of the cost comes from the step graph of the unit's size
+ * and movement type, worked out the first time the step is needed. Only the
+ * units and fires around the destination are checked every time.
+ * Must give the same result as getTUCost() whenever that is below 255.
+ * @param startPosition The position to start from.
+ * @param direction The direction we are facing.
+ * @param endPosition The position we want to reach.
+ * @param unit The unit moving.
+ * @return TU cost or 255 if movement is impossible.
+ */
+int Pathfinding::getStepCost(const Position &startPosition, int direction, Position *endPosition, BattleUnit *unit)
+{
+	const int size = unit->getArmor()->getSize();
+	if (size > 2 || (Options::strafe && _strafeMove))
+	{
+		return calculateTUCost(startPosition, direction, endPosition, unit, 0, false, 0);
+	}
+	_unit = unit;
+
+	int terrainCost;
+	const int *step = getStep(startPosition, direction, unit, terrainCost);
+	if (terrainCost == STEP_BLOCKED)
+	{
+		return 255;
+	}
+	return finishStepCost(terrainCost, step, size * size, startPosition, endPosition);
+}
+
+/**
+ * Gets the TU cost of one step over the bare terrain, leaving out
+ * units and fire. Used to plan routes ahead of time.
+ * @param startPosition The position to start from.
+ * @param direction The direction we are facing.
+ * @param endPosition Returns the position reached.
+ * @param unit The unit moving (at most 2x2).
+ * @return TU cost or 255 if the terrain blocks the movement.
+ */
+int Pathfinding::getTerrainStepCost(const Position &startPosition, int direction, Position *endPosition, BattleUnit *unit)
+{
+	const int size = unit->getArmor()->getSize();
+	int terrainCost;
+	const int *step = getStep(startPosition, direction, unit, terrainCost);
+	if (terrainCost == STEP_BLOCKED)
+	{
+		return 255;
+	}
+	int end = step[STEP_END];
+	*endPosition = startPosition + Position(end % 3 - 1, (end / 3) % 3 - 1, end / 9 - 1);
+	return terrainCost / (size * size);
+}
+
+/**
+ * Finishes the cost of a step from the step graph by checking the units
+ * and fires at its destination.
+ * @param terrainCost Summed terrain cost of all the unit's parts.
+ * @param step Step graph entry.
+ * @param parts Number of parts of the unit.
+ * @param startPosition The position to start from.
+ * @param endPosition Returns the position reached.
+ * @return TU cost or 255 if movement is impossible.
+ */
+int Pathfinding::finishStepCost(int terrainCost, const int *step, int parts, const Position &startPosition, Position *endPosition)
+{
+	int totalCost = terrainCost;
+	for (int part = 0; part < parts; ++part)
+	{
+		Tile *destinationTile = _save->getTiles()[step[STEP_PARTS + part * 2]];
+		if (isBlocked(destinationTile, MapData::O_FLOOR, 0))
+		{
+			return 255;
+		}
+		if (step[STEP_PARTS + part * 2 + 1] != -1)
+		{
+			Tile *belowDestination = _save->getTiles()[step[STEP_PARTS + part * 2 + 1]];
+			BattleUnit *below = belowDestination->getUnit();
+			// 2 or more voxels poking into this tile = no go
+			if (below && below != _unit && below->getHeight() + below->getFloatHeight() - belowDestination->getTerrainLevel() > 26)
+			{
+				return 255;
+			}
+		}
+		if (_unit->getFaction() == FACTION_HOSTILE && destinationTile->getFire() > 0)
+			totalCost += 32; // try to find a better path, but don't exclude this path entirely.
+
+		// TFTD thing: tiles on fire are cost 2 TUs more for whatever reason.
+		if (_save->getDepth() > 0 && destinationTile->getFire() > 0)
+		{
+			totalCost += 2;
+		}
+	}
+	totalCost /= parts;
+
+	int end = step[STEP_END];
+	*endPosition = startPosition + Position(end % 3 - 1, (end / 3) % 3 - 1, end / 9 - 1);
+	return totalCost;
+}
+
+/**
+ * Checks if there's a ufo door that just started opening around a tile.
+ * Its walking cost drops once the door animates further, without the terrain
+ * being marked as changed.
+ * @param pos Position of the tile.
+ * @param size Size of the unit.
+ * @return True if a step from here can't be kept in the step graph.
+ */
+bool Pathfinding::isNearOpeningDoor(const Position &pos, int size) const
+{
+	for (int x = pos.x - 1; x <= pos.x + size; ++x)
+	{
+		for (int y = pos.y - 1; y <= pos.y + size; ++y)
+		{
+			for (int z = pos.z - 1; z <= pos.z + 1; ++z)
+			{
+				Tile *tile = _save->getTile(Position(x, y, z));
+				for (int part = 0; tile && part < 4; ++part)
+				{
+					if (tile->isUfoDoorOpening(part))
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
+
+/**
+ * Forgets the cached steps that start close enough to a tile
+ * to be affected by its terrain, and the chunks of the route planner around it.
+ * @param pos Position of the changed tile.
+ */
+void Pathfinding::invalidateSteps(const Position &pos)
+{
+	for (std::vector< std::vector<int> >::iterator graph = _stepGraphs.begin(); graph != _stepGraphs.end(); ++graph)
+	{
+		if (graph->empty())
+			continue;
+		const int stride = graph->size() / (_size * 10);
+		for (int x = pos.x - 3; x <= pos.x + 3; ++x)
+		{
+			for (int y = pos.y - 3; y <= pos.y + 3; ++y)
+			{
+				for (int z = pos.z - 2; z <= pos.z + 2; ++z)
+				{
+					Position start(x, y, z);
+					if (!_save->getTile(start))
+						continue;
+					for (int direction = 0; direction < 10; ++direction)
+					{
+						(*graph)[(getNode(start) * 10 + direction) * stride + STEP_COST] = STEP_UNKNOWN;
+					}
+				}
+			}
+		}
+	}
+	_hierarchy->invalidate(pos);
+}
+
 /**
  * Converts direction to a vector. Direction starts north = 0 and goes clockwise.
  * @param direction Source direction.
@@ -1120,52 +1520,44 @@ std::vector<int> Pathfinding::findReachable(BattleUnit *unit, int tuMax)
 {
 	const Position &start = unit->getPosition();
 	int energyMax = unit->getEnergy();
-	for (std::vector<PathfindingNode>::iterator it = _nodes.begin(); it != _nodes.end(); ++it)
-	{
-		it->reset();
-	}
-	PathfindingNode *startNode = getNode(start);
-	startNode->connect(0, 0, 0);
-	PathfindingOpenSet unvisited;
-	unvisited.push(startNode);
-	std::vector<PathfindingNode*> reachable;
-	while (!unvisited.empty())
+	startSearch();
+	int startNode = getNode(start);
+	connect(startNode, 0, -1, 0);
+	pushNode(startNode);
+	std::vector<int> reachable;
+	while (!_openSet.empty())
 	{
-		PathfindingNode *currentNode = unvisited.pop();
-		Position const &currentPos = currentNode->getPosition();
+		int currentNode = popNode();
+		Position const &currentPos = _nodePos[currentNode];
+		const int currentCost = _nodeTUCost[currentNode];
 
 		// Try all reachable neighbours.
 		for (int direction = 0; direction < 10; direction++)
 		{
 			Position nextPos;
-			int tuCost = getTUCost(currentPos, direction, &nextPos, unit, 0, false);
+			int tuCost = getStepCost(currentPos, direction, &nextPos, unit);
 			if (tuCost == 255) // Skip unreachable / blocked
 				continue;
-			if (currentNode->getTUCost(false) + tuCost > tuMax || 
-				(currentNode->getTUCost(false) + tuCost) / 2 > energyMax) // Run out of TUs/Energy
+			if (currentCost + tuCost > tuMax || 
+				(currentCost + tuCost) / 2 > energyMax) // Run out of TUs/Energy
 				continue;
-			PathfindingNode *nextNode = getNode(nextPos);
-			if (nextNode->isChecked()) // Our algorithm means this node is already at minimum cost.
+			int nextNode = getNode(nextPos);
+			if (isChecked(nextNode)) // Our algorithm means this node is already at minimum cost.
 				continue;
-			int totalTuCost = currentNode->getTUCost(false) + tuCost;
+			int totalTuCost = currentCost + tuCost;
 			// If this node is unvisited or visited from a better path.
-			if (!nextNode->inOpenSet() || nextNode->getTUCost(false) > totalTuCost)
+			if (!inOpenSet(nextNode) || _nodeTUCost[nextNode] > totalTuCost)
 			{
-				nextNode->connect(totalTuCost, currentNode, direction);
-				unvisited.push(nextNode);
+				connect(nextNode, totalTuCost, currentNode, direction);
+				pushNode(nextNode);
 			}
 		}
-		currentNode->setChecked();
+		_nodeChecked[currentNode] = _generation;
 		reachable.push_back(currentNode);
 	}
-	std::sort(reachable.begin(), reachable.end(), MinNodeCosts());
-	std::vector<int> tiles;
-	tiles.reserve(reachable.size());
-	for (std::vector<PathfindingNode*>::const_iterator it = reachable.begin(); it != reachable.end(); ++it)
-	{
-		tiles.push_back(_save->getTileIndex((*it)->getPosition()));
-	}
-	return tiles;
+	// the node indices are the tile indices
+	std::sort(reachable.begin(), reachable.end(), MinNodeCosts(&_nodeTUCost));
+	return reachable;
 }
 
 /**
@@ -21,7 +21,7 @@
 
 #include <vector>
 #include "Position.h"
-#include "PathfindingNode.h"
+#include "PathfindingOpenSet.h"
 #include "../Ruleset/MapData.h"
 
 namespace OpenXcom
@@ -30,6 +30,7 @@ namespace OpenXcom
 class SavedBattleGame;
 class Tile;
 class BattleUnit;
+class PathfindingHierarchy;
 
 /**
  * A utility class that calculates the shortest path between two points on the battlescape map.
@@ -38,8 +39,21 @@ class Pathfinding
 {
 private:
 	SavedBattleGame *_save;
-	std::vector<PathfindingNode> _nodes;
 	int _size;
+	// Search state of the nodes, one entry per tile. A node only counts as
+	// visited or checked if its stamp matches the current search generation,
+	// so nothing has to be reset between searches.
+	unsigned _generation;
+	std::vector<Position> _nodePos;
+	std::vector<unsigned> _nodeVisited, _nodeChecked;
+	std::vector<int> _nodeTUCost, _nodeTUGuess, _nodePrev, _nodePrevDir, _nodeOpenEntry;
+	PathfindingOpenSet _openSet;
+	size_t _nodesChecked;
+	// Step graphs: the terrain part of the TU cost of every step, per unit size and movement type.
+	std::vector< std::vector<int> > _stepGraphs;
+	static const int STEP_UNKNOWN = -1, STEP_BLOCKED = -2;
+	static const int STEP_COST = 0, STEP_END = 1, STEP_PARTS = 2;
+	PathfindingHierarchy *_hierarchy;
 	BattleUnit *_unit;
 	bool _pathPreviewed;
 	bool _strafeMove;
@@ -47,13 +61,44 @@ private:
 	bool _modifierUsed;
 	MovementType _movementType;
 	/// Gets the node at certain position.
-	PathfindingNode *getNode(const Position& pos);
+	int getNode(const Position& pos) const;
+	/// Starts a new search over the nodes.
+	void startSearch();
+	/// Is the node already at minimum cost?
+	bool isChecked(int node) const { return _nodeChecked[node] == _generation; }
+	/// Is the node in the open set?
+	bool inOpenSet(int node) const { return _nodeVisited[node] == _generation && _nodeOpenEntry[node] != -1; }
+
+	#ifdef __MORPHOS__
+	#undef connect
+	#endif
+
+	/// Connects a node to the previous node along a path.
+	void connect(int node, int tuCost, int prevNode, int prevDir, const Position &target);
+	/// Connects a node to the previous node along a visit.
+	void connect(int node, int tuCost, int prevNode, int prevDir);
+	/// Adds a node to the open set.
+	void pushNode(int node);
+	/// Takes the cheapest node out of the open set.
+	int popNode();
 	/// Determines whether a tile blocks a certain movementType.
 	bool isBlocked(Tile *tile, const int part, BattleUnit *missileTarget, int bigWallExclusion = -1);
 	/// Tries to find a straight line path between two positions.
 	bool bresenhamPath(const Position& origin, const Position& target, BattleUnit *missileTarget, bool sneak = false, int maxTUCost = 1000);
 	/// Tries to find a path between two positions.
 	bool aStarPath(const Position& origin, const Position& target, BattleUnit *missileTarget, bool sneak = false, int maxTUCost = 1000);
+	/// Calculates the TU cost of one step, or records its terrain part.
+	int calculateTUCost(const Position &startPosition, int direction, Position *endPosition, BattleUnit *unit, BattleUnit *target, bool missile, int *step);
+	/// Gets the index of the step graph for a unit.
+	int getStepGraphIndex(BattleUnit *unit) const;
+	/// Gets the step graph entry of a step, recording it if needed.
+	int *getStep(const Position &startPosition, int direction, BattleUnit *unit, int &terrainCost);
+	/// Gets the TU cost of one step during a search, using the step graph.
+	int getStepCost(const Position &startPosition, int direction, Position *endPosition, BattleUnit *unit);
+	/// Adds the unit and fire checks to a step from the step graph.
+	int finishStepCost(int terrainCost, const int *step, int parts, const Position &startPosition, Position *endPosition);
+	/// Checks if there's a ufo door that just started opening around a tile.
+	bool isNearOpeningDoor(const Position &pos, int size) const;
 	/// Determines whether a unit can fall down from this tile.
 	bool canFallDown(Tile *destinationTile);
 	/// Determines whether a unit can fall down from this tile.
@@ -77,6 +122,8 @@ public:
 	~Pathfinding();
 	/// Calculates the shortest path.
 	void calculate(BattleUnit *unit, Position endPosition, BattleUnit *missileTarget = 0, int maxTUCost = 1000);
+	/// Calculates the part of a long path the unit can walk this turn.
+	void calculateLongRange(BattleUnit *unit, Position endPosition);
 	/// Converts direction to a vector.
 	static void directionToVector(const int direction, Position *vector);
 	/// Converts a vector to a direction.
@@ -107,6 +154,12 @@ public:
 	bool isPathPreviewed() const;
 	/// Gets the modifier setting.
 	bool isModifierUsed() const;
+	/// Gets the TU cost of one step over the bare terrain.
+	int getTerrainStepCost(const Position &startPosition, int direction, Position *endPosition, BattleUnit *unit);
+	/// Forgets the cached step costs around a changed tile.
+	void invalidateSteps(const Position &pos);
+	/// Gets the number of nodes checked by all the searches so far.
+	size_t getNodesChecked() const { return _nodesChecked; }
 	/// Gets a reference to the path.
 	const std::vector<int> &getPath();
 	/// Makes a copy to the path.
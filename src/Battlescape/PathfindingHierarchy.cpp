@@ -0,0 +1,379 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <map>
+#include <queue>
+#include <set>
+#include <cmath>
+#include "PathfindingHierarchy.h"
+#include "Pathfinding.h"
+#include "../Savegame/SavedBattleGame.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Guesses the cost to walk between two positions, the same
+ * way the A* search of the pathfinding does.
+ * @param a First position.
+ * @param b Second position.
+ * @return Guessed TU cost.
+ */
+static int guessCost(const Position &a, const Position &b)
+{
+	Position d = b - a;
+	d *= d;
+	return 4 * sqrt((double)d.x + d.y + d.z);
+}
+
+/**
+ * Sets up the hierarchy. Nothing is built until it's needed.
+ * @param save Pointer to the battle.
+ * @param pf Pointer to the pathfinding, which gives the step costs.
+ */
+PathfindingHierarchy::PathfindingHierarchy(SavedBattleGame *save, Pathfinding *pf) : _save(save), _pf(pf)
+{
+	_chunksX = (_save->getMapSizeX() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	_chunksY = (_save->getMapSizeY() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	_graphs.resize(2 * 4 * 2);
+}
+
+/**
+ * Deletes the hierarchy.
+ */
+PathfindingHierarchy::~PathfindingHierarchy()
+{
+}
+
+/**
+ * Gets the index of the chunk a position is in.
+ * @param pos Position on the map.
+ * @return Chunk index.
+ */
+int PathfindingHierarchy::getChunkIndex(const Position &pos) const
+{
+	return pos.x / CHUNK_SIZE + (pos.y / CHUNK_SIZE) * _chunksX;
+}
+
+/**
+ * Marks the chunks around a changed tile for rebuilding. The chunks
+ * next to them go too, since they share the portals on their borders.
+ * @param pos Position of the changed tile.
+ */
+void PathfindingHierarchy::invalidate(const Position &pos)
+{
+	// same reach as the step graphs, plus the left/top part of a 2x2 unit
+	int minX = std::max(0, (pos.x - 4) / CHUNK_SIZE - 1);
+	int maxX = std::min(_chunksX - 1, (pos.x + 3) / CHUNK_SIZE + 1);
+	int minY = std::max(0, (pos.y - 4) / CHUNK_SIZE - 1);
+	int maxY = std::min(_chunksY - 1, (pos.y + 3) / CHUNK_SIZE + 1);
+	for (std::vector< std::vector<HierarchyChunk> >::iterator graph = _graphs.begin(); graph != _graphs.end(); ++graph)
+	{
+		if (graph->empty())
+			continue;
+		for (int cy = minY; cy <= maxY; ++cy)
+		{
+			for (int cx = minX; cx <= maxX; ++cx)
+			{
+				(*graph)[cx + cy * _chunksX].dirty = true;
+			}
+		}
+	}
+}
+
+/**
+ * Gets a chunk of the graph of a unit type, finding its portals
+ * and the routes between them if the chunk changed since last time.
+ * @param graph Index of the graph (same as the step graph).
+ * @param chunk Index of the chunk.
+ * @param unit The unit moving.
+ * @return Reference to the chunk.
+ */
+HierarchyChunk &PathfindingHierarchy::getChunk(int graph, int chunk, BattleUnit *unit)
+{
+	std::vector<HierarchyChunk> &chunks = _graphs[graph];
+	if (chunks.empty())
+	{
+		chunks.resize(_chunksX * _chunksY);
+	}
+	HierarchyChunk &c = chunks[chunk];
+	if (c.dirty)
+	{
+		c.portals.clear();
+		c.exits.clear();
+		c.exitCosts.clear();
+		for (int direction = 0; direction < 8; direction += 2)
+		{
+			addPortals(c, chunk % _chunksX, chunk / _chunksX, direction, unit);
+		}
+		size_t n = c.portals.size();
+		c.costs.assign(n * n, INT_MAX);
+		for (size_t i = 0; i < n; ++i)
+		{
+			searchChunk(chunk, c.portals[i], unit);
+			for (size_t j = 0; j < n; ++j)
+			{
+				c.costs[i * n + j] = getLocalCost(chunk, c.portals[j]);
+			}
+		}
+		c.dirty = false;
+	}
+	return c;
+}
+
+/**
+ * Adds a portal for every open stretch of a chunk border.
+ * A tile of the border is open if a unit can step across it both ways,
+ * so the chunks on either side always agree on their portals.
+ * @param chunk The chunk.
+ * @param cx X coordinate of the chunk.
+ * @param cy Y coordinate of the chunk.
+ * @param direction Side of the border (0, 2, 4 or 6).
+ * @param unit The unit moving.
+ */
+void PathfindingHierarchy::addPortals(HierarchyChunk &chunk, int cx, int cy, int direction, BattleUnit *unit)
+{
+	Position out;
+	Pathfinding::directionToVector(direction, &out);
+	int x0 = cx * CHUNK_SIZE, y0 = cy * CHUNK_SIZE;
+	int x1 = std::min(x0 + CHUNK_SIZE, _save->getMapSizeX()) - 1;
+	int y1 = std::min(y0 + CHUNK_SIZE, _save->getMapSizeY()) - 1;
+	Position first, along;
+	switch (direction)
+	{
+	case 0: first = Position(x0, y0, 0); along = Position(1, 0, 0); break;
+	case 2: first = Position(x1, y0, 0); along = Position(0, 1, 0); break;
+	case 4: first = Position(x0, y1, 0); along = Position(1, 0, 0); break;
+	default: first = Position(x0, y0, 0); along = Position(0, 1, 0); break;
+	}
+	if (!_save->getTile(first + out))
+		return; // edge of the map
+	int length = along.x ? x1 - x0 + 1 : y1 - y0 + 1;
+	for (int z = 0; z < _save->getMapSizeZ(); ++z)
+	{
+		first.z = z;
+		int runStart = -1;
+		for (int i = 0; i <= length; ++i)
+		{
+			bool open = false;
+			if (i < length)
+			{
+				Position inside = first + along * i;
+				Position end, back;
+				open = _pf->getTerrainStepCost(inside, direction, &end, unit) < 255 && end == inside + out &&
+					_pf->getTerrainStepCost(end, (direction + 4) % 8, &back, unit) < 255 && back == inside;
+			}
+			if (open && runStart == -1)
+			{
+				runStart = i;
+			}
+			else if (!open && runStart != -1)
+			{
+				Position portal = first + along * ((runStart + i - 1) / 2);
+				Position exit;
+				chunk.exitCosts.push_back(_pf->getTerrainStepCost(portal, direction, &exit, unit));
+				chunk.portals.push_back(portal);
+				chunk.exits.push_back(exit);
+				runStart = -1;
+			}
+		}
+	}
+}
+
+/**
+ * Works out the cheapest way from a position to every tile of its
+ * chunk over the bare terrain, without leaving the chunk.
+ * @param chunk Index of the chunk.
+ * @param origin The position to start from.
+ * @param unit The unit moving.
+ */
+void PathfindingHierarchy::searchChunk(int chunk, const Position &origin, BattleUnit *unit)
+{
+	int x0 = (chunk % _chunksX) * CHUNK_SIZE, y0 = (chunk / _chunksX) * CHUNK_SIZE;
+	int x1 = std::min(x0 + CHUNK_SIZE, _save->getMapSizeX()) - 1;
+	int y1 = std::min(y0 + CHUNK_SIZE, _save->getMapSizeY()) - 1;
+	const int layer = CHUNK_SIZE * CHUNK_SIZE;
+	_localCosts.assign(layer * _save->getMapSizeZ(), INT_MAX);
+
+	std::priority_queue< std::pair<int, int>, std::vector< std::pair<int, int> >, std::greater< std::pair<int, int> > > open;
+	int start = (origin.x - x0) + (origin.y - y0) * CHUNK_SIZE + origin.z * layer;
+	_localCosts[start] = 0;
+	open.push(std::make_pair(0, start));
+	while (!open.empty())
+	{
+		int cost = open.top().first;
+		int index = open.top().second;
+		open.pop();
+		if (cost > _localCosts[index])
+			continue; // already got there cheaper
+		Position pos(x0 + index % CHUNK_SIZE, y0 + (index / CHUNK_SIZE) % CHUNK_SIZE, index / layer);
+		for (int direction = 0; direction < 10; ++direction)
+		{
+			Position next;
+			int step = _pf->getTerrainStepCost(pos, direction, &next, unit);
+			if (step >= 255 || next.x < x0 || next.x > x1 || next.y < y0 || next.y > y1)
+				continue;
+			int nextIndex = (next.x - x0) + (next.y - y0) * CHUNK_SIZE + next.z * layer;
+			if (cost + step < _localCosts[nextIndex])
+			{
+				_localCosts[nextIndex] = cost + step;
+				open.push(std::make_pair(cost + step, nextIndex));
+			}
+		}
+	}
+}
+
+/**
+ * Gets the cost to reach a position found by the last chunk search.
+ * @param chunk Index of the chunk searched.
+ * @param pos Position in the chunk.
+ * @return TU cost, or INT_MAX if it can't be reached.
+ */
+int PathfindingHierarchy::getLocalCost(int chunk, const Position &pos) const
+{
+	int x0 = (chunk % _chunksX) * CHUNK_SIZE, y0 = (chunk / _chunksX) * CHUNK_SIZE;
+	return _localCosts[(pos.x - x0) + (pos.y - y0) * CHUNK_SIZE + pos.z * CHUNK_SIZE * CHUNK_SIZE];
+}
+
+/**
+ * Plans a route over the portals and picks the first portal along it
+ * that is out of reach this turn. An exact search to that portal gives
+ * the part of the route the unit will actually walk. Units and fire are
+ * left out, and the cost from the portals to the goal is taken the other
+ * way round, so the route is only a guide.
+ * @param unit The unit moving.
+ * @param graph Index of the graph of the unit (same as the step graph).
+ * @param start The position to start from.
+ * @param goal The position we want to reach.
+ * @param tuMax Time units the unit can spend this turn.
+ * @param waypoint Returns the position to walk to this turn.
+ * @return True if a waypoint was found, false if the route is short or there is none.
+ */
+bool PathfindingHierarchy::findWaypoint(BattleUnit *unit, int graph, const Position &start, const Position &goal, int tuMax, Position &waypoint)
+{
+	// short routes are left to the exact search
+	if (abs(start.x / CHUNK_SIZE - goal.x / CHUNK_SIZE) <= 1 && abs(start.y / CHUNK_SIZE - goal.y / CHUNK_SIZE) <= 1)
+		return false;
+
+	typedef std::pair<int, int> PortalId; // chunk, portal
+	const int startChunk = getChunkIndex(start), goalChunk = getChunkIndex(goal);
+	std::vector<int> startCosts, goalCosts;
+	HierarchyChunk &first = getChunk(graph, startChunk, unit);
+	searchChunk(startChunk, start, unit);
+	for (std::vector<Position>::const_iterator i = first.portals.begin(); i != first.portals.end(); ++i)
+	{
+		startCosts.push_back(getLocalCost(startChunk, *i));
+	}
+	HierarchyChunk &last = getChunk(graph, goalChunk, unit);
+	searchChunk(goalChunk, goal, unit);
+	for (std::vector<Position>::const_iterator i = last.portals.begin(); i != last.portals.end(); ++i)
+	{
+		goalCosts.push_back(getLocalCost(goalChunk, *i));
+	}
+
+	std::map<PortalId, int> best;
+	std::map<PortalId, PortalId> prev;
+	std::set<PortalId> checked;
+	std::priority_queue< std::pair<int, PortalId>, std::vector< std::pair<int, PortalId> >, std::greater< std::pair<int, PortalId> > > open;
+	const PortalId none(-1, -1);
+	for (size_t i = 0; i < startCosts.size(); ++i)
+	{
+		if (startCosts[i] == INT_MAX)
+			continue;
+		PortalId id(startChunk, i);
+		best[id] = startCosts[i];
+		prev[id] = none;
+		open.push(std::make_pair(startCosts[i] + guessCost(first.portals[i], goal), id));
+	}
+	int goalCost = INT_MAX;
+	PortalId goalPortal = none;
+	while (!open.empty())
+	{
+		if (open.top().first >= goalCost)
+			break; // nothing left can beat the route found
+		PortalId id = open.top().second;
+		open.pop();
+		if (!checked.insert(id).second)
+			continue;
+		const int cost = best[id];
+		HierarchyChunk &chunk = getChunk(graph, id.first, unit);
+		const int portal = id.second;
+		if (id.first == goalChunk && goalCosts[portal] != INT_MAX && cost + goalCosts[portal] < goalCost)
+		{
+			goalCost = cost + goalCosts[portal];
+			goalPortal = id;
+		}
+
+		// the other portals of the chunk, and the portal across the border
+		std::vector< std::pair<PortalId, int> > links;
+		const size_t n = chunk.portals.size();
+		for (size_t j = 0; j < n; ++j)
+		{
+			if ((int)j != portal && chunk.costs[portal * n + j] != INT_MAX)
+			{
+				links.push_back(std::make_pair(PortalId(id.first, j), chunk.costs[portal * n + j]));
+			}
+		}
+		const int nextChunk = getChunkIndex(chunk.exits[portal]);
+		HierarchyChunk &neighbour = getChunk(graph, nextChunk, unit);
+		for (size_t j = 0; j < neighbour.portals.size(); ++j)
+		{
+			if (neighbour.portals[j] == chunk.exits[portal] && neighbour.exits[j] == chunk.portals[portal])
+			{
+				links.push_back(std::make_pair(PortalId(nextChunk, j), chunk.exitCosts[portal]));
+				break;
+			}
+		}
+		for (std::vector< std::pair<PortalId, int> >::const_iterator i = links.begin(); i != links.end(); ++i)
+		{
+			if (checked.find(i->first) != checked.end())
+				continue;
+			std::map<PortalId, int>::iterator known = best.find(i->first);
+			if (known == best.end() || known->second > cost + i->second)
+			{
+				best[i->first] = cost + i->second;
+				prev[i->first] = id;
+				const Position &pos = getChunk(graph, i->first.first, unit).portals[i->first.second];
+				open.push(std::make_pair(cost + i->second + guessCost(pos, goal), i->first));
+			}
+		}
+	}
+	if (goalPortal == none)
+		return false;
+
+	std::vector<PortalId> route;
+	for (PortalId id = goalPortal; id != none; id = prev[id])
+	{
+		route.push_back(id);
+	}
+	for (std::vector<PortalId>::reverse_iterator i = route.rbegin(); i != route.rend(); ++i)
+	{
+		if (best[*i] > tuMax)
+		{
+			waypoint = getChunk(graph, i->first, unit).portals[i->second];
+			return true;
+		}
+	}
+	// the whole route fits in this turn
+	return false;
+}
+
+}
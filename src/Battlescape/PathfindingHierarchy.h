@@ -0,0 +1,85 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_PATHFINDINGHIERARCHY_H
+#define OPENXCOM_PATHFINDINGHIERARCHY_H
+
+#include <vector>
+#include "Position.h"
+
+namespace OpenXcom
+{
+
+class SavedBattleGame;
+class Pathfinding;
+class BattleUnit;
+
+/**
+ * One map block of the abstract graph: the portals on its borders,
+ * the step out of the block from each portal, and the cost to walk
+ * between every pair of portals without leaving the block.
+ */
+struct HierarchyChunk
+{
+	bool dirty;
+	std::vector<Position> portals, exits;
+	std::vector<int> exitCosts, costs;
+	HierarchyChunk() : dirty(true) { }
+};
+
+/**
+ * A coarse layer over the pathfinding, used to plan long routes.
+ * The map is cut into chunks the size of the map blocks. Every open
+ * stretch of a chunk border becomes a portal, and the routes between
+ * the portals of a chunk are worked out once from the terrain step costs.
+ * Long routes are then planned over the portals, so only the part
+ * the unit can walk this turn needs an exact search.
+ */
+class PathfindingHierarchy
+{
+private:
+	static const int CHUNK_SIZE = 10;
+	SavedBattleGame *_save;
+	Pathfinding *_pf;
+	int _chunksX, _chunksY;
+	std::vector< std::vector<HierarchyChunk> > _graphs;
+	std::vector<int> _localCosts;
+	/// Gets the index of the chunk holding a position.
+	int getChunkIndex(const Position &pos) const;
+	/// Gets a chunk of a graph, building it if needed.
+	HierarchyChunk &getChunk(int graph, int chunk, BattleUnit *unit);
+	/// Adds the portals on one border of a chunk.
+	void addPortals(HierarchyChunk &chunk, int cx, int cy, int direction, BattleUnit *unit);
+	/// Gets the cost of the steps from a position to everywhere in its chunk.
+	void searchChunk(int chunk, const Position &origin, BattleUnit *unit);
+	/// Gets the cost found by the last chunk search to reach a position.
+	int getLocalCost(int chunk, const Position &pos) const;
+public:
+	/// Creates the hierarchy for a battle.
+	PathfindingHierarchy(SavedBattleGame *save, Pathfinding *pf);
+	/// Cleans up the hierarchy.
+	~PathfindingHierarchy();
+	/// Forgets the chunks around a changed tile.
+	void invalidate(const Position &pos);
+	/// Picks where a long route should get to this turn.
+	bool findWaypoint(BattleUnit *unit, int graph, const Position &start, const Position &goal, int tuMax, Position &waypoint);
+};
+
+}
+
+#endif
@@ -17,23 +17,27 @@
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <assert.h>
+#include <algorithm>
 #include "PathfindingOpenSet.h"
-#include "PathfindingNode.h"
 
 namespace OpenXcom
 {
 
 /**
- * Cleans up all the entries still in set.
+ * Creates an empty set.
  */
-PathfindingOpenSet::~PathfindingOpenSet()
+PathfindingOpenSet::PathfindingOpenSet()
 {
-	while (!_queue.empty())
-	{
-		OpenSetEntry *entry = _queue.top();
-		_queue.pop();
-		delete entry;
-	}
+}
+
+/**
+ * Removes all the entries from the set.
+ * The memory they used is kept, so later searches don't have to allocate.
+ */
+void PathfindingOpenSet::clear()
+{
+	_entries.clear();
+	_heap.clear();
 }
 
 /**
@@ -41,48 +45,49 @@ PathfindingOpenSet::~PathfindingOpenSet()
  */
 void PathfindingOpenSet::removeDiscarded()
 {
-	while (!_queue.empty() && !_queue.top()->_node)
+	while (!_heap.empty() && _entries[_heap.front()]._node == -1)
 	{
-		OpenSetEntry *entry = _queue.top();
-		_queue.pop();
-		delete entry;
+		std::pop_heap(_heap.begin(), _heap.end(), EntryCompare(&_entries));
+		_heap.pop_back();
 	}
 }
 
 /**
  * Gets the node with the least cost.
  * After this call, the node is no longer in the set. It is an error to call this when the set is empty.
- * @return A pointer to the node which had the least cost.
+ * @return The index of the node which had the least cost.
  */
-PathfindingNode *PathfindingOpenSet::pop()
+int PathfindingOpenSet::pop()
 {
 	assert(!empty());
-	OpenSetEntry *entry = _queue.top();
-	PathfindingNode *nd = entry->_node;
-	_queue.pop();
-	delete entry;
-	nd->_openentry = 0;
+	int node = _entries[_heap.front()]._node;
+	std::pop_heap(_heap.begin(), _heap.end(), EntryCompare(&_entries));
+	_heap.pop_back();
 
 	// Discarded entries might be visible now.
 	removeDiscarded();
-	return nd;
+	return node;
 }
 
 /**
  * Places the node in the set.
  * If the node was already in the set, the previous entry is discarded.
  * It is the caller's responsibility to never re-add a node with a worse cost.
- * @param node A pointer to the node to add.
+ * @param node The index of the node to add.
+ * @param cost The cost used to order the node.
+ * @param openEntry The node's current entry in the set (-1 if none), updated to the new one.
  */
-void PathfindingOpenSet::push(PathfindingNode *node)
+void PathfindingOpenSet::push(int node, int cost, int &openEntry)
 {
-	OpenSetEntry *entry = new OpenSetEntry;
-	entry->_node = node;
-	entry->_cost = node->getTUCost(false) + node->getTUGuess();
-	if (node->_openentry)
-		node->_openentry->_node = 0;
-	node->_openentry = entry;
-	_queue.push(entry);
+	OpenSetEntry entry;
+	entry._node = node;
+	entry._cost = cost;
+	if (openEntry != -1)
+		_entries[openEntry]._node = -1;
+	openEntry = _entries.size();
+	_entries.push_back(entry);
+	_heap.push_back(openEntry);
+	std::push_heap(_heap.begin(), _heap.end(), EntryCompare(&_entries));
 }
 
 
@@ -19,54 +19,57 @@
 #ifndef OPENXCOM_PATHFINDINGOPENSET_H
 #define OPENXCOM_PATHFINDINGOPENSET_H
 
-#include <queue>
+#include <vector>
 
 namespace OpenXcom
 {
 
-class PathfindingNode;
-
 struct OpenSetEntry
 {
 	int _cost;
-	PathfindingNode *_node;
+	int _node;
 };
 
-/**
- * Helper class to compare entries through pointers.
- */
 class EntryCompare
 {
+private:
+	const std::vector<OpenSetEntry> *_entries;
 public:
+	EntryCompare(const std::vector<OpenSetEntry> *entries) : _entries(entries) { }
 	/**
-	 * Compares entries @a *a and @a *b.
-	 * @param a Pointer to first entry.
-	 * @param b Pointer to second entry.
-	 * @return True if entry @a *b must come before @a *a.
+	 * Compares entries @a a and @a b.
+	 * @param a Index of first entry.
+	 * @param b Index of second entry.
+	 * @return True if entry @a b must come before @a a.
 	 */
-	bool operator()(OpenSetEntry *a, OpenSetEntry *b) const
+	bool operator()(int a, int b) const
 	{
-		return b->_cost < a->_cost;
+		return (*_entries)[b]._cost < (*_entries)[a]._cost;
 	}
 };
 
 /**
- * A class that holds references to the nodes to be examined in pathfinding.
+ * Priority queue of the nodes to check during a path search.
+ * Nodes are referred to by their index, and the entries live in
+ * a pool that keeps its memory between searches.
  */
 class PathfindingOpenSet
 {
 public:
-	/// Cleans up the set and frees allocated memory.
-	~PathfindingOpenSet();
+	/// Creates an empty set.
+	PathfindingOpenSet();
+	/// Empties the set, keeping its memory for the next search.
+	void clear();
 	/// Gets the next node to check.
-	PathfindingNode *pop();
+	int pop();
 	/// Adds a node to the set.
-	void push(PathfindingNode *node);
+	void push(int node, int cost, int &openEntry);
 	/// Is the set empty?
-	bool empty() const { return _queue.empty(); }
+	bool empty() const { return _heap.empty(); }
 
 private:
-	std::priority_queue<OpenSetEntry*, std::vector<OpenSetEntry*>, EntryCompare> _queue;
+	std::vector<OpenSetEntry> _entries;
+	std::vector<int> _heap;
 
 	/// Removes reachable discarded entries.
 	void removeDiscarded();
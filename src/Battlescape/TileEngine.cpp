@@ -18,6 +18,8 @@
  */
 #define _USE_MATH_DEFINES
 #include <assert.h>
+#include <algorithm>
+#include <iterator>
 #include <cmath>
 #include <climits>
 #include <set>
@@ -50,8 +52,14 @@
 #include "ProjectileFlyBState.h"
 #include "MeleeAttackBState.h"
 #include "../Engine/Logger.h"
+#include "../Engine/ThreadPool.h"
 #include "../fmath.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TILEENGINE_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace OpenXcom
 {
 
@@ -62,7 +70,7 @@ const int TileEngine::heightFromCenter[11] = {0,-2,+2,-4,+4,-6,+6,-8,+8,-12,+12}
  * @param save Pointer to SavedBattleGame object.
  * @param voxelData List of voxel data.
  */
-TileEngine::TileEngine(SavedBattleGame *save, std::vector<Uint16> *voxelData) : _save(save), _voxelData(voxelData), _personalLighting(true)
+TileEngine::TileEngine(SavedBattleGame *save, std::vector<Uint16> *voxelData) : _save(save), _voxelData(voxelData), _personalLighting(true), _terrainChangesBase(0)
 {
 }
 
@@ -118,6 +126,107 @@ void TileEngine::calculateSunShading(Tile *tile)
 	tile->addLight(power, layer);
 }
 
+/**
+ * Orders light sources by position, then power.
+ */
+static bool lightSourceLess(const std::pair<Position, int> &a, const std::pair<Position, int> &b)
+{
+	if (a.first.z != b.first.z) return a.first.z < b.first.z;
+	if (a.first.y != b.first.y) return a.first.y < b.first.y;
+	if (a.first.x != b.first.x) return a.first.x < b.first.x;
+	return a.second < b.second;
+}
+
+/**
+ * Updates the light of one map row for the light sources that went
+ * out or came up. Light spreads the same over every level of the map,
+ * so each map column counts how many sources reach it with each light
+ * level; only the columns where the brightest level changed are relit.
+ */
+class LightJob : public ThreadJob
+{
+private:
+	SavedBattleGame *_save;
+	const std::vector<std::pair<Position, int> > &_removed, &_added;
+	std::vector<int> &_counts;
+	int _layer;
+
+	/// Adds or removes the light of one source in a map row.
+	void update(int y, const std::pair<Position, int> &light, int delta, std::vector<bool> &changed)
+	{
+		const Position &center = light.first;
+		const int power = light.second;
+		const int dy = y - center.y;
+		if (dy < -power || dy > power)
+			return;
+		const int minX = std::max(center.x - power, 0), maxX = std::min(center.x + power, _save->getMapSizeX() - 1);
+		for (int x = minX; x <= maxX; ++x)
+		{
+			const int dx = x - center.x;
+			int level = power - (int)Round(sqrt(float(dx*dx + dy*dy)));
+			if (level <= 0)
+				continue; // darker than an unlit tile
+			_counts[(y * _save->getMapSizeX() + x) * LEVELS + std::min(level, LEVELS - 1)] += delta;
+			changed[x] = true;
+		}
+	}
+public:
+	/// Number of light levels told apart, a tile can't get brighter than this.
+	static const int LEVELS = 16;
+
+	LightJob(SavedBattleGame *save, const std::vector<std::pair<Position, int> > &removed, const std::vector<std::pair<Position, int> > &added, std::vector<int> &counts, int layer) : _save(save), _removed(removed), _added(added), _counts(counts), _layer(layer)
+	{
+	}
+	void run(int y)
+	{
+		std::vector<bool> changed(_save->getMapSizeX(), false);
+		for (std::vector<std::pair<Position, int> >::const_iterator i = _removed.begin(); i != _removed.end(); ++i)
+		{
+			update(y, *i, -1, changed);
+		}
+		for (std::vector<std::pair<Position, int> >::const_iterator i = _added.begin(); i != _added.end(); ++i)
+		{
+			update(y, *i, 1, changed);
+		}
+		for (int x = 0; x < _save->getMapSizeX(); ++x)
+		{
+			if (!changed[x])
+				continue;
+			const int *counts = &_counts[(y * _save->getMapSizeX() + x) * LEVELS];
+			int level = LEVELS - 1;
+			while (level > 0 && counts[level] == 0)
+			{
+				--level;
+			}
+			for (int z = 0; z < _save->getMapSizeZ(); ++z)
+			{
+				Tile *tile = _save->getTile(Position(x, y, z));
+				tile->resetLight(_layer);
+				tile->addLight(level, _layer);
+			}
+		}
+	}
+};
+
+/**
+ * Scans the field of view of a set of units, one unit per item.
+ */
+class FOVJob : public ThreadJob
+{
+private:
+	TileEngine *_engine;
+	const std::vector<BattleUnit*> &_units;
+	std::vector< std::vector<BattleUnit*> > &_seen;
+public:
+	FOVJob(TileEngine *engine, const std::vector<BattleUnit*> &units, std::vector< std::vector<BattleUnit*> > &seen) : _engine(engine), _units(units), _seen(seen)
+	{
+	}
+	void run(int index)
+	{
+		_engine->scanFOV(_units[index], _seen[index]);
+	}
+};
+
 /**
   * Recalculates lighting for the terrain: objects,items,fire.
   */
@@ -126,43 +235,39 @@ void TileEngine::calculateTerrainLighting()
 	const int layer = 1; // Static lighting layer.
 	const int fireLightPower = 15; // amount of light a fire generates
 
-	// reset all light to 0 first
-	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
-	{
-		_save->getTiles()[i]->resetLight(layer);
-	}
-
 	// add lighting of terrain
+	std::vector<std::pair<Position, int> > lights;
 	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
 	{
 		// only floors and objects can light up
 		if (_save->getTiles()[i]->getMapData(MapData::O_FLOOR)
 			&& _save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getLightSource())
 		{
-			addLight(_save->getTiles()[i]->getPosition(), _save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getLightSource(), layer);
+			lights.push_back(std::make_pair(_save->getTiles()[i]->getPosition(), _save->getTiles()[i]->getMapData(MapData::O_FLOOR)->getLightSource()));
 		}
 		if (_save->getTiles()[i]->getMapData(MapData::O_OBJECT)
 			&& _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getLightSource())
 		{
-			addLight(_save->getTiles()[i]->getPosition(), _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getLightSource(), layer);
+			lights.push_back(std::make_pair(_save->getTiles()[i]->getPosition(), _save->getTiles()[i]->getMapData(MapData::O_OBJECT)->getLightSource()));
 		}
 
 		// fires
 		if (_save->getTiles()[i]->getFire())
 		{
-			addLight(_save->getTiles()[i]->getPosition(), fireLightPower, layer);
+			lights.push_back(std::make_pair(_save->getTiles()[i]->getPosition(), fireLightPower));
 		}
 
 		for (std::vector<BattleItem*>::iterator it = _save->getTiles()[i]->getInventory()->begin(); it != _save->getTiles()[i]->getInventory()->end(); ++it)
 		{
 			if ((*it)->getRules()->getBattleType() == BT_FLARE)
 			{
-				addLight(_save->getTiles()[i]->getPosition(), (*it)->getRules()->getPower(), layer);
+				lights.push_back(std::make_pair(_save->getTiles()[i]->getPosition(), (*it)->getRules()->getPower()));
 			}
 		}
 
 	}
 
+	applyLights(lights, layer);
 }
 
 /**
@@ -174,58 +279,52 @@ void TileEngine::calculateUnitLighting()
 	const int personalLightPower = 15; // amount of light a unit generates
 	const int fireLightPower = 15; // amount of light a fire generates
 
-	// reset all light to 0 first
-	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
-	{
-		_save->getTiles()[i]->resetLight(layer);
-	}
-
+	std::vector<std::pair<Position, int> > lights;
 	for (std::vector<BattleUnit*>::iterator i = _save->getUnits()->begin(); i != _save->getUnits()->end(); ++i)
 	{
 		// add lighting of soldiers
 		if (_personalLighting && (*i)->getFaction() == FACTION_PLAYER && !(*i)->isOut())
 		{
-			addLight((*i)->getPosition(), personalLightPower, layer);
+			lights.push_back(std::make_pair((*i)->getPosition(), personalLightPower));
 		}
 		// add lighting of units on fire
 		if ((*i)->getFire())
 		{
-			addLight((*i)->getPosition(), fireLightPower, layer);
+			lights.push_back(std::make_pair((*i)->getPosition(), fireLightPower));
 		}
 	}
+
+	applyLights(lights, layer);
 }
 
 /**
- * Adds circular light pattern starting from center and losing power with distance travelled.
- * @param center Center.
- * @param power Power.
+ * Sets the light sources of a lighting layer. Light spreads in circular patterns
+ * from the centers and loses power with distance travelled, and a tile keeps the
+ * brightest light reaching it. Only the sources that changed since the last call
+ * are removed from or added to the layer, so a moving unit or a new fire doesn't
+ * relight the whole map. The map rows are updated across the thread pool.
+ * @param lights Centers and powers of the light sources.
  * @param layer Light is separated in 3 layers: Ambient, Static and Dynamic.
  */
-void TileEngine::addLight(const Position &center, int power, int layer)
+void TileEngine::applyLights(const std::vector<std::pair<Position, int> > &lights, int layer)
 {
-	// only loop through the positive quadrant.
-	for (int x = 0; x <= power; ++x)
-	{
-		for (int y = 0; y <= power; ++y)
-		{
-			for (int z = 0; z < _save->getMapSizeZ(); z++)
-			{
-				int distance = (int)Round(sqrt(float(x*x + y*y)));
-
-				if (_save->getTile(Position(center.x + x,center.y + y, z)))
-					_save->getTile(Position(center.x + x,center.y + y, z))->addLight(power - distance, layer);
-
-				if (_save->getTile(Position(center.x - x,center.y - y, z)))
-					_save->getTile(Position(center.x - x,center.y - y, z))->addLight(power - distance, layer);
-
-				if (_save->getTile(Position(center.x - x,center.y + y, z)))
-					_save->getTile(Position(center.x - x,center.y + y, z))->addLight(power - distance, layer);
+	std::vector<std::pair<Position, int> > sources(lights);
+	std::sort(sources.begin(), sources.end(), lightSourceLess);
+	std::vector<std::pair<Position, int> > &current = _lightSources[layer];
+	std::vector<std::pair<Position, int> > removed, added;
+	std::set_difference(current.begin(), current.end(), sources.begin(), sources.end(), std::back_inserter(removed), lightSourceLess);
+	std::set_difference(sources.begin(), sources.end(), current.begin(), current.end(), std::back_inserter(added), lightSourceLess);
+	if (removed.empty() && added.empty())
+		return;
 
-				if (_save->getTile(Position(center.x + x,center.y - y, z)))
-					_save->getTile(Position(center.x + x,center.y - y, z))->addLight(power - distance, layer);
-			}
-		}
+	std::vector<int> &counts = _lightCounts[layer];
+	if (counts.empty())
+	{
+		counts.resize(_save->getMapSizeX() * _save->getMapSizeY() * LightJob::LEVELS, 0);
 	}
+	LightJob job(_save, removed, added, counts, layer);
+	ThreadPool::get()->run(&job, _save->getMapSizeY());
+	current.swap(sources);
 }
 
 /**
@@ -235,12 +334,28 @@ void TileEngine::addLight(const Position &center, int power, int layer)
  */
 bool TileEngine::calculateFOV(BattleUnit *unit)
 {
-	size_t oldNumVisibleUnits = unit->getUnitsSpottedThisTurn().size();
+	std::vector<BattleUnit*> seen;
+	scanFOV(unit, seen);
+	return applyFOV(unit, seen);
+}
+
+/**
+ * Finds the units in the field of view of a unit and, for player units, traces the
+ * tiles in it. Nothing is changed on the units or the map, so several units can be
+ * scanned at the same time.
+ * @param unit Unit to check line of sight of.
+ * @param seen Returns the visible units, in the order they were found.
+ */
+void TileEngine::scanFOV(BattleUnit *unit, std::vector<BattleUnit*> &seen)
+{
+	if (unit->isOut())
+	{
+		return;
+	}
 	Position center = unit->getPosition();
 	Position test;
 	int direction;
 	bool swap;
-	std::vector<Position> _trajectory;
 	if (Options::strafe && (unit->getTurretType() > -1)) {
 		direction = unit->getTurretDirection();
 	}
@@ -253,11 +368,6 @@ bool TileEngine::calculateFOV(BattleUnit *unit)
 	int signY[8] = { -1, -1, -1, +1, +1, +1, -1, -1 };
 	int y1, y2;
 
-	unit->clearVisibleUnits();
-	unit->clearVisibleTiles();
-
-	if (unit->isOut())
-		return false;
 	Position pos = unit->getPosition();
 
 	if ((unit->getHeight() + unit->getFloatHeight() + -_save->getTile(unit->getPosition())->getTerrainLevel()) >= 24 + 4)
@@ -295,52 +405,187 @@ bool TileEngine::calculateFOV(BattleUnit *unit)
 						BattleUnit *visibleUnit = _save->getTile(test)->getUnit();
 						if (visibleUnit && !visibleUnit->isOut() && visible(unit, _save->getTile(test)))
 						{
-							if (unit->getFaction() == FACTION_PLAYER)
-							{
-								visibleUnit->getTile()->setVisible(+1);
-								visibleUnit->setVisible(true);
-							}
-							if ((visibleUnit->getFaction() == FACTION_HOSTILE && unit->getFaction() == FACTION_PLAYER)
-								|| (visibleUnit->getFaction() != FACTION_HOSTILE && unit->getFaction() == FACTION_HOSTILE))
-							{
-								unit->addToVisibleUnits(visibleUnit);
-								unit->addToVisibleTiles(visibleUnit->getTile());
-
-								if (unit->getFaction() == FACTION_HOSTILE && visibleUnit->getFaction() != FACTION_HOSTILE)
-								{
-									visibleUnit->setTurnsSinceSpotted(0);
-								}
-							}
+							seen.push_back(visibleUnit);
 						}
+					}
+				}
+			}
+		}
+	}
+
+	if (unit->getFaction() == FACTION_PLAYER)
+	{
+		// this sets tiles to discovered if they are in LOS - tile visibility is not calculated in voxelspace but in tilespace
+		traceFOVTiles(unit, _fovCache[unit->getId()], center, pos, direction);
+	}
+}
+
+/**
+ * Updates a unit's visible units and the visibility of the map from the results of its
+ * field of view scan, in the same order the scan found them.
+ * @param unit Unit to check line of sight of.
+ * @param seen The visible units found by the scan.
+ * @return True when new aliens are spotted.
+ */
+bool TileEngine::applyFOV(BattleUnit *unit, const std::vector<BattleUnit*> &seen)
+{
+	size_t oldNumVisibleUnits = unit->getUnitsSpottedThisTurn().size();
+
+	unit->clearVisibleUnits();
+	unit->clearVisibleTiles();
+
+	if (unit->isOut())
+	{
+		_fovCache.erase(unit->getId());
+		return false;
+	}
+
+	for (std::vector<BattleUnit*>::const_iterator i = seen.begin(); i != seen.end(); ++i)
+	{
+		BattleUnit *visibleUnit = *i;
+		if (unit->getFaction() == FACTION_PLAYER)
+		{
+			visibleUnit->getTile()->setVisible(+1);
+			visibleUnit->setVisible(true);
+		}
+		if ((visibleUnit->getFaction() == FACTION_HOSTILE && unit->getFaction() == FACTION_PLAYER)
+			|| (visibleUnit->getFaction() != FACTION_HOSTILE && unit->getFaction() == FACTION_HOSTILE))
+		{
+			unit->addToVisibleUnits(visibleUnit);
+			unit->addToVisibleTiles(visibleUnit->getTile());
+
+			if (unit->getFaction() == FACTION_HOSTILE && visibleUnit->getFaction() != FACTION_HOSTILE)
+			{
+				visibleUnit->setTurnsSinceSpotted(0);
+			}
+		}
+	}
+
+	if (unit->getFaction() == FACTION_PLAYER)
+	{
+		const FOVCache &cache = _fovCache[unit->getId()];
+		for (std::vector<int>::const_iterator i = cache.tiles.begin(); i != cache.tiles.end(); ++i)
+		{
+			Tile *tile = _save->getTiles()[*i];
+			//mark every tile of line as visible (as in original)
+			//this is needed because of bresenham narrow stroke.
+			tile->setVisible(+1);
+			tile->setDiscovered(true, 2);
+			// walls to the east or south of a visible tile, we see that too
+			Tile* t = _save->getTile(tile->getPosition() + Position(1, 0, 0));
+			if (t) t->setDiscovered(true, 0);
+			t = _save->getTile(tile->getPosition() + Position(0, 1, 0));
+			if (t) t->setDiscovered(true, 1);
+		}
+	}
+
+	// we only react when there are at least the same amount of visible units as before AND the checksum is different
+	// this way we stop if there are the same amount of visible units, but a different unit is seen
+	// or we stop if there are more visible units seen
+	if (unit->getUnitsSpottedThisTurn().size() > oldNumVisibleUnits && !unit->getVisibleUnits()->empty())
+	{
+		return true;
+	}
+
+	return false;
+
+}
+
+/**
+ * Traces the tiles in the field of view of a player unit.
+ * The tiles crossed by every line of sight are cached per unit, so while the unit keeps
+ * its position and facing, only the lines passing near changed terrain are traced again.
+ * @param unit Unit to check line of sight of.
+ * @param cache The unit's cached lines of sight.
+ * @param center Position the view cone is centered on.
+ * @param origin Position the lines of sight start from.
+ * @param direction Direction the view cone is facing.
+ */
+void TileEngine::traceFOVTiles(BattleUnit *unit, FOVCache &cache, const Position &center, const Position &origin, int direction)
+{
+	const int size = unit->getArmor()->getSize();
+	bool reuse = !cache.rays.empty()
+		&& cache.center == center
+		&& cache.origin == origin
+		&& cache.direction == direction
+		&& cache.size == size
+		&& cache.terrainChanges >= _terrainChangesBase;
+
+	// only terrain changes within reach of the lines of sight matter
+	std::vector<Position> changes;
+	if (reuse)
+	{
+		const int reach = MAX_VIEW_DISTANCE + size + 1;
+		for (size_t i = cache.terrainChanges - _terrainChangesBase; i < _terrainChanges.size(); ++i)
+		{
+			const Position &change = _terrainChanges[i];
+			if (abs(change.x - center.x) <= reach && abs(change.y - center.y) <= reach)
+			{
+				changes.push_back(change);
+			}
+		}
+	}
+
+	if (!reuse || !changes.empty())
+	{
+		bool swap = (direction==0 || direction==4);
+		int signX[8] = { +1, +1, +1, +1, -1, -1, -1, -1 };
+		int signY[8] = { -1, -1, -1, +1, +1, +1, -1, -1 };
+		int y1, y2;
+		Position test;
+		std::vector<Position> trajectory;
+		std::vector<int> rays, tiles;
+		rays.reserve(cache.rays.size());
+		tiles.reserve(cache.tiles.size());
+		size_t ray = 0;
 
-						if (unit->getFaction() == FACTION_PLAYER)
+		for (int x = 0; x <= MAX_VIEW_DISTANCE; ++x)
+		{
+			if (direction%2)
+			{
+				y1 = 0;
+				y2 = MAX_VIEW_DISTANCE;
+			}
+			else
+			{
+				y1 = -x;
+				y2 = x;
+			}
+			for (int y = y1; y <= y2; ++y)
+			{
+				for (int z = 0; z < _save->getMapSizeZ(); z++)
+				{
+					const int distanceSqr = x*x + y*y;
+					test.z = z;
+					if (distanceSqr <= MAX_VIEW_DISTANCE_SQR)
+					{
+						test.x = center.x + signX[direction]*(swap?y:x);
+						test.y = center.y + signY[direction]*(swap?x:y);
+						if (_save->getTile(test))
 						{
-							// this sets tiles to discovered if they are in LOS - tile visibility is not calculated in voxelspace but in tilespace
 							// large units have "4 pair of eyes"
-							int size = unit->getArmor()->getSize();
 							for (int xo = 0; xo < size; xo++)
 							{
 								for (int yo = 0; yo < size; yo++)
 								{
-									Position poso = pos + Position(xo,yo,0);
-									_trajectory.clear();
-									int tst = calculateLine(poso, test, true, &_trajectory, unit, false);
-									size_t tsize = _trajectory.size();
-									if (tst>127) --tsize; //last tile is blocked thus must be cropped
-									for (size_t i = 0; i < tsize; i++)
+									Position poso = origin + Position(xo,yo,0);
+									rays.push_back(tiles.size());
+									if (reuse && !touchesTerrainChange(changes, poso, test))
 									{
-										Position posi = _trajectory.at(i);
-										//mark every tile of line as visible (as in original)
-										//this is needed because of bresenham narrow stroke.
-										_save->getTile(posi)->setVisible(+1);
-										_save->getTile(posi)->setDiscovered(true, 2);
-										// walls to the east or south of a visible tile, we see that too
-										Tile* t = _save->getTile(Position(posi.x + 1, posi.y, posi.z));
-										if (t) t->setDiscovered(true, 0);
-										t = _save->getTile(Position(posi.x, posi.y + 1, posi.z));
-										if (t) t->setDiscovered(true, 1);
+										tiles.insert(tiles.end(), cache.tiles.begin() + cache.rays[ray], cache.tiles.begin() + cache.rays[ray + 1]);
 									}
-
+									else
+									{
+										trajectory.clear();
+										int tst = calculateLine(poso, test, true, &trajectory, unit, false);
+										size_t tsize = trajectory.size();
+										if (tst>127) --tsize; //last tile is blocked thus must be cropped
+										for (size_t i = 0; i < tsize; i++)
+										{
+											tiles.push_back(_save->getTileIndex(trajectory[i]));
+										}
+									}
+									++ray;
 								}
 							}
 						}
@@ -348,18 +593,64 @@ bool TileEngine::calculateFOV(BattleUnit *unit)
 				}
 			}
 		}
+		rays.push_back(tiles.size());
+
+		cache.center = center;
+		cache.origin = origin;
+		cache.direction = direction;
+		cache.size = size;
+		cache.rays.swap(rays);
+		cache.tiles.swap(tiles);
 	}
+	cache.terrainChanges = _terrainChangesBase + _terrainChanges.size();
+}
 
-	// we only react when there are at least the same amount of visible units as before AND the checksum is different
-	// this way we stop if there are the same amount of visible units, but a different unit is seen
-	// or we stop if there are more visible units seen
-	if (unit->getUnitsSpottedThisTurn().size() > oldNumVisibleUnits && !unit->getVisibleUnits()->empty())
+/**
+ * Checks if a tile-space line of sight can be affected by any of the given terrain changes.
+ * Blockage checks look at the neighbours of the tiles on the line too, so the bounding
+ * box of the line is grown by one tile.
+ * @param changes Positions of changed terrain.
+ * @param origin Start of the line.
+ * @param target End of the line.
+ * @return True if the line has to be traced again.
+ */
+bool TileEngine::touchesTerrainChange(const std::vector<Position> &changes, const Position &origin, const Position &target) const
+{
+	const int minX = std::min(origin.x, target.x) - 1, maxX = std::max(origin.x, target.x) + 1;
+	const int minY = std::min(origin.y, target.y) - 1, maxY = std::max(origin.y, target.y) + 1;
+	const int minZ = std::min(origin.z, target.z) - 1, maxZ = std::max(origin.z, target.z) + 1;
+	for (std::vector<Position>::const_iterator i = changes.begin(); i != changes.end(); ++i)
 	{
-		return true;
+		if (i->x >= minX && i->x <= maxX && i->y >= minY && i->y <= maxY && i->z >= minZ && i->z <= maxZ)
+		{
+			return true;
+		}
 	}
-
 	return false;
+}
+
+/**
+ * Marks the terrain of a tile as changed (destroyed objects, opened or closed doors),
+ * so its voxel occupancy is updated, cached line of sight data crossing it gets traced again
+ * and the pathfinding step costs around it are worked out again.
+ * @param pos Position of the changed tile.
+ */
+void TileEngine::markTerrainChanged(const Position &pos)
+{
+	Tile *tile = _save->getTile(pos);
+	if (tile && !_voxelSlots.empty())
+	{
+		_voxelSlots[_save->getTileIndex(pos)] = getVoxelSlot(tile);
+	}
+	_save->getPathfinding()->invalidateSteps(pos);
 
+	if (_terrainChanges.size() >= MAX_TERRAIN_CHANGES)
+	{
+		// caches that didn't catch up with the dropped changes will be rebuilt from scratch
+		_terrainChangesBase += _terrainChanges.size();
+		_terrainChanges.clear();
+	}
+	_terrainChanges.push_back(pos);
 }
 
 /**
@@ -468,8 +759,9 @@ bool TileEngine::visible(BattleUnit *currentUnit, Tile *tile)
 int TileEngine::checkVoxelExposure(Position *originVoxel, Tile *tile, BattleUnit *excludeUnit, BattleUnit *excludeAllBut)
 {
 	Position targetVoxel = Position((tile->getPosition().x * 16) + 7, (tile->getPosition().y * 16) + 8, tile->getPosition().z * 24);
-	Position scanVoxel;
-	std::vector<Position> _trajectory;
+	Position scanVoxels[2];
+	int tests[2];
+	Position impacts[2];
 	BattleUnit *otherUnit = tile->getUnit();
 	if (otherUnit == 0) return 0; //no unit in this tile, even if it elevated and appearing in it.
 	if (otherUnit == excludeUnit) return 0; //skip self
@@ -511,20 +803,20 @@ int TileEngine::checkVoxelExposure(Position *originVoxel, Tile *tile, BattleUnit
 	for (int i = heightRange; i >=0; i-=2)
 	{
 		++total;
-		scanVoxel.z=targetMinHeight+i;
 		for (int j = 0; j < 2; ++j)
 		{
-			scanVoxel.x=targetVoxel.x + sliceTargets[j*2];
-			scanVoxel.y=targetVoxel.y + sliceTargets[j*2+1];
-			_trajectory.clear();
-			int test = calculateLine(*originVoxel, scanVoxel, false, &_trajectory, excludeUnit, true, false, excludeAllBut);
-			if (test == V_UNIT)
+			scanVoxels[j] = Position(targetVoxel.x + sliceTargets[j*2], targetVoxel.y + sliceTargets[j*2+1], targetMinHeight+i);
+		}
+		calculateLines(*originVoxel, scanVoxels, 2, tests, impacts, excludeUnit, false, excludeAllBut);
+		for (int j = 0; j < 2; ++j)
+		{
+			if (tests[j] == V_UNIT)
 			{
 				//voxel of hit must be inside of scanned box
-				if (_trajectory.at(0).x/16 == scanVoxel.x/16 &&
-					_trajectory.at(0).y/16 == scanVoxel.y/16 &&
-					_trajectory.at(0).z >= targetMinHeight &&
-					_trajectory.at(0).z <= targetMaxHeight)
+				if (impacts[j].x/16 == scanVoxels[j].x/16 &&
+					impacts[j].y/16 == scanVoxels[j].y/16 &&
+					impacts[j].z >= targetMinHeight &&
+					impacts[j].z <= targetMaxHeight)
 				{
 					++visible;
 				}
@@ -546,8 +838,9 @@ int TileEngine::checkVoxelExposure(Position *originVoxel, Tile *tile, BattleUnit
 bool TileEngine::canTargetUnit(Position *originVoxel, Tile *tile, Position *scanVoxel, BattleUnit *excludeUnit, BattleUnit *potentialUnit)
 {
 	Position targetVoxel = Position((tile->getPosition().x * 16) + 7, (tile->getPosition().y * 16) + 8, tile->getPosition().z * 24);
-	std::vector<Position> _trajectory;
-	bool hypothetical = potentialUnit != 0;
+	Position scanVoxels[5];
+	int tests[5];
+	Position impacts[5];
 	if (potentialUnit == 0)
 	{
 		potentialUnit = tile->getUnit();
@@ -598,35 +891,36 @@ bool TileEngine::canTargetUnit(Position *originVoxel, Tile *tile, Position *scan
 	// scan ray from top to bottom  plus different parts of target cylinder
 	for (int i = 0; i <= heightRange; ++i)
 	{
-		scanVoxel->z=targetCenterHeight+heightFromCenter[i];
-		for (int j = 0; j < 5; ++j)
+		int slices = (i < (heightRange-1)) ? 3 : 5; //skip unnecessary checks
+		for (int j = 0; j < slices; ++j)
 		{
-			if (i < (heightRange-1) && j>2) break; //skip unnecessary checks
-			scanVoxel->x=targetVoxel.x + sliceTargets[j*2];
-			scanVoxel->y=targetVoxel.y + sliceTargets[j*2+1];
-			_trajectory.clear();
-			int test = calculateLine(*originVoxel, *scanVoxel, false, &_trajectory, excludeUnit, true, false);
-			if (test == V_UNIT)
+			scanVoxels[j] = Position(targetVoxel.x + sliceTargets[j*2], targetVoxel.y + sliceTargets[j*2+1], targetCenterHeight+heightFromCenter[i]);
+		}
+		// trace one group of lines at a time, so a hit still saves the rest
+		for (int first = 0; first < slices; first += LINE_LANES)
+		{
+			int group = std::min(LINE_LANES, slices - first);
+			calculateLineLanes(*originVoxel, scanVoxels + first, group, tests + first, impacts + first, excludeUnit, false, 0);
+			for (int j = first; j < first + group; ++j)
 			{
+				*scanVoxel = scanVoxels[j];
+				if (tests[j] != V_UNIT)
+					continue;
 				for (int x = 0; x <= targetSize; ++x)
 				{
 					for (int y = 0; y <= targetSize; ++y)
 					{
 						//voxel of hit must be inside of scanned box
-						if (_trajectory.at(0).x/16 == (scanVoxel->x/16) + x + xOffset &&
-							_trajectory.at(0).y/16 == (scanVoxel->y/16) + y + yOffset &&
-							_trajectory.at(0).z >= targetMinHeight &&
-							_trajectory.at(0).z <= targetMaxHeight)
+						if (impacts[j].x/16 == (scanVoxel->x/16) + x + xOffset &&
+							impacts[j].y/16 == (scanVoxel->y/16) + y + yOffset &&
+							impacts[j].z >= targetMinHeight &&
+							impacts[j].z <= targetMaxHeight)
 						{
 							return true;
 						}
 					}
 				}
 			}
-			else if (test == V_EMPTY && hypothetical && !_trajectory.empty())
-			{
-				return true;
-			}
 		}
 	}
 	return false;
@@ -650,7 +944,9 @@ bool TileEngine::canTargetTile(Position *originVoxel, Tile *tile, int part, Posi
 	static int northWallSpiral[14] = {7,0, 9,0, 6,0, 11,0, 4,0, 13,0, 2,0};
 
 	Position targetVoxel = Position((tile->getPosition().x * 16), (tile->getPosition().y * 16), tile->getPosition().z * 24);
-	std::vector<Position> _trajectory;
+	Position scanVoxels[LINE_LANES];
+	int tests[LINE_LANES];
+	Position impacts[LINE_LANES];
 
 	int *spiralArray;
 	int spiralCount;
@@ -743,20 +1039,26 @@ bool TileEngine::canTargetTile(Position *originVoxel, Tile *tile, int part, Posi
 
 	for (int j = 0; j <= rangeZ; ++j)
 	{
-		scanVoxel->z = targetVoxel.z + centerZ + heightFromCenter[j];
-		for (int i = 0; i < spiralCount; ++i)
+		// trace one group of lines at a time, so a hit still saves the rest
+		for (int first = 0; first < spiralCount; first += LINE_LANES)
 		{
-			scanVoxel->x = targetVoxel.x + spiralArray[i*2];
-			scanVoxel->y = targetVoxel.y + spiralArray[i*2+1];
-			_trajectory.clear();
-			int test = calculateLine(*originVoxel, *scanVoxel, false, &_trajectory, excludeUnit, true);
-			if (test == part) //bingo
+			int group = std::min(LINE_LANES, spiralCount - first);
+			for (int i = 0; i < group; ++i)
 			{
-				if (_trajectory.at(0).x/16 == scanVoxel->x/16 &&
-					_trajectory.at(0).y/16 == scanVoxel->y/16 &&
-					_trajectory.at(0).z/24 == scanVoxel->z/24)
+				scanVoxels[i] = Position(targetVoxel.x + spiralArray[(first+i)*2], targetVoxel.y + spiralArray[(first+i)*2+1], targetVoxel.z + centerZ + heightFromCenter[j]);
+			}
+			calculateLineLanes(*originVoxel, scanVoxels, group, tests, impacts, excludeUnit, false, 0);
+			for (int i = 0; i < group; ++i)
+			{
+				*scanVoxel = scanVoxels[i];
+				if (tests[i] == part) //bingo
 				{
-					return true;
+					if (impacts[i].x/16 == scanVoxel->x/16 &&
+						impacts[i].y/16 == scanVoxel->y/16 &&
+						impacts[i].z/24 == scanVoxel->z/24)
+					{
+						return true;
+					}
 				}
 			}
 		}
@@ -1064,6 +1366,7 @@ BattleUnit *TileEngine::hit(const Position &center, int power, ItemDamageType ty
 		{
 			_save->addDestroyedObjective();
 		}
+		markTerrainChanged(tile->getPosition());
 	}
 	else if (part == V_UNIT)
 	{
@@ -1449,6 +1752,7 @@ bool TileEngine::detonate(Tile* tile)
 				currentpart2 = currentpart;
 			if (tiles[i]->destroy(currentpart))
 				objective = true;
+			markTerrainChanged(tiles[i]->getPosition());
 			currentpart =  currentpart2;
 			if (tiles[i]->getMapData(currentpart)) // take new values
 			{
@@ -1968,6 +2272,10 @@ int TileEngine::unitOpensDoor(BattleUnit *unit, bool rClick, int dir)
 				if (tile)
 				{
 					door = tile->openDoor(i->second, unit, _save->getBattleGame()->getReservedAction());
+					if (door == 0 || door == 1)
+					{
+						markTerrainChanged(tile->getPosition());
+					}
 					if (door != -1)
 					{
 						part = i->second;
@@ -2035,7 +2343,10 @@ void TileEngine::checkAdjacentDoors(Position pos, int part)
 		Tile *tile = _save->getTile(pos + offset);
 		if (tile && tile->getMapData(part) && tile->getMapData(part)->isUFODoor())
 		{
-			tile->openDoor(part);
+			if (tile->openDoor(part) == 1)
+			{
+				markTerrainChanged(tile->getPosition());
+			}
 		}
 		else break;
 	}
@@ -2045,7 +2356,10 @@ void TileEngine::checkAdjacentDoors(Position pos, int part)
 		Tile *tile = _save->getTile(pos + offset);
 		if (tile && tile->getMapData(part) && tile->getMapData(part)->isUFODoor())
 		{
-			tile->openDoor(part);
+			if (tile->openDoor(part) == 1)
+			{
+				markTerrainChanged(tile->getPosition());
+			}
 		}
 		else break;
 	}
@@ -2074,12 +2388,29 @@ int TileEngine::closeUfoDoors()
 				continue;
 			}
 		}
-		doorsclosed += _save->getTiles()[i]->closeUfoDoor();
+		if (_save->getTiles()[i]->closeUfoDoor())
+		{
+			markTerrainChanged(_save->getTiles()[i]->getPosition());
+			++doorsclosed;
+		}
 	}
 
 	return doorsclosed;
 }
 
+/**
+ * Builds the terrain data used to trace lines ahead of time.
+ * Line traces only read the map afterwards, so they can be
+ * spread across the thread pool.
+ */
+void TileEngine::prepareLineTracing()
+{
+	if (_voxelSlots.empty())
+	{
+		buildVoxelOccupancy();
+	}
+}
+
 /**
  * Calculates a line trajectory, using bresenham algorithm in 3D.
  * @param origin Origin (voxel??).
@@ -2247,6 +2578,186 @@ int TileEngine::calculateLine(const Position& origin, const Position& target, bo
 	return V_EMPTY;
 }
 
+/**
+ * Traces lines from one origin to many targets, the same way as
+ * calculateLine() with a voxel check and no stored trajectory.
+ * The lines are traced in groups that step side by side.
+ * @param origin Origin voxel.
+ * @param targets Target voxels.
+ * @param count Number of targets.
+ * @param results Returns what each line hit, like calculateLine().
+ * @param impacts Returns the voxel where each line hit something (unset for V_EMPTY).
+ * @param excludeUnit Excludes this unit in the collision detection.
+ * @param onlyVisible Skip invisible units?
+ * @param excludeAllBut [Optional] The only unit to be considered for ray hits.
+ */
+void TileEngine::calculateLines(const Position &origin, const Position *targets, int count, int *results, Position *impacts, BattleUnit *excludeUnit, bool onlyVisible, BattleUnit *excludeAllBut)
+{
+	for (int first = 0; first < count; first += LINE_LANES)
+	{
+		calculateLineLanes(origin, targets + first, std::min(LINE_LANES, count - first), results + first, impacts + first, excludeUnit, onlyVisible, excludeAllBut);
+	}
+}
+
+/**
+ * Traces up to LINE_LANES lines from the same origin in lockstep.
+ * Each lane follows the bresenham line of calculateLine(), written
+ * in map space: one step along the longest axis per round, plus the
+ * steps in the two shallow planes whenever their drift runs out.
+ * The stepping of all lanes is done at once (with SSE2 if available),
+ * the voxels reached are then checked one lane at a time.
+ * @param origin Origin voxel.
+ * @param targets Target voxels.
+ * @param count Number of targets, at most LINE_LANES.
+ * @param results Returns what each line hit.
+ * @param impacts Returns the voxel where each line hit something.
+ * @param excludeUnit Excludes this unit in the collision detection.
+ * @param onlyVisible Skip invisible units?
+ * @param excludeAllBut The only unit to be considered for ray hits.
+ */
+void TileEngine::calculateLineLanes(const Position &origin, const Position *targets, int count, int *results, Position *impacts, BattleUnit *excludeUnit, bool onlyVisible, BattleUnit *excludeAllBut)
+{
+	// lane state, one array entry per line
+	int x[LINE_LANES], y[LINE_LANES], z[LINE_LANES];
+	int majorX[LINE_LANES], majorY[LINE_LANES], majorZ[LINE_LANES];
+	int shallowX[2][LINE_LANES], shallowY[2][LINE_LANES], shallowZ[2][LINE_LANES];
+	int drift[2][LINE_LANES], delta[2][LINE_LANES], deltaMajor[LINE_LANES];
+	int left[LINE_LANES], active[LINE_LANES], moved[LINE_LANES];
+
+	for (int lane = 0; lane < LINE_LANES; ++lane)
+	{
+		x[lane] = origin.x; y[lane] = origin.y; z[lane] = origin.z;
+		if (lane >= count)
+		{
+			majorX[lane] = majorY[lane] = majorZ[lane] = deltaMajor[lane] = left[lane] = active[lane] = 0;
+			for (int plane = 0; plane < 2; ++plane)
+			{
+				shallowX[plane][lane] = shallowY[plane][lane] = shallowZ[plane][lane] = drift[plane][lane] = delta[plane][lane] = 0;
+			}
+			continue;
+		}
+		// same setup as calculateLine(), in its swapped space
+		int x0 = origin.x, x1 = targets[lane].x;
+		int y0 = origin.y, y1 = targets[lane].y;
+		int z0 = origin.z, z1 = targets[lane].z;
+		bool swap_xy = abs(y1 - y0) > abs(x1 - x0);
+		if (swap_xy)
+		{
+			std::swap(x0, y0);
+			std::swap(x1, y1);
+		}
+		bool swap_xz = abs(z1 - z0) > abs(x1 - x0);
+		if (swap_xz)
+		{
+			std::swap(x0, z0);
+			std::swap(x1, z1);
+		}
+		deltaMajor[lane] = abs(x1 - x0);
+		delta[0][lane] = abs(y1 - y0);
+		delta[1][lane] = abs(z1 - z0);
+		drift[0][lane] = drift[1][lane] = deltaMajor[lane] / 2;
+		left[lane] = deltaMajor[lane] + 1;
+		active[lane] = -1;
+
+		// turn the steps along the swapped axes back into map space
+		Position steps[3] = { Position(x0 > x1 ? -1 : 1, 0, 0), Position(0, y0 > y1 ? -1 : 1, 0), Position(0, 0, z0 > z1 ? -1 : 1) };
+		for (int i = 0; i < 3; ++i)
+		{
+			if (swap_xz) std::swap(steps[i].x, steps[i].z);
+			if (swap_xy) std::swap(steps[i].x, steps[i].y);
+		}
+		majorX[lane] = steps[0].x; majorY[lane] = steps[0].y; majorZ[lane] = steps[0].z;
+		for (int plane = 0; plane < 2; ++plane)
+		{
+			shallowX[plane][lane] = steps[plane + 1].x;
+			shallowY[plane][lane] = steps[plane + 1].y;
+			shallowZ[plane][lane] = steps[plane + 1].z;
+		}
+	}
+
+	int remaining = count;
+	while (remaining > 0)
+	{
+		// passes through this point?
+		for (int lane = 0; lane < LINE_LANES; ++lane)
+		{
+			moved[lane] = active[lane];
+		}
+		for (int plane = -1; plane < 2; ++plane)
+		{
+			if (plane >= 0)
+			{
+				// step in a shallow plane where the drift ran out
+#ifdef TILEENGINE_SSE2
+				__m128i mask = _mm_loadu_si128((__m128i*)active);
+				__m128i d = _mm_sub_epi32(_mm_loadu_si128((__m128i*)drift[plane]), _mm_loadu_si128((__m128i*)delta[plane]));
+				mask = _mm_and_si128(mask, _mm_cmplt_epi32(d, _mm_setzero_si128()));
+				d = _mm_add_epi32(d, _mm_and_si128(mask, _mm_loadu_si128((__m128i*)deltaMajor)));
+				_mm_storeu_si128((__m128i*)drift[plane], d);
+				_mm_storeu_si128((__m128i*)moved, mask);
+				_mm_storeu_si128((__m128i*)x, _mm_add_epi32(_mm_loadu_si128((__m128i*)x), _mm_and_si128(mask, _mm_loadu_si128((__m128i*)shallowX[plane]))));
+				_mm_storeu_si128((__m128i*)y, _mm_add_epi32(_mm_loadu_si128((__m128i*)y), _mm_and_si128(mask, _mm_loadu_si128((__m128i*)shallowY[plane]))));
+				_mm_storeu_si128((__m128i*)z, _mm_add_epi32(_mm_loadu_si128((__m128i*)z), _mm_and_si128(mask, _mm_loadu_si128((__m128i*)shallowZ[plane]))));
+#else
+				for (int lane = 0; lane < LINE_LANES; ++lane)
+				{
+					drift[plane][lane] -= delta[plane][lane];
+					moved[lane] = (active[lane] && drift[plane][lane] < 0) ? -1 : 0;
+					if (moved[lane])
+					{
+						drift[plane][lane] += deltaMajor[lane];
+						x[lane] += shallowX[plane][lane];
+						y[lane] += shallowY[plane][lane];
+						z[lane] += shallowZ[plane][lane];
+					}
+				}
+#endif
+			}
+			for (int lane = 0; lane < LINE_LANES; ++lane)
+			{
+				if (!moved[lane])
+					continue;
+				Position voxel(x[lane], y[lane], z[lane]);
+				int result = voxelCheck(voxel, excludeUnit, false, onlyVisible, excludeAllBut);
+				if (result != V_EMPTY)
+				{
+					results[lane] = result;
+					impacts[lane] = voxel;
+					active[lane] = 0;
+					--remaining;
+				}
+			}
+		}
+
+		// step through longest delta
+		for (int lane = 0; lane < LINE_LANES; ++lane)
+		{
+			if (active[lane] && --left[lane] == 0)
+			{
+				results[lane] = V_EMPTY;
+				active[lane] = 0;
+				--remaining;
+			}
+		}
+#ifdef TILEENGINE_SSE2
+		__m128i mask = _mm_loadu_si128((__m128i*)active);
+		_mm_storeu_si128((__m128i*)x, _mm_add_epi32(_mm_loadu_si128((__m128i*)x), _mm_and_si128(mask, _mm_loadu_si128((__m128i*)majorX))));
+		_mm_storeu_si128((__m128i*)y, _mm_add_epi32(_mm_loadu_si128((__m128i*)y), _mm_and_si128(mask, _mm_loadu_si128((__m128i*)majorY))));
+		_mm_storeu_si128((__m128i*)z, _mm_add_epi32(_mm_loadu_si128((__m128i*)z), _mm_and_si128(mask, _mm_loadu_si128((__m128i*)majorZ))));
+#else
+		for (int lane = 0; lane < LINE_LANES; ++lane)
+		{
+			if (active[lane])
+			{
+				x[lane] += majorX[lane];
+				y[lane] += majorY[lane];
+				z[lane] += majorZ[lane];
+			}
+		}
+#endif
+	}
+}
+
 /**
  * Calculates a parabola trajectory, used for throwing items.
  * @param origin Orign in voxelspace.
@@ -2396,19 +2907,28 @@ int TileEngine::voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool
 	}
 
 	// first we check terrain voxel data, not to allow 2x2 units stick through walls
-	for (int i=0; i< 4; ++i)
+	if (_voxelSlots.empty())
 	{
-		MapData *mp = tile->getMapData(i);
-		if (tile->isUfoDoorOpen(i))
-			continue;
-		if (mp != 0)
+		buildVoxelOccupancy();
+	}
+	int slot = _voxelSlots[_save->getTileIndex(tile->getPosition())];
+	if (slot != -1 && (_voxelBitmaps[slot * VOXEL_ROWS + ((voxel.z%24)/2)*16 + voxel.y%16] & (1 << (15 - voxel.x%16))))
+	{
+		// the combined bitmap says something is there, find out which part it is
+		for (int i=0; i< 4; ++i)
 		{
-			int x = 15 - voxel.x%16;
-			int y = voxel.y%16;
-			int idx = (mp->getLoftID((voxel.z%24)/2)*16) + y;
-			if (_voxelData->at(idx) & (1 << x))
+			MapData *mp = tile->getMapData(i);
+			if (tile->isUfoDoorOpen(i))
+				continue;
+			if (mp != 0)
 			{
-				return i;
+				int x = 15 - voxel.x%16;
+				int y = voxel.y%16;
+				int idx = (mp->getLoftID((voxel.z%24)/2)*16) + y;
+				if (_voxelData->at(idx) & (1 << x))
+				{
+					return i;
+				}
 			}
 		}
 	}
@@ -2450,6 +2970,70 @@ int TileEngine::voxelCheck(const Position& voxel, BattleUnit *excludeUnit, bool
 	return V_EMPTY;
 }
 
+/**
+ * Builds the terrain voxel occupancy of the whole map: for every tile, the loft
+ * rows of all its parts merged into a single bitmap, so voxelCheck() only has
+ * to test one bit to know if there's terrain at a voxel. Units are not part of it.
+ */
+void TileEngine::buildVoxelOccupancy()
+{
+	_voxelSlots.resize(_save->getMapSizeXYZ());
+	for (int i = 0; i < _save->getMapSizeXYZ(); ++i)
+	{
+		_voxelSlots[i] = getVoxelSlot(_save->getTiles()[i]);
+	}
+}
+
+/**
+ * Gets the voxel occupancy bitmap for the current terrain of a tile.
+ * Bitmaps are shared between tiles with the same parts; a new one is
+ * added the first time a combination of parts shows up.
+ * @param tile The tile.
+ * @return Index of the bitmap, or -1 if the tile has no terrain.
+ */
+int TileEngine::getVoxelSlot(Tile *tile)
+{
+	VoxelParts key;
+	bool empty = true;
+	for (int i = 0; i < 4; ++i)
+	{
+		key.parts[i] = tile->isUfoDoorOpen(i) ? 0 : tile->getMapData(i);
+		if (key.parts[i] != 0)
+		{
+			empty = false;
+		}
+	}
+	if (empty)
+	{
+		return -1;
+	}
+
+	std::map<VoxelParts, int>::const_iterator i = _voxelSlotIndex.find(key);
+	if (i != _voxelSlotIndex.end())
+	{
+		return i->second;
+	}
+
+	int slot = _voxelBitmaps.size() / VOXEL_ROWS;
+	_voxelBitmaps.resize(_voxelBitmaps.size() + VOXEL_ROWS, 0);
+	Uint16 *bitmap = &_voxelBitmaps[slot * VOXEL_ROWS];
+	for (int part = 0; part < 4; ++part)
+	{
+		if (key.parts[part] == 0)
+			continue;
+		for (int layer = 0; layer < VOXEL_LAYERS; ++layer)
+		{
+			int idx = key.parts[part]->getLoftID(layer) * 16;
+			for (int y = 0; y < 16; ++y)
+			{
+				bitmap[layer * 16 + y] |= _voxelData->at(idx + y);
+			}
+		}
+	}
+	_voxelSlotIndex[key] = slot;
+	return slot;
+}
+
 /**
  * Toggles personal lighting on / off.
  */
@@ -2783,13 +3367,32 @@ bool TileEngine::validateThrow(BattleAction &action, Position originVoxel, Posit
  */
 void TileEngine::recalculateFOV()
 {
+	std::vector<BattleUnit*> units;
 	for (std::vector<BattleUnit*>::iterator bu = _save->getUnits()->begin(); bu != _save->getUnits()->end(); ++bu)
 	{
 		if ((*bu)->getTile() != 0)
 		{
-			calculateFOV(*bu);
+			units.push_back(*bu);
+			if ((*bu)->getFaction() == FACTION_PLAYER && !(*bu)->isOut())
+			{
+				_fovCache[(*bu)->getId()];
+			}
 		}
 	}
+	if (_voxelSlots.empty())
+	{
+		buildVoxelOccupancy();
+	}
+
+	// the scans only read the map, so they can run side by side,
+	// the results are then applied in the same order as one by one
+	std::vector< std::vector<BattleUnit*> > seen(units.size());
+	FOVJob job(this, units, seen);
+	ThreadPool::get()->run(&job, units.size());
+	for (size_t i = 0; i < units.size(); ++i)
+	{
+		applyFOV(units[i], seen[i]);
+	}
 }
 
 /**
@@ -20,6 +20,8 @@
 #define OPENXCOM_TILEENGINE_H
 
 #include <vector>
+#include <map>
+#include <algorithm>
 #include "Position.h"
 #include "../Ruleset/RuleItem.h"
 #include <SDL.h>
@@ -31,7 +33,32 @@ class SavedBattleGame;
 class BattleUnit;
 class BattleItem;
 class Tile;
+class MapData;
 struct BattleAction;
+
+/**
+ * The terrain part of a unit's field of view: every tile marked by its lines of sight,
+ * kept so the sweep can be replayed as long as the unit and the terrain around it stay the same.
+ */
+struct FOVCache
+{
+	Position center, origin;
+	int direction, size;
+	size_t terrainChanges;
+	std::vector<int> rays, tiles;
+	FOVCache() : direction(-1), size(0), terrainChanges(0) { }
+};
+
+/**
+ * The terrain parts of a tile that can stop a voxel trace (open ufo doors left out).
+ * Tiles with the same parts share one voxel occupancy bitmap.
+ */
+struct VoxelParts
+{
+	MapData *parts[4];
+	bool operator<(const VoxelParts &other) const { return std::lexicographical_compare(parts, parts + 4, other.parts, other.parts + 4); }
+};
+
 /**
  * A utility class that modifies tile properties on a battlescape map. This includes lighting, destruction, smoke, fire, fog of war.
  * Note that this function does not handle any sounds or animations.
@@ -43,12 +70,40 @@ private:
 	static const int MAX_VIEW_DISTANCE_SQR = MAX_VIEW_DISTANCE * MAX_VIEW_DISTANCE;
 	static const int MAX_VOXEL_VIEW_DISTANCE = MAX_VIEW_DISTANCE * 16;
 	static const int MAX_DARKNESS_TO_SEE_UNITS = 9;
+	static const size_t MAX_TERRAIN_CHANGES = 4096;
+	static const int VOXEL_LAYERS = 12;
+	static const int VOXEL_ROWS = VOXEL_LAYERS * 16;
 	SavedBattleGame *_save;
 	std::vector<Uint16> *_voxelData;
 	static const int heightFromCenter[11];
-	void addLight(const Position &center, int power, int layer);
 	int blockage(Tile *tile, const int part, ItemDamageType type, int direction = -1, bool checkingFromOrigin = false);
 	bool _personalLighting;
+	std::map<int, FOVCache> _fovCache;
+	std::vector<Position> _terrainChanges;
+	size_t _terrainChangesBase;
+	std::vector<std::pair<Position, int> > _lightSources[3];
+	std::vector<int> _lightCounts[3];
+	/// Sets the light sources of a lighting layer of the whole map.
+	void applyLights(const std::vector<std::pair<Position, int> > &lights, int layer);
+	/// Finds the units and traces the terrain in a unit's field of view.
+	void scanFOV(BattleUnit *unit, std::vector<BattleUnit*> &seen);
+	/// Applies the results of a field of view scan to the unit and the map.
+	bool applyFOV(BattleUnit *unit, const std::vector<BattleUnit*> &seen);
+	/// Traces the tiles in a player unit's field of view.
+	void traceFOVTiles(BattleUnit *unit, FOVCache &cache, const Position &center, const Position &origin, int direction);
+	/// Checks if a line of sight can be affected by any of the terrain changes.
+	bool touchesTerrainChange(const std::vector<Position> &changes, const Position &origin, const Position &target) const;
+	std::vector<int> _voxelSlots;
+	std::vector<Uint16> _voxelBitmaps;
+	std::map<VoxelParts, int> _voxelSlotIndex;
+	/// Builds the terrain voxel occupancy of the whole map.
+	void buildVoxelOccupancy();
+	/// Gets the voxel occupancy bitmap for the current terrain of a tile.
+	int getVoxelSlot(Tile *tile);
+	static const int LINE_LANES = 4;
+	/// Traces up to LINE_LANES lines from one origin side by side.
+	void calculateLineLanes(const Position &origin, const Position *targets, int count, int *results, Position *impacts, BattleUnit *excludeUnit, bool onlyVisible, BattleUnit *excludeAllBut);
+	friend class FOVJob;
 public:
 	/// Creates a new TileEngine class.
 	TileEngine(SavedBattleGame *save, std::vector<Uint16> *voxelData);
@@ -62,6 +117,8 @@ public:
 	bool calculateFOV(BattleUnit *unit);
 	/// Calculates the field of view within range of a certain position.
 	void calculateFOV(const Position &position);
+	/// Marks the terrain of a tile as changed.
+	void markTerrainChanged(const Position &pos);
 	/// Checks reaction fire.
 	bool checkReactionFire(BattleUnit *unit);
 	/// Recalculates lighting of the battlescape for terrain.
@@ -78,8 +135,12 @@ public:
 	int unitOpensDoor(BattleUnit *unit, bool rClick = false, int dir = -1);
 	/// Closes ufo doors.
 	int closeUfoDoors();
+	/// Gets the terrain ready to trace lines from several threads at once.
+	void prepareLineTracing();
 	/// Calculates a line trajectory.
 	int calculateLine(const Position& origin, const Position& target, bool storeTrajectory, std::vector<Position> *trajectory, BattleUnit *excludeUnit, bool doVoxelCheck = true, bool onlyVisible = false, BattleUnit *excludeAllBut = 0);
+	/// Traces lines from one origin to many targets.
+	void calculateLines(const Position &origin, const Position *targets, int count, int *results, Position *impacts, BattleUnit *excludeUnit, bool onlyVisible = false, BattleUnit *excludeAllBut = 0);
 	/// Calculates a parabola trajectory.
 	int calculateParabola(const Position& origin, const Position& target, bool storeTrajectory, std::vector<Position> *trajectory, BattleUnit *excludeUnit, double curvature, const Position delta);
 	/// Gets the origin voxel of a unit's eyesight.
@@ -33,6 +33,7 @@
 #include "../Ruleset/Ruleset.h"
 #include "../Engine/ShaderDraw.h"
 #include "../Engine/ShaderMove.h"
+#include "../Engine/ShaderRow.h"
 #include "../Engine/Options.h"
 
 namespace OpenXcom
@@ -153,6 +154,23 @@ struct ColorReplace
 
 }
 
+namespace helper
+{
+
+/**
+ * Recolors whole rows of a unit sprite at once.
+ */
+template<>
+struct row_draw<ColorReplace>
+{
+	static inline void draw(int size, controler<ShaderMove<Uint8> >& dest, controler<ShaderMove<Uint8> >& src, controler<Scalar<const std::pair<Uint8, Uint8>*> >& color, controler<Scalar<int> >& colorSize, controler<Nothing>&)
+	{
+		recolorRow(&dest.get_ref(), &src.get_ref(), size, color.get_ref(), colorSize.get_ref());
+	}
+};
+
+}
+
 void UnitSprite::drawRecolored(Surface *src)
 {
 	if (_colorSize)
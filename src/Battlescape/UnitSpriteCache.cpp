@@ -0,0 +1,192 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "UnitSpriteCache.h"
+#include <algorithm>
+#include "../Engine/Options.h"
+#include "../Engine/Surface.h"
+#include "../Ruleset/Armor.h"
+#include "../Ruleset/RuleItem.h"
+#include "../Savegame/BattleUnit.h"
+#include "../Savegame/BattleItem.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Collects what UnitSprite uses to draw a part of a unit.
+ * @param unit The unit.
+ * @param part Part of the unit (large units have 4).
+ * @param rightItem Item in the right hand.
+ * @param leftItem Item in the left hand.
+ * @param animFrame Animation frame of the map.
+ * @param helmet Is the unit underwater?
+ * @param width Width of the sprite.
+ */
+UnitSpriteKey::UnitSpriteKey(BattleUnit *unit, int part, BattleItem *rightItem, BattleItem *leftItem, int animFrame, bool helmet, int width) : armor(unit->getArmor())
+{
+	state.reserve(32);
+	state.push_back(part);
+	state.push_back(animFrame);
+	state.push_back(helmet);
+	state.push_back(width);
+	state.push_back(unit->getStatus());
+	state.push_back(unit->getDirection());
+	state.push_back(unit->getTurretDirection());
+	state.push_back(unit->getTurretType());
+	state.push_back(unit->getWalkingPhase());
+	state.push_back(unit->getFallingPhase());
+	state.push_back(unit->isOut());
+	state.push_back(unit->isKneeled());
+	state.push_back(unit->isFloating());
+	state.push_back(unit->getMovementType());
+	state.push_back(unit->getGender());
+	state.push_back(unit->getStandHeight());
+	state.push_back(unit->getFloorAbove());
+	state.push_back(unit->getActiveHand() == "STR_LEFT_HAND");
+	// fixed weapons are part of the unit sprite
+	BattleItem *items[] = { rightItem, leftItem };
+	for (int i = 0; i < 2; ++i)
+	{
+		if (items[i] && !items[i]->getRules()->isFixed())
+		{
+			state.push_back(items[i]->getRules()->getHandSprite());
+			state.push_back(items[i]->getRules()->isTwoHanded());
+		}
+		else
+		{
+			state.push_back(-1);
+			state.push_back(0);
+		}
+	}
+	if (Options::battleHairBleach)
+	{
+		const std::vector<std::pair<Uint8, Uint8> > &recolor = unit->getRecolor();
+		for (std::vector<std::pair<Uint8, Uint8> >::const_iterator i = recolor.begin(); i != recolor.end(); ++i)
+		{
+			state.push_back(i->first);
+			state.push_back(i->second);
+		}
+	}
+}
+
+/**
+ * Compares two keys.
+ * @param other Key to compare to.
+ * @return True if this key comes first.
+ */
+bool UnitSpriteKey::operator<(const UnitSpriteKey &other) const
+{
+	if (armor != other.armor)
+	{
+		return armor < other.armor;
+	}
+	return state < other.state;
+}
+
+/**
+ * Creates an empty cache.
+ * @param capacity Most sprites to keep.
+ */
+UnitSpriteCache::UnitSpriteCache(size_t capacity) : _capacity(capacity), _hits(0), _misses(0)
+{
+}
+
+/**
+ * Deletes the cache.
+ */
+UnitSpriteCache::~UnitSpriteCache()
+{
+}
+
+/**
+ * Looks for a sprite in the cache, and copies it over
+ * the surface if it's there, marking it as recently used.
+ * @param key Key of the sprite.
+ * @param surface Surface to copy it to, of the sprite's size.
+ * @return True if the sprite was in the cache.
+ */
+bool UnitSpriteCache::get(const UnitSpriteKey &key, Surface *surface)
+{
+	std::map<UnitSpriteKey, EntryList::iterator>::iterator i = _index.find(key);
+	if (i == _index.end())
+	{
+		_misses++;
+		return false;
+	}
+	_hits++;
+	_entries.splice(_entries.begin(), _entries, i->second);
+
+	SDL_Surface *s = surface->getSurface();
+	const std::vector<Uint8> &pixels = i->second->second;
+	for (int y = 0; y < s->h; ++y)
+	{
+		std::copy(pixels.begin() + y * s->w, pixels.begin() + (y + 1) * s->w, (Uint8*)s->pixels + y * s->pitch);
+	}
+	return true;
+}
+
+/**
+ * Stores a copy of a sprite in the cache, dropping
+ * the least recently used one if it's full.
+ * @param key Key of the sprite.
+ * @param surface Surface with the sprite drawn on it.
+ */
+void UnitSpriteCache::add(const UnitSpriteKey &key, Surface *surface)
+{
+	if (_capacity == 0 || _index.find(key) != _index.end())
+	{
+		return;
+	}
+	if (_entries.size() >= _capacity)
+	{
+		_index.erase(_entries.back().first);
+		_entries.pop_back();
+	}
+
+	SDL_Surface *s = surface->getSurface();
+	_entries.push_front(std::make_pair(key, std::vector<Uint8>(s->w * s->h)));
+	std::vector<Uint8> &pixels = _entries.front().second;
+	for (int y = 0; y < s->h; ++y)
+	{
+		std::copy((Uint8*)s->pixels + y * s->pitch, (Uint8*)s->pixels + y * s->pitch + s->w, pixels.begin() + y * s->w);
+	}
+	_index[key] = _entries.begin();
+}
+
+/**
+ * Gets how many sprites were found in the cache
+ * instead of being drawn.
+ * @return Number of hits.
+ */
+int UnitSpriteCache::getHits() const
+{
+	return _hits;
+}
+
+/**
+ * Gets how many sprites weren't found in the cache
+ * and had to be drawn.
+ * @return Number of misses.
+ */
+int UnitSpriteCache::getMisses() const
+{
+	return _misses;
+}
+
+}
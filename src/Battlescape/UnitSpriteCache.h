@@ -0,0 +1,81 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_UNITSPRITECACHE_H
+#define OPENXCOM_UNITSPRITECACHE_H
+
+#include <list>
+#include <map>
+#include <vector>
+#include <SDL.h>
+
+namespace OpenXcom
+{
+
+class Armor;
+class BattleUnit;
+class BattleItem;
+class Surface;
+
+/**
+ * Everything a UnitSprite looks at to draw a part of a unit,
+ * so units with the same key look exactly the same.
+ */
+struct UnitSpriteKey
+{
+	const Armor *armor;
+	std::vector<int> state;
+
+	/// Creates the key of a part of a unit.
+	UnitSpriteKey(BattleUnit *unit, int part, BattleItem *rightItem, BattleItem *leftItem, int animFrame, bool helmet, int width);
+	/// Orders keys for lookups.
+	bool operator<(const UnitSpriteKey &other) const;
+};
+
+/**
+ * Keeps the unit sprites the battlescape composed recently,
+ * so units that look the same (a squad in the same armor,
+ * a group of aliens) reuse them instead of drawing them again.
+ * The least recently used sprites are dropped when it's full.
+ */
+class UnitSpriteCache
+{
+private:
+	typedef std::list<std::pair<UnitSpriteKey, std::vector<Uint8> > > EntryList;
+	size_t _capacity;
+	EntryList _entries;
+	std::map<UnitSpriteKey, EntryList::iterator> _index;
+	int _hits, _misses;
+public:
+	/// Creates a cache holding a number of sprites.
+	UnitSpriteCache(size_t capacity);
+	/// Cleans up the cache.
+	~UnitSpriteCache();
+	/// Copies a cached sprite onto a surface.
+	bool get(const UnitSpriteKey &key, Surface *surface);
+	/// Adds a sprite to the cache.
+	void add(const UnitSpriteKey &key, Surface *surface);
+	/// Gets the number of sprites found in the cache.
+	int getHits() const;
+	/// Gets the number of sprites not found in the cache.
+	int getMisses() const;
+};
+
+}
+
+#endif
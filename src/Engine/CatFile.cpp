@@ -18,37 +18,50 @@
  */
 
 #include "CatFile.h"
+#include <cstring>
+#include <algorithm>
 #include <SDL.h>
 
 namespace OpenXcom
 {
 
 /**
- * Creates a CAT file stream. A CAT file starts with an index of the
+ * Opens a CAT file. A CAT file starts with an index of the
  * offset and size of every file contained within. Each file consists
  * of a filename followed by its contents.
  * @param path Full path to CAT file.
  */
-CatFile::CatFile(const char *path) : std::ifstream(path, std::ios::in | std::ios::binary), _amount(0), _offset(0), _size(0)
+CatFile::CatFile(const char *path) : _file(path), _amount(0), _offset(0), _size(0)
 {
+	const char *data = _file.getData();
+	size_t size = _file.getSize();
+
 	// Get amount of files
-	read((char*)&_amount, sizeof(_amount));
+	if (size >= sizeof(_amount))
+	{
+		memcpy(&_amount, data, sizeof(_amount));
+	}
 
 	_amount = (unsigned int)SDL_SwapLE32(_amount);
 	_amount /= 2 * sizeof(_amount);
+	_amount = std::min((size_t)_amount, size / (2 * sizeof(_amount)));
 
 	// Get object offsets
-	seekg(0, std::ios::beg);
-
 	_offset = new unsigned int[_amount];
 	_size   = new unsigned int[_amount];
 
 	for (unsigned int i = 0; i < _amount; ++i)
 	{
-		read((char*)&_offset[i], sizeof(*_offset));
+		memcpy(&_offset[i], data + i * 2 * sizeof(_amount), sizeof(*_offset));
 		_offset[i] = (unsigned int)SDL_SwapLE32(_offset[i]);
-		read((char*)&_size[i],   sizeof(*_size));
+		memcpy(&_size[i], data + i * 2 * sizeof(_amount) + sizeof(*_offset), sizeof(*_size));
 		_size[i] = (unsigned int)SDL_SwapLE32(_size[i]);
+
+		// don't let broken entries point outside the file
+		if (_offset[i] > size)
+		{
+			_offset[i] = size;
+		}
 	}
 }
 
@@ -59,41 +72,72 @@ CatFile::~CatFile()
 {
 	delete[] _offset;
 	delete[] _size;
+}
 
-	close();
+/**
+ * Gets the size of an object.
+ * @param i Object number.
+ * @param name Include the internal file name.
+ * @return Size in bytes.
+ */
+unsigned int CatFile::getObjectSize(unsigned int i, bool name) const
+{
+	if (i >= _amount)
+		return 0;
+
+	unsigned int size = _size[i];
+	if (name && _offset[i] < _file.getSize())
+	{
+		unsigned char namesize = _file.getData()[_offset[i]];
+		if (namesize<=56)
+		{
+			size += namesize + 1;
+		}
+	}
+	// don't let the object run past the end of the file
+	size_t available = _file.getSize() - (getObject(i, name) - _file.getData());
+	return std::min((size_t)size, available);
 }
 
 /**
- * Loads an object into memory.
- * @param i Object number to load.
+ * Gets an object straight from the mapped file, without copying it.
+ * The object stays valid as long as the CAT file is open.
+ * @param i Object number.
  * @param name Preserve internal file name.
- * @return Pointer to the loaded object.
+ * @return Pointer to the object.
  */
-char *CatFile::load(unsigned int i, bool name)
+const char *CatFile::getObject(unsigned int i, bool name) const
 {
 	if (i >= _amount)
 		return 0;
 
-	seekg(_offset[i], std::ios::beg);
-
-	unsigned char namesize = peek();
+	const char *object = _file.getData() + _offset[i];
 	// Skip filename (if there's any)
-	if (namesize<=56)
+	if (!name && _offset[i] < _file.getSize())
 	{
-		if (!name)
+		unsigned char namesize = *object;
+		if (namesize<=56)
 		{
-			seekg(namesize + 1, std::ios::cur);
-		}
-		else
-		{
-			_size[i] += namesize + 1;
+			object += std::min((size_t)namesize + 1, _file.getSize() - _offset[i]);
 		}
 	}
+	return object;
+}
 
-	// Read object
-	char *object = new char[_size[i]];
-	read(object, _size[i]);
+/**
+ * Loads a copy of an object into memory.
+ * @param i Object number to load.
+ * @param name Preserve internal file name.
+ * @return Pointer to the loaded object.
+ */
+char *CatFile::load(unsigned int i, bool name) const
+{
+	if (i >= _amount)
+		return 0;
 
+	unsigned int size = getObjectSize(i, name);
+	char *object = new char[size];
+	memcpy(object, getObject(i, name), size);
 	return object;
 }
 
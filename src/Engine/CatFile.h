@@ -20,27 +20,30 @@
 #ifndef OPENXCOM_CATFILE_H
 #define OPENXCOM_CATFILE_H
 
-#include <fstream>
+#include "MappedFile.h"
 
 namespace OpenXcom
 {
 
 /**
- * Subclass of std::ifstream to handle CAT files
+ * Handles CAT files, which pack several objects
+ * (sounds, musics) into one file. The file is mapped
+ * into memory and objects are read straight from it.
  */
-class CatFile : protected std::ifstream
+class CatFile
 {
 private:
+	MappedFile _file;
 	unsigned int _amount, *_offset, *_size;
 public:
-	/// Creates a CAT file stream.
+	/// Opens a CAT file.
 	CatFile(const char *path);
-	/// Cleans up the stream.
+	/// Cleans up the CAT file.
 	~CatFile();
-	/// Inherit operator.
+	/// Checks if the file couldn't be opened.
 	bool operator !() const
 	{
-		return std::ifstream::operator!();
+		return !_file;
 	}
 	/// Get amount of objects.
 	int getAmount() const
@@ -48,12 +51,11 @@ public:
 		return _amount;
 	}
 	/// Get object size.
-	unsigned int getObjectSize(unsigned int i) const
-	{
-		return (i < _amount) ? _size[i] : 0;
-	}
+	unsigned int getObjectSize(unsigned int i, bool name = false) const;
+	/// Gets an object without copying it.
+	const char *getObject(unsigned int i, bool name = false) const;
 	/// Load an object into memory.
-	char *load(unsigned int i, bool name = false);
+	char *load(unsigned int i, bool name = false) const;
 };
 
 }
@@ -819,5 +819,23 @@ void setWindowIcon(int winResource, const std::string &unixPath)
 #endif
 }
 
+/**
+ * Gets the number of processors available to the game,
+ * used to size worker thread pools.
+ * @return Number of online processors (at least 1).
+ */
+int getCPUCount()
+{
+	int count = 1;
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	count = (int)info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return std::max(1, count);
+}
+
 }
 }
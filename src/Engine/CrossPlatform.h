@@ -85,6 +85,8 @@ namespace CrossPlatform
 	std::string getDosPath();
 	/// Sets the window icon.
 	void setWindowIcon(int winResource, const std::string &unixPath);
+	/// Gets the number of available processors.
+	int getCPUCount();
 }
 
 }
@@ -27,6 +27,7 @@ namespace OpenXcom
 {
 
 std::wstring Font::_index;
+int Font::_nextId = 0;
 
 SDL_Color Font::_palette[] = {{0, 0, 0, 0},
 			      {255, 255, 255, 255},
@@ -38,7 +39,7 @@ SDL_Color Font::_palette[] = {{0, 0, 0, 0},
 /**
  * Initializes the font with a blank surface.
  */
-Font::Font() : _surface(0), _width(0), _height(0), _spacing(0), _monospace(false)
+Font::Font() : _surface(0), _id(_nextId++), _width(0), _height(0), _spacing(0), _monospace(false)
 {
 }
 
@@ -257,6 +258,16 @@ Surface *Font::getSurface() const
 	return _surface;
 }
 
+/**
+ * Returns a number telling this font apart from every other font
+ * loaded during the game, even after it's gone, unlike its address.
+ * @return Font ID.
+ */
+int Font::getId() const
+{
+	return _id;
+}
+
 void Font::fix(const std::string &file, int width)
 {
 	Surface *s = new Surface(width, 512);
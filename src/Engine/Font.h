@@ -42,8 +42,9 @@ class Font
 private:
 	static std::wstring _index;
 	static SDL_Color _palette[6];
+	static int _nextId;
 	Surface *_surface;
-	int _width, _height, _spacing;
+	int _id, _width, _height, _spacing;
 	std::map<wchar_t, SDL_Rect> _chars;
 	bool _monospace;
 public:
@@ -79,6 +80,8 @@ public:
 	SDL_Rect getCharSize(wchar_t c);
 	/// Gets the font's surface.
 	Surface *getSurface() const;
+	/// Gets the font's unique ID.
+	int getId() const;
 
 	void fix(const std::string &file, int width);
 };
@@ -31,6 +31,7 @@
 #include "../Interface/FpsCounter.h"
 #include "../Resource/ResourcePack.h"
 #include "../Ruleset/Ruleset.h"
+#include "../Ruleset/RulesetCache.h"
 #include "../Savegame/SavedGame.h"
 #include "Palette.h"
 #include "Action.h"
@@ -39,6 +40,7 @@
 #include "Options.h"
 #include "CrossPlatform.h"
 #include "FileMap.h"
+#include "ThreadPool.h"
 #include "../Menu/TestState.h"
 
 namespace OpenXcom
@@ -131,6 +133,8 @@ Game::~Game()
 
 	Mix_CloseAudio();
 
+	ThreadPool::shutdown();
+
 	SDL_Quit();
 }
 
@@ -199,6 +203,10 @@ void Game::run()
 							break;
 					}
 					break;
+				case SDL_VIDEOEXPOSE:
+					// the window contents were lost, put them all back
+					_screen->invalidate();
+					break;
 				case SDL_VIDEORESIZE:
 					if (Options::allowResize)
 					{
@@ -284,7 +292,7 @@ void Game::run()
 				// make a note of when this frame update occured.
 				_timeOfLastFrame = SDL_GetTicks();
 				_fpsCounter->addFrame();
-				_screen->clear();
+				_screen->getSurface()->clear();
 				std::list<State*>::iterator i = _states.end();
 				do
 				{
@@ -528,18 +536,31 @@ Ruleset *Game::getRuleset() const
 
 /**
  * Loads the rulesets specified in the game options.
+ * All the files are parsed up front at the same time,
+ * then loaded one mod after another so later mods
+ * still override earlier ones.
  */
 void Game::loadRulesets()
 {
 	Ruleset::resetGlobalStatics();
 	delete _rules;
 	_rules = new Ruleset();
+	RulesetCache cache(Options::getUserFolder() + "rulesets.cache");
 	const std::vector<std::pair<std::string, std::vector<std::string> > > &rulesets(FileMap::getRulesets());
+	std::vector<RulesetFile> files;
+	for (size_t i = 0; rulesets.size() > i; ++i)
+	{
+		for (std::vector<std::string>::const_iterator j = rulesets[i].second.begin(); j != rulesets[i].second.end(); ++j)
+		{
+			files.push_back(RulesetFile(*j, i));
+		}
+	}
+	Ruleset::parseFiles(files, &cache);
 	for (size_t i = 0; rulesets.size() > i; ++i)
 	{
 		try
 		{
-			_rules->loadModRulesets(rulesets[i].second, i);
+			_rules->loadModRulesets(files, i);
 		}
 		catch (YAML::Exception &e)
 		{
@@ -566,6 +587,7 @@ void Game::loadRulesets()
 				"); disabling mod for next startup");
 		}
 	}
+	cache.save();
 	_rules->sortLists();
 }
 
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MappedFile.h"
+#include <fstream>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace OpenXcom
+{
+
+/**
+ * Opens a file and maps its contents into memory.
+ * If the system can't map it, the file is read instead.
+ * @param path Full path to the file.
+ */
+MappedFile::MappedFile(const std::string &path) : _data(0), _size(0), _open(false), _mapped(false)
+{
+#ifdef _WIN32
+	_mapping = 0;
+	_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		_open = true;
+		_size = GetFileSize(_file, 0);
+		if (_size != 0)
+		{
+			_mapping = CreateFileMappingA(_file, 0, PAGE_READONLY, 0, 0, 0);
+			if (_mapping != 0)
+			{
+				_data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+				_mapped = (_data != 0);
+			}
+		}
+	}
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd != -1)
+	{
+		struct stat info;
+		if (fstat(fd, &info) == 0)
+		{
+			_open = true;
+			_size = info.st_size;
+			if (_size != 0)
+			{
+				void *data = mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (data != MAP_FAILED)
+				{
+					_data = (const char*)data;
+					_mapped = true;
+				}
+			}
+		}
+		// the mapping stays valid after the file is closed
+		close(fd);
+	}
+#endif
+
+	if (_open && _size != 0 && !_mapped)
+	{
+		std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+		_buffer.resize(_size);
+		if (!file.read(&_buffer[0], _size))
+		{
+			_buffer.clear();
+			_size = 0;
+			_open = false;
+		}
+		else
+		{
+			_data = &_buffer[0];
+		}
+	}
+}
+
+/**
+ * Unmaps the file and closes it.
+ */
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (_mapped)
+	{
+		UnmapViewOfFile(_data);
+	}
+	if (_mapping != 0)
+	{
+		CloseHandle(_mapping);
+	}
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_file);
+	}
+#else
+	if (_mapped)
+	{
+		munmap((void*)_data, _size);
+	}
+#endif
+}
+
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_MAPPEDFILE_H
+#define OPENXCOM_MAPPEDFILE_H
+
+#include <string>
+#include <vector>
+
+namespace OpenXcom
+{
+
+/**
+ * Read-only view of a whole file in memory. The file is mapped
+ * into memory by the system when possible, so its contents are
+ * only paged in when they're read and stay in the system's cache
+ * between runs. Otherwise it's just read into a buffer.
+ */
+class MappedFile
+{
+private:
+	const char *_data;
+	size_t _size;
+	bool _open, _mapped;
+	std::vector<char> _buffer;
+#ifdef _WIN32
+	void *_file, *_mapping;
+#endif
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+public:
+	/// Maps a file into memory.
+	MappedFile(const std::string &path);
+	/// Unmaps the file.
+	~MappedFile();
+	/// Checks if the file couldn't be opened.
+	bool operator!() const
+	{
+		return !_open;
+	}
+	/// Gets the contents of the file.
+	const char *getData() const
+	{
+		return _data;
+	}
+	/// Gets the size of the file.
+	size_t getSize() const
+	{
+		return _size;
+	}
+};
+
+}
+
+#endif
@@ -16,6 +16,7 @@
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <cstring>
 
 #include "OpenGL.h"
 #include "Logger.h"
@@ -91,8 +92,49 @@ PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocation = 0;
 PFNGLUNIFORM1IPROC glUniform1i = 0;
 PFNGLUNIFORM2FVPROC glUniform2fv = 0;
 PFNGLUNIFORM4FVPROC glUniform4fv = 0;
+PFNGLGETPROGRAMIVPROC glGetProgramiv = 0;
+PFNGLACTIVETEXTUREPROC glActiveTexture = 0;
+PFNGLGENBUFFERSPROC glGenBuffers = 0;
+PFNGLDELETEBUFFERSPROC glDeleteBuffers = 0;
+PFNGLBINDBUFFERPROC glBindBuffer = 0;
+PFNGLBUFFERDATAPROC glBufferData = 0;
+PFNGLMAPBUFFERPROC glMapBuffer = 0;
+PFNGLUNMAPBUFFERPROC glUnmapBuffer = 0;
+PFNGLGENFRAMEBUFFERSEXTPROC glGenFramebuffersEXT = 0;
+PFNGLDELETEFRAMEBUFFERSEXTPROC glDeleteFramebuffersEXT = 0;
+PFNGLBINDFRAMEBUFFEREXTPROC glBindFramebufferEXT = 0;
+PFNGLFRAMEBUFFERTEXTURE2DEXTPROC glFramebufferTexture2DEXT = 0;
+PFNGLCHECKFRAMEBUFFERSTATUSEXTPROC glCheckFramebufferStatusEXT = 0;
 #endif
 
+/* Looks up a palette index in a 256x1 texture of colors, so the
+   8bpp screen can go to the card as it is instead of being
+   converted to 32bpp first.
+ */
+static const char *paletteVertexShader =
+  "void main() {\n"
+  "  gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+  "  gl_Position = ftransform();\n"
+  "}\n";
+static const char *paletteFragmentShader =
+  "uniform sampler2D indexTexture;\n"
+  "uniform sampler2D paletteTexture;\n"
+  "void main() {\n"
+  "  float index = texture2D(indexTexture, gl_TexCoord[0].xy).r;\n"
+  "  vec3 color = texture2D(paletteTexture, vec2(index * (255.0 / 256.0) + (0.5 / 256.0), 0.5)).rgb;\n"
+  "  gl_FragColor = vec4(color, 1.0);\n"
+  "}\n";
+
+static bool hasExtension(const char *name) {
+  const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+  if (!extensions) return false;
+  size_t length = strlen(name);
+  for (const char *found = strstr(extensions, name); found; found = strstr(found + length, name)) {
+    if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0')) return true;
+  }
+  return false;
+}
+
 void * (APIENTRYP glXGetCurrentDisplay)() = 0;
 Uint32 (APIENTRYP glXGetCurrentDrawable)() = 0;
 void (APIENTRYP glXSwapIntervalEXT)(void *display, Uint32 GLXDrawable, int interval);
@@ -115,12 +157,46 @@ Uint32 (APIENTRYP wglSwapIntervalEXT)(int interval);
 	glErrorCheck();
     glPixelStorei(GL_UNPACK_ROW_LENGTH, iwidth);
 	glErrorCheck();
+    // the palette pass draws into this texture, so it has to be a format we can render to
     glTexImage2D(GL_TEXTURE_2D,
-      /* mip-map level = */ 0, /* internal format = */ GL_RGB16_EXT,
+      /* mip-map level = */ 0, /* internal format = */ palette_support ? GL_RGBA8 : GL_RGB16_EXT,
       width, height, /* border = */ 0, /* format = */ GL_BGRA,
       iformat, buffer);
 	glErrorCheck();
 
+    if (palette_support) {
+      if (glindextexture == 0) glGenTextures(1, &glindextexture);
+      glBindTexture(GL_TEXTURE_2D, glindextexture);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, width, height, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, 0);
+
+      if (glpalettetexture == 0) glGenTextures(1, &glpalettetexture);
+      glBindTexture(GL_TEXTURE_2D, glpalettetexture);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 256, 1, 0, GL_BGRA, iformat, 0);
+	  glErrorCheck();
+
+      if (glframebuffer == 0) glGenFramebuffersEXT(1, &glframebuffer);
+      glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, glframebuffer);
+      glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, gltexture, 0);
+      GLenum status = glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT);
+      glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+      glBindTexture(GL_TEXTURE_2D, gltexture);
+	  glErrorCheck();
+
+      if (status != GL_FRAMEBUFFER_COMPLETE_EXT) {
+        Log(LOG_WARNING) << "OpenGL: can't render to the screen texture, converting the palette on the CPU instead.";
+        palette_support = false;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16_EXT, width, height, 0, GL_BGRA, iformat, buffer);
+	    glErrorCheck();
+      }
+    }
   }
 
   bool OpenGL::lock(uint32_t *&data, unsigned &pitch) {
@@ -136,6 +212,106 @@ Uint32 (APIENTRYP wglSwapIntervalEXT)(int interval);
 	glErrorCheck();
   }
 
+  void OpenGL::upload(SDL_Surface *src, const SDL_Rect *area) {
+    SDL_Rect rect = {0, 0, (Uint16)iwidth, (Uint16)iheight};
+    if (area) {
+      rect = *area;
+    }
+    if (rect.w == 0 || rect.h == 0) return;
+
+    if (palette_support && src->format->BitsPerPixel == 8) {
+      // the colors only change along with a full upload
+      if (!area && src->format->palette) {
+        Uint32 colors[256] = {0};
+        for (int i = 0; i < src->format->palette->ncolors && i < 256; ++i) {
+          const SDL_Color &c = src->format->palette->colors[i];
+          colors[i] = 0xFF000000 | (c.r << 16) | (c.g << 8) | c.b;
+        }
+        SDL_Rect all = {0, 0, 256, 1};
+        upload_rect(glpalettetexture, GL_BGRA, iformat, 4, colors, sizeof(colors), all);
+      }
+      upload_rect(glindextexture, GL_LUMINANCE, GL_UNSIGNED_BYTE, 1, src->pixels, src->pitch, rect);
+      expand_palette(rect);
+    } else if (src->format->BitsPerPixel == 32) {
+      upload_rect(gltexture, GL_BGRA, iformat, 4, src->pixels, src->pitch, rect);
+    } else {
+      SDL_Surface *dst = buffer_surface->getSurface();
+      SDL_Rect dstrect = rect;
+      SDL_BlitSurface(src, &rect, dst, &dstrect);
+      upload_rect(gltexture, GL_BGRA, iformat, 4, dst->pixels, dst->pitch, rect);
+    }
+    glBindTexture(GL_TEXTURE_2D, gltexture);
+	glErrorCheck();
+  }
+
+  void OpenGL::upload_rect(GLuint texture, GLenum format, GLenum type, unsigned bytes, const void *pixels, unsigned pitch, const SDL_Rect &rect) {
+    const Uint8 *first = (const Uint8*)pixels + rect.y * pitch + rect.x * bytes;
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    if (pbo_support) {
+      // orphaning the old storage lets the card keep reading the last
+      // frame while we fill the next one, so nobody has to wait
+      unsigned rowSize = rect.w * bytes;
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, glpbo[pbo_index]);
+      pbo_index = 1 - pbo_index;
+      glBufferData(GL_PIXEL_UNPACK_BUFFER_ARB, rowSize * rect.h, 0, GL_STREAM_DRAW);
+      Uint8 *mapped = (Uint8*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY);
+      if (mapped) {
+        for (int y = 0; y < rect.h; ++y) {
+          memcpy(mapped + y * rowSize, first + y * pitch, rowSize);
+        }
+        if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB)) {
+          glPixelStorei(GL_UNPACK_ROW_LENGTH, rect.w);
+          glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.w, rect.h, format, type, 0);
+          glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+	      glErrorCheck();
+          return;
+        }
+      }
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch / bytes);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.w, rect.h, format, type, first);
+	glErrorCheck();
+  }
+
+  void OpenGL::expand_palette(const SDL_Rect &rect) {
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, glframebuffer);
+    glViewport(0, 0, iwidth, iheight);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, iwidth, 0, iheight, -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    glUseProgram(glpaletteprogram);
+    glUniform1i(glGetUniformLocation(glpaletteprogram, "indexTexture"), 0);
+    glUniform1i(glGetUniformLocation(glpaletteprogram, "paletteTexture"), 1);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, glpalettetexture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, glindextexture);
+	glErrorCheck();
+
+    //texture rows go up the framebuffer the same way they go down the screen,
+    //so no flipping here
+    double x1 = double(rect.x) / double(iwidth);
+    double x2 = double(rect.x + rect.w) / double(iwidth);
+    double y1 = double(rect.y) / double(iheight);
+    double y2 = double(rect.y + rect.h) / double(iheight);
+    glBegin(GL_TRIANGLE_STRIP);
+    glTexCoord2f(x1, y1); glVertex3i(rect.x, rect.y, 0);
+    glTexCoord2f(x2, y1); glVertex3i(rect.x + rect.w, rect.y, 0);
+    glTexCoord2f(x1, y2); glVertex3i(rect.x, rect.y + rect.h, 0);
+    glTexCoord2f(x2, y2); glVertex3i(rect.x + rect.w, rect.y + rect.h, 0);
+    glEnd();
+
+    glUseProgram(0);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+	glErrorCheck();
+  }
+
   void OpenGL::refresh(bool smooth, unsigned inwidth, unsigned inheight, unsigned outwidth, unsigned outheight, int topBlackBand, int bottomBlackBand, int leftBlackBand, int rightBlackBand) {
     while (glGetError() != GL_NO_ERROR); // clear possible error from who knows where
 	clear();
@@ -158,6 +334,7 @@ Uint32 (APIENTRYP wglSwapIntervalEXT)(int interval);
 
 	glErrorCheck();
 
+    glBindTexture(GL_TEXTURE_2D, gltexture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, smooth ? GL_LINEAR : GL_NEAREST);
@@ -175,14 +352,7 @@ Uint32 (APIENTRYP wglSwapIntervalEXT)(int interval);
 
 	glErrorCheck();
 
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, buffer_surface->getSurface()->pitch / buffer_surface->getSurface()->format->BytesPerPixel);
-
-	glErrorCheck();
-
-    glTexSubImage2D(GL_TEXTURE_2D,
-      /* mip-map level = */ 0, /* x = */ 0, /* y = */ 0,
-      iwidth, iheight, GL_BGRA, iformat, buffer);
-
+    // the texture itself is kept up to date by upload()
 
     //OpenGL projection sets 0,0 as *bottom-left* of screen.
     //therefore, below vertices flip image to support top-left source.
@@ -288,6 +458,19 @@ Uint32 (APIENTRYP wglSwapIntervalEXT)(int interval);
     glUniform1i = (PFNGLUNIFORM1IPROC)glGetProcAddress("glUniform1i");
     glUniform2fv = (PFNGLUNIFORM2FVPROC)glGetProcAddress("glUniform2fv");
     glUniform4fv = (PFNGLUNIFORM4FVPROC)glGetProcAddress("glUniform4fv");
+    glGetProgramiv = (PFNGLGETPROGRAMIVPROC)glGetProcAddress("glGetProgramiv");
+    glActiveTexture = (PFNGLACTIVETEXTUREPROC)glGetProcAddress("glActiveTexture");
+    glGenBuffers = (PFNGLGENBUFFERSPROC)glGetProcAddress("glGenBuffers");
+    glDeleteBuffers = (PFNGLDELETEBUFFERSPROC)glGetProcAddress("glDeleteBuffers");
+    glBindBuffer = (PFNGLBINDBUFFERPROC)glGetProcAddress("glBindBuffer");
+    glBufferData = (PFNGLBUFFERDATAPROC)glGetProcAddress("glBufferData");
+    glMapBuffer = (PFNGLMAPBUFFERPROC)glGetProcAddress("glMapBuffer");
+    glUnmapBuffer = (PFNGLUNMAPBUFFERPROC)glGetProcAddress("glUnmapBuffer");
+    glGenFramebuffersEXT = (PFNGLGENFRAMEBUFFERSEXTPROC)glGetProcAddress("glGenFramebuffersEXT");
+    glDeleteFramebuffersEXT = (PFNGLDELETEFRAMEBUFFERSEXTPROC)glGetProcAddress("glDeleteFramebuffersEXT");
+    glBindFramebufferEXT = (PFNGLBINDFRAMEBUFFEREXTPROC)glGetProcAddress("glBindFramebufferEXT");
+    glFramebufferTexture2DEXT = (PFNGLFRAMEBUFFERTEXTURE2DEXTPROC)glGetProcAddress("glFramebufferTexture2DEXT");
+    glCheckFramebufferStatusEXT = (PFNGLCHECKFRAMEBUFFERSTATUSEXTPROC)glGetProcAddress("glCheckFramebufferStatusEXT");
 #endif
 	glXGetCurrentDisplay = (void* (APIENTRYP)())glGetProcAddress("glXGetCurrentDisplay");
 	glXGetCurrentDrawable = (Uint32 (APIENTRYP)())glGetProcAddress("glXGetCurrentDrawable");
@@ -304,8 +487,45 @@ Uint32 (APIENTRYP wglSwapIntervalEXT)(int interval);
 	
     if (shader_support) glprogram = glCreateProgram();
 
+    //stream the screen through pixel buffers (GL 2.1, also in Mesa's llvmpipe)
+    pbo_support = hasExtension("GL_ARB_pixel_buffer_object")
+    && glGenBuffers && glDeleteBuffers && glBindBuffer
+    && glBufferData && glMapBuffer && glUnmapBuffer;
+    if (pbo_support) {
+      glGenBuffers(2, glpbo);
+      pbo_index = 0;
+    }
+
+    //look the palette up on the card, rendering into the screen texture
+    palette_support = shader_support && hasExtension("GL_EXT_framebuffer_object")
+    && glGetProgramiv && glActiveTexture && glGenFramebuffersEXT && glDeleteFramebuffersEXT
+    && glBindFramebufferEXT && glFramebufferTexture2DEXT && glCheckFramebufferStatusEXT;
+    if (palette_support) {
+      glpaletteprogram = glCreateProgram();
+      GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
+      glShaderSource(vertex, 1, &paletteVertexShader, 0);
+      glCompileShader(vertex);
+      glAttachShader(glpaletteprogram, vertex);
+      GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
+      glShaderSource(fragment, 1, &paletteFragmentShader, 0);
+      glCompileShader(fragment);
+      glAttachShader(glpaletteprogram, fragment);
+      glLinkProgram(glpaletteprogram);
+      glDeleteShader(vertex);
+      glDeleteShader(fragment);
+
+      GLint linked = GL_FALSE;
+      glGetProgramiv(glpaletteprogram, GL_LINK_STATUS, &linked);
+      palette_support = (linked == GL_TRUE);
+    }
+	glErrorCheck();
+
+    //rows of 8bpp pixels don't come in multiples of 4
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
     //create surface texture
     resize(w, h);
+    Log(LOG_INFO) << "OpenGL: palette lookup on the " << (palette_support ? "GPU" : "CPU") << ", pixel buffer uploads " << (pbo_support ? "on" : "off") << ".";
   }
 
 	void OpenGL::setVSync(bool sync)
@@ -333,6 +553,26 @@ Uint32 (APIENTRYP wglSwapIntervalEXT)(int interval);
       gltexture = 0;
     }
 
+    if (glindextexture) {
+      glDeleteTextures(1, &glindextexture);
+      glindextexture = 0;
+    }
+
+    if (glpalettetexture) {
+      glDeleteTextures(1, &glpalettetexture);
+      glpalettetexture = 0;
+    }
+
+    if (glframebuffer) {
+      glDeleteFramebuffersEXT(1, &glframebuffer);
+      glframebuffer = 0;
+    }
+
+    if (pbo_support) {
+      glDeleteBuffers(2, glpbo);
+      pbo_support = false;
+    }
+
     if (buffer) {
       buffer = 0;
       iwidth = 0;
@@ -342,7 +582,9 @@ Uint32 (APIENTRYP wglSwapIntervalEXT)(int interval);
     delete buffer_surface;
   }
 
-  OpenGL::OpenGL() : gltexture(0), glprogram(0), fragmentshader(0), linear(false), vertexshader(0),
+  OpenGL::OpenGL() : gltexture(0), glprogram(0), fragmentshader(0), linear(false), vertexshader(0), shader_support(false),
+                     glindextexture(0), glpalettetexture(0), glpaletteprogram(0), glframebuffer(0), palette_support(false),
+                     pbo_index(0), pbo_support(false),
                      buffer(NULL), buffer_surface(NULL), iwidth(0), iheight(0),
                      iformat(GL_UNSIGNED_INT_8_8_8_8_REV), // this didn't seem to be set anywhere before...
                      ibpp(32)                              // ...nor this
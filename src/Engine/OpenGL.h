@@ -35,6 +35,19 @@ extern PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocation;
 extern PFNGLUNIFORM1IPROC glUniform1i;
 extern PFNGLUNIFORM2FVPROC glUniform2fv;
 extern PFNGLUNIFORM4FVPROC glUniform4fv;
+extern PFNGLGETPROGRAMIVPROC glGetProgramiv;
+extern PFNGLACTIVETEXTUREPROC glActiveTexture;
+extern PFNGLGENBUFFERSPROC glGenBuffers;
+extern PFNGLDELETEBUFFERSPROC glDeleteBuffers;
+extern PFNGLBINDBUFFERPROC glBindBuffer;
+extern PFNGLBUFFERDATAPROC glBufferData;
+extern PFNGLMAPBUFFERPROC glMapBuffer;
+extern PFNGLUNMAPBUFFERPROC glUnmapBuffer;
+extern PFNGLGENFRAMEBUFFERSEXTPROC glGenFramebuffersEXT;
+extern PFNGLDELETEFRAMEBUFFERSEXTPROC glDeleteFramebuffersEXT;
+extern PFNGLBINDFRAMEBUFFEREXTPROC glBindFramebufferEXT;
+extern PFNGLFRAMEBUFFERTEXTURE2DEXTPROC glFramebufferTexture2DEXT;
+extern PFNGLCHECKFRAMEBUFFERSTATUSEXTPROC glCheckFramebufferStatusEXT;
 #endif
 
 std::string strGLError(GLenum glErr);
@@ -63,6 +76,16 @@ public:
   GLuint vertexshader;
   bool shader_support;
 
+  GLuint glindextexture;
+  GLuint glpalettetexture;
+  GLuint glpaletteprogram;
+  GLuint glframebuffer;
+  bool palette_support;
+
+  GLuint glpbo[2];
+  unsigned pbo_index;
+  bool pbo_support;
+
   uint32_t *buffer;
   Surface *buffer_surface;
   unsigned iwidth, iheight, iformat, ibpp;
@@ -75,6 +98,12 @@ public:
   bool lock(uint32_t *&data, unsigned &pitch);
   /// make all the pixels go away
   void clear();
+  /// copy the changed part of the screen into the texture
+  void upload(SDL_Surface *src, const SDL_Rect *area);
+  /// copy a rectangle of pixels into a texture, through a pixel buffer if we can
+  void upload_rect(GLuint texture, GLenum format, GLenum type, unsigned bytes, const void *pixels, unsigned pitch, const SDL_Rect &rect);
+  /// turn palette indices into colors on the card
+  void expand_palette(const SDL_Rect &rect);
   /// make the buffer show up on screen
   void refresh(bool smooth, unsigned inwidth, unsigned inheight, unsigned outwidth, unsigned outheight, int topBlackBand, int bottomBlackBand, int leftBlackBand, int rightBlackBand);
   /// set a shader! but what kind?
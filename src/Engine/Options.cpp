@@ -50,6 +50,8 @@ std::string _userFolder;
 std::string _configFolder;
 std::vector<std::string> _userList;
 std::map<std::string, std::string> _commandLine;
+std::string _benchmarkFile;
+int _benchmarkTurns = 10, _benchmarkSeed = 1, _scalerBenchmarkFrames = 0;
 std::vector<OptionInfo> _info;
 std::map<std::string, ModInfo> _modInfos;
 
@@ -73,6 +75,8 @@ void create()
 #endif
 
 	_info.push_back(OptionInfo("maxFrameSkip", &maxFrameSkip, 0));
+	_info.push_back(OptionInfo("maxThreads", &maxThreads, 0));
+	_info.push_back(OptionInfo("atlasMemoryLimit", &atlasMemoryLimit, 32));
 	_info.push_back(OptionInfo("traceAI", &traceAI, false));
 	_info.push_back(OptionInfo("StereoSound", &StereoSound, true));
 	_info.push_back(OptionInfo("baseXResolution", &baseXResolution, Screen::ORIGINAL_WIDTH));
@@ -385,6 +389,22 @@ void loadArgs(int argc, char *argv[])
 				{
 					_configFolder = CrossPlatform::endPath(argv[i]);
 				}
+				else if (argname == "benchmark")
+				{
+					_benchmarkFile = argv[i];
+				}
+				else if (argname == "benchmarkturns")
+				{
+					std::istringstream(argv[i]) >> _benchmarkTurns;
+				}
+				else if (argname == "benchmarkseed")
+				{
+					std::istringstream(argv[i]) >> _benchmarkSeed;
+				}
+				else if (argname == "scalerbenchmark")
+				{
+					std::istringstream(argv[i]) >> _scalerBenchmarkFrames;
+				}
 				else
 				{
 					//save this command line option for now, we will apply it later
@@ -415,6 +435,12 @@ bool showHelp(int argc, char *argv[])
 	help << "        use PATH as the default User Folder instead of auto-detecting" << std::endl << std::endl;
 	help << "-cfg PATH  or  -config PATH" << std::endl;
 	help << "        use PATH as the default Config Folder instead of auto-detecting" << std::endl << std::endl;
+	help << "-benchmark FILE" << std::endl;
+	help << "        play the battle saved in FILE without graphics or sound and report how long it took" << std::endl << std::endl;
+	help << "-benchmarkTurns N  and  -benchmarkSeed N" << std::endl;
+	help << "        number of turns to play in the benchmark (default 10) and seed for its random numbers (default 1)" << std::endl << std::endl;
+	help << "-scalerBenchmark N" << std::endl;
+	help << "        time the xBRZ and HQX filters over N frames each and report the time per frame" << std::endl << std::endl;
 	help << "-KEY VALUE" << std::endl;
 	help << "        set option KEY to VALUE instead of default/loaded value (eg. -displayWidth 640)" << std::endl << std::endl;
 	help << "-help" << std::endl;
@@ -959,6 +985,44 @@ std::string getConfigFolder()
 	return _configFolder;
 }
 
+/**
+ * Returns the battle save to play as a benchmark,
+ * given on the command line.
+ * @return Save file name, empty if there's no benchmark.
+ */
+const std::string &getBenchmarkFile()
+{
+	return _benchmarkFile;
+}
+
+/**
+ * Returns how many turns the benchmark plays.
+ * @return Number of turns.
+ */
+int getBenchmarkTurns()
+{
+	return _benchmarkTurns;
+}
+
+/**
+ * Returns the random seed the benchmark uses.
+ * @return Seed.
+ */
+int getBenchmarkSeed()
+{
+	return _benchmarkSeed;
+}
+
+/**
+ * Returns how many frames the filter benchmark times,
+ * given on the command line.
+ * @return Number of frames, 0 if there's no benchmark.
+ */
+int getScalerBenchmarkFrames()
+{
+	return _scalerBenchmarkFrames;
+}
+
 /**
  * Returns the game's list of all available option information.
  * @return List of OptionInfo's.
@@ -85,6 +85,14 @@ namespace Options
 	std::string getUserFolder();
 	/// Gets the game's config folder.
 	std::string getConfigFolder();
+	/// Gets the battle save to play as a benchmark.
+	const std::string &getBenchmarkFile();
+	/// Gets the number of turns the benchmark plays.
+	int getBenchmarkTurns();
+	/// Gets the random seed of the benchmark.
+	int getBenchmarkSeed();
+	/// Gets the number of frames of the filter benchmark.
+	int getScalerBenchmarkFrames();
 	/// Gets the game's options.
 	const std::vector<OptionInfo> &getOptionInfo();
 	/// Sets the game's data, user and config folders.
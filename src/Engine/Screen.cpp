@@ -21,6 +21,8 @@
 #include <cmath>
 #include <iomanip>
 #include <limits.h>
+#include <cstring>
+#include <algorithm>
 #include "../lodepng.h"
 #include "Exception.h"
 #include "Surface.h"
@@ -108,7 +110,7 @@ void Screen::makeVideoFlags()
  * Initializes a new display screen for the game to render contents to.
  * The screen is set up based on the current options.
  */
-Screen::Screen() : _baseWidth(ORIGINAL_WIDTH), _baseHeight(ORIGINAL_HEIGHT), _scaleX(1.0), _scaleY(1.0), _flags(0), _numColors(0), _firstColor(0), _pushPalette(false), _surface(0)
+Screen::Screen() : _baseWidth(ORIGINAL_WIDTH), _baseHeight(ORIGINAL_HEIGHT), _scaleX(1.0), _scaleY(1.0), _flags(0), _numColors(0), _firstColor(0), _pushPalette(false), _paletteChanged(false), _fullFlip(true), _surface(0)
 {
 	resetDisplay();	
 	memset(deferredPalette, 0, 256*sizeof(SDL_Color));
@@ -181,17 +183,42 @@ void Screen::handle(Action *action)
  * If the scaling factor is bigger than 1, the entire contents
  * of the buffer are resized by that factor (eg. 2 = doubled)
  * before being put on screen.
+ * Only the part of the buffer that changed since the last flip
+ * is rendered, and nothing at all if it didn't change, unless
+ * the palette changed or the output can't be updated in parts.
  */
 void Screen::flip()
 {
+	SDL_Rect damage;
+	bool damaged = findDamage(&damage);
+	if (!damaged && !_fullFlip && !_paletteChanged)
+	{
+		return;
+	}
+	// OpenGL redraws the whole window every flip, but keeps the
+	// last frame in its texture and only needs the changes
+	bool full = _fullFlip || _paletteChanged || (_screen->flags & SDL_DOUBLEBUF);
+	_fullFlip = false;
+	_paletteChanged = false;
+
+	if (full)
+	{
+		if (_screen->flags & SDL_SWSURFACE) memset(_screen->pixels, 0, _screen->h*_screen->pitch);
+		else SDL_FillRect(_screen, &_clear, 0);
+	}
 	if (getWidth() != _baseWidth || getHeight() != _baseHeight || isOpenGLEnabled())
 	{
-		Zoom::flipWithZoom(_surface->getSurface(), _screen, _topBlackBand, _bottomBlackBand, _leftBlackBand, _rightBlackBand, &glOutput);
+		Zoom::flipWithZoom(_surface->getSurface(), _screen, _topBlackBand, _bottomBlackBand, _leftBlackBand, _rightBlackBand, &glOutput, full ? 0 : &damage);
 	}
-	else
+	else if (full)
 	{
 		SDL_BlitSurface(_surface->getSurface(), 0, _screen, 0);
 	}
+	else
+	{
+		SDL_Rect dstrect = damage;
+		SDL_BlitSurface(_surface->getSurface(), &damage, _screen, &dstrect);
+	}
 
 	// perform any requested palette update
 	if (_pushPalette && _numColors && _screen->format->BitsPerPixel == 8)
@@ -204,12 +231,70 @@ void Screen::flip()
 		_pushPalette = false;
 	}
 
+	if (full)
+	{
+		if (SDL_Flip(_screen) == -1)
+		{
+			throw Exception(SDL_GetError());
+		}
+	}
+	else if (damage.w > 0 && damage.h > 0 && !(_screen->flags & SDL_OPENGL))
+	{
+		SDL_UpdateRects(_screen, 1, &damage);
+	}
+}
 
-	
-	if (SDL_Flip(_screen) == -1)
+/**
+ * Compares the buffer with its contents at the last flip to
+ * find the smallest rectangle holding all the changed pixels.
+ * @param damage Returns the changed rectangle.
+ * @return True if anything changed.
+ */
+bool Screen::findDamage(SDL_Rect *damage)
+{
+	SDL_Surface *buffer = _surface->getSurface();
+	int bytes = buffer->format->BytesPerPixel;
+	int rowSize = buffer->w * bytes;
+	if ((int)_lastFrame.size() != rowSize * buffer->h)
+	{
+		_lastFrame.assign(rowSize * buffer->h, 0);
+		_fullFlip = true;
+	}
+
+	int top = -1, bottom = -1, left = rowSize, right = -1;
+	for (int y = 0; y < buffer->h; ++y)
+	{
+		const Uint8 *row = (const Uint8*)buffer->pixels + y * buffer->pitch;
+		Uint8 *last = &_lastFrame[y * rowSize];
+		if (memcmp(row, last, rowSize) == 0)
+			continue;
+		int first = 0, end = rowSize;
+		while (row[first] == last[first])
+		{
+			++first;
+		}
+		while (row[end - 1] == last[end - 1])
+		{
+			--end;
+		}
+		if (top == -1)
+		{
+			top = y;
+		}
+		bottom = y;
+		left = std::min(left, first);
+		right = std::max(right, end);
+		memcpy(last, row, rowSize);
+	}
+	if (top == -1)
 	{
-		throw Exception(SDL_GetError());
+		return false;
 	}
+	damage->x = left / bytes;
+	damage->y = top;
+	damage->w = (right + bytes - 1) / bytes - damage->x;
+	damage->h = bottom + 1 - top;
+	return true;
 }
 
 /**
@@ -220,6 +305,16 @@ void Screen::clear()
 	_surface->clear();
 	if (_screen->flags & SDL_SWSURFACE) memset(_screen->pixels, 0, _screen->h*_screen->pitch);
 	else SDL_FillRect(_screen, &_clear, 0);
+	_fullFlip = true;
+}
+
+/**
+ * Makes the next flip render the whole buffer, for when
+ * the contents of the game window were lost.
+ */
+void Screen::invalidate()
+{
+	_fullFlip = true;
 }
 
 /**
@@ -246,6 +341,7 @@ void Screen::setPalette(SDL_Color* colors, int firstcolor, int ncolors, bool imm
 	}
 
 	_surface->setPalette(colors, firstcolor, ncolors);
+	_paletteChanged = true;
 
 	// defer actual update of screen until SDL_Flip()
 	if (immediately && _screen->format->BitsPerPixel == 8 && SDL_SetColors(_screen, colors, firstcolor, ncolors) == 0)
@@ -360,6 +456,7 @@ void Screen::resetDisplay(bool resetVideo)
 		clear();
 	}
 
+	_fullFlip = true;
 	Options::displayWidth = getWidth();
 	Options::displayHeight = getHeight();
 	_scaleX = getWidth() / (double)_baseWidth;
@@ -21,6 +21,7 @@
 
 #include <SDL.h>
 #include <string>
+#include <vector>
 #include "OpenGL.h"
 
 namespace OpenXcom
@@ -49,12 +50,15 @@ private:
 	int _zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy);
 	SDL_Color deferredPalette[256];
 	int _numColors, _firstColor;
-	bool _pushPalette;
+	bool _pushPalette, _paletteChanged, _fullFlip;
 	OpenGL glOutput;
 	Surface *_surface;
 	SDL_Rect _clear;
+	std::vector<Uint8> _lastFrame;
 	/// Sets the _flags and _bpp variables based on game options; needed in more than one place now
 	void makeVideoFlags();
+	/// Finds the part of the buffer that changed since the last flip.
+	bool findDamage(SDL_Rect *damage);
 public:
 	static const int ORIGINAL_WIDTH;
 	static const int ORIGINAL_HEIGHT;
@@ -75,6 +79,8 @@ public:
 	void flip();
 	/// Clears the screen.
 	void clear();
+	/// Makes the next flip render the whole screen.
+	void invalidate();
 	/// Sets the screen's 8bpp palette.
 	void setPalette(SDL_Color *colors, int firstcolor = 0, int ncolors = 256, bool immediately = false);
 	/// Gets the screen's 8bpp palette.
@@ -101,10 +101,7 @@ static inline void ShaderDraw(const DestType& dest_frame, const Src0Type& src0_f
 		src3.set_x(begin_x, end_x);
 		
 		//iteration on x-axis
-		for (int x = end_x-begin_x; x>0; --x, dest.inc_x(), src0.inc_x(), src1.inc_x(), src2.inc_x(), src3.inc_x())
-		{
-			ColorFunc::func(dest.get_ref(), src0.get_ref(), src1.get_ref(), src2.get_ref(), src3.get_ref());				
-		}
+		helper::row_draw<ColorFunc>::draw(end_x-begin_x, dest, src0, src1, src2, src3);
 	}
 
 }
@@ -653,6 +653,27 @@ struct controler<ShaderBase<Pixel> > : public controler_base<typename ShaderBase
 	
 };
 
+/**
+ * Draws one row of pixels in `ShaderDraw`.
+ * This version calls `ColorFunc::func` for every pixel. Specialize it
+ * for a `ColorFunc` and the arguments it's used with when a whole row
+ * can be done faster at once, e.g. with vector instructions.
+ * Pixels of surface arguments are next to each other in the row,
+ * starting at `get_ref()` of their controler.
+ */
+template<typename ColorFunc>
+struct row_draw
+{
+	template<typename DestType, typename Src0Type, typename Src1Type, typename Src2Type, typename Src3Type>
+	static inline void draw(int size, controler<DestType>& dest, controler<Src0Type>& src0, controler<Src1Type>& src1, controler<Src2Type>& src2, controler<Src3Type>& src3)
+	{
+		for (int x = size; x>0; --x, dest.inc_x(), src0.inc_x(), src1.inc_x(), src2.inc_x(), src3.inc_x())
+		{
+			ColorFunc::func(dest.get_ref(), src0.get_ref(), src1.get_ref(), src2.get_ref(), src3.get_ref());
+		}
+	}
+};
+
 }//namespace helper
 
 }//namespace OpenXcom
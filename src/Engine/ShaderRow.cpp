@@ -0,0 +1,243 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ShaderRow.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHADERROW_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#define SHADERROW_AVX2
+#include <immintrin.h>
+#endif
+
+namespace OpenXcom
+{
+namespace helper
+{
+
+/**
+ * Shades a row of palette indices, the same as `StandardShade` and
+ * `ColorReplace` in Surface::blitNShade do one pixel at a time.
+ * The color group of each pixel is `(src & keep) | color`, so it
+ * keeps its own group with keep = 0xF0, color = 0, or takes a new
+ * one with keep = 0, color = new group.
+ * @param dest Destination pixels.
+ * @param src Source pixels, 0 is transparent.
+ * @param size Number of pixels.
+ * @param shade Shade to add.
+ * @param keep Bits of the source color group to keep.
+ * @param color Bits of the new color group.
+ */
+static void shadeGroups(Uint8 *dest, const Uint8 *src, int size, int shade, int keep, int color)
+{
+	int x = 0;
+	// past that, adding the shade could overflow a byte
+	if (shade >= 0 && shade <= 15)
+	{
+#ifdef SHADERROW_AVX2
+		const __m256i low32 = _mm256_set1_epi8(15);
+		const __m256i shade32 = _mm256_set1_epi8((char)shade);
+		const __m256i keep32 = _mm256_set1_epi8((char)keep);
+		const __m256i color32 = _mm256_set1_epi8((char)color);
+		for (; x + 32 <= size; x += 32)
+		{
+			__m256i s = _mm256_loadu_si256((const __m256i*)(src + x));
+			__m256i d = _mm256_loadu_si256((const __m256i*)(dest + x));
+			__m256i newShade = _mm256_add_epi8(_mm256_and_si256(s, low32), shade32);
+			__m256i black = _mm256_cmpgt_epi8(newShade, low32);
+			__m256i shaded = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(s, keep32), color32), newShade);
+			shaded = _mm256_blendv_epi8(shaded, low32, black);
+			__m256i transparent = _mm256_cmpeq_epi8(s, _mm256_setzero_si256());
+			_mm256_storeu_si256((__m256i*)(dest + x), _mm256_blendv_epi8(shaded, d, transparent));
+		}
+#endif
+#ifdef SHADERROW_SSE2
+		const __m128i low16 = _mm_set1_epi8(15);
+		const __m128i shade16 = _mm_set1_epi8((char)shade);
+		const __m128i keep16 = _mm_set1_epi8((char)keep);
+		const __m128i color16 = _mm_set1_epi8((char)color);
+		for (; x + 16 <= size; x += 16)
+		{
+			__m128i s = _mm_loadu_si128((const __m128i*)(src + x));
+			__m128i d = _mm_loadu_si128((const __m128i*)(dest + x));
+			__m128i newShade = _mm_add_epi8(_mm_and_si128(s, low16), shade16);
+			__m128i black = _mm_cmpgt_epi8(newShade, low16);
+			__m128i shaded = _mm_or_si128(_mm_or_si128(_mm_and_si128(s, keep16), color16), newShade);
+			shaded = _mm_or_si128(_mm_and_si128(black, low16), _mm_andnot_si128(black, shaded));
+			__m128i transparent = _mm_cmpeq_epi8(s, _mm_setzero_si128());
+			_mm_storeu_si128((__m128i*)(dest + x), _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, shaded)));
+		}
+#endif
+	}
+	for (; x < size; ++x)
+	{
+		if (src[x])
+		{
+			const int newShade = (src[x]&15) + shade;
+			if (newShade > 15)
+				// so dark it would flip over to another color - make it black instead
+				dest[x] = 15;
+			else
+				dest[x] = (src[x]&keep) | color | newShade;
+		}
+	}
+}
+
+/**
+ * Shades a row of palette indices, keeping their color group.
+ * Transparent (0) source pixels leave the destination alone.
+ * @param dest Destination pixels.
+ * @param src Source pixels.
+ * @param size Number of pixels.
+ * @param shade Shade to add, going past black gives black.
+ */
+void shadeRow(Uint8 *dest, const Uint8 *src, int size, int shade)
+{
+	shadeGroups(dest, src, size, shade, 15<<4, 0);
+}
+
+/**
+ * Shades a row of palette indices, moving them to a new color group.
+ * Transparent (0) source pixels leave the destination alone.
+ * @param dest Destination pixels.
+ * @param src Source pixels.
+ * @param size Number of pixels.
+ * @param shade Shade to add, going past black gives black.
+ * @param newColor New color group (already shifted by 4).
+ */
+void shadeRowReplace(Uint8 *dest, const Uint8 *src, int size, int shade, int newColor)
+{
+	shadeGroups(dest, src, size, shade, 0, newColor);
+}
+
+/**
+ * Copies a row of palette indices, like a color keyed blit.
+ * Transparent (0) source pixels leave the destination alone.
+ * @param dest Destination pixels.
+ * @param src Source pixels.
+ * @param size Number of pixels.
+ */
+void maskedCopyRow(Uint8 *dest, const Uint8 *src, int size)
+{
+	int x = 0;
+#ifdef SHADERROW_AVX2
+	for (; x + 32 <= size; x += 32)
+	{
+		__m256i s = _mm256_loadu_si256((const __m256i*)(src + x));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dest + x));
+		__m256i transparent = _mm256_cmpeq_epi8(s, _mm256_setzero_si256());
+		_mm256_storeu_si256((__m256i*)(dest + x), _mm256_blendv_epi8(s, d, transparent));
+	}
+#endif
+#ifdef SHADERROW_SSE2
+	for (; x + 16 <= size; x += 16)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + x));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dest + x));
+		__m128i transparent = _mm_cmpeq_epi8(s, _mm_setzero_si128());
+		_mm_storeu_si128((__m128i*)(dest + x), _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, s)));
+	}
+#endif
+	for (; x < size; ++x)
+	{
+		if (src[x])
+			dest[x] = src[x];
+	}
+}
+
+/**
+ * Replaces color groups in a row of palette indices, the same as
+ * `ColorReplace` in UnitSprite::drawRecolored does one pixel at a time.
+ * The first pair with the pixel's group moves it to the pair's color,
+ * other pixels are copied as they are.
+ * Transparent (0) source pixels leave the destination alone.
+ * @param dest Destination pixels.
+ * @param src Source pixels.
+ * @param size Number of pixels.
+ * @param colors Pairs of color group to replace and color to use.
+ * @param colorSize Number of pairs.
+ */
+void recolorRow(Uint8 *dest, const Uint8 *src, int size, const std::pair<Uint8, Uint8> *colors, int colorSize)
+{
+	int x = 0;
+#ifdef SHADERROW_AVX2
+	const __m256i group32 = _mm256_set1_epi8((char)(15<<4));
+	const __m256i low32 = _mm256_set1_epi8(15);
+	for (; x + 32 <= size; x += 32)
+	{
+		__m256i s = _mm256_loadu_si256((const __m256i*)(src + x));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dest + x));
+		__m256i group = _mm256_and_si256(s, group32);
+		__m256i shade = _mm256_and_si256(s, low32);
+		__m256i recolored = s;
+		__m256i done = _mm256_setzero_si256();
+		for (int i = 0; i < colorSize; ++i)
+		{
+			__m256i match = _mm256_andnot_si256(done, _mm256_cmpeq_epi8(group, _mm256_set1_epi8((char)colors[i].first)));
+			recolored = _mm256_blendv_epi8(recolored, _mm256_add_epi8(_mm256_set1_epi8((char)colors[i].second), shade), match);
+			done = _mm256_or_si256(done, match);
+		}
+		__m256i transparent = _mm256_cmpeq_epi8(s, _mm256_setzero_si256());
+		_mm256_storeu_si256((__m256i*)(dest + x), _mm256_blendv_epi8(recolored, d, transparent));
+	}
+#endif
+#ifdef SHADERROW_SSE2
+	const __m128i group16 = _mm_set1_epi8((char)(15<<4));
+	const __m128i low16 = _mm_set1_epi8(15);
+	for (; x + 16 <= size; x += 16)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + x));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dest + x));
+		__m128i group = _mm_and_si128(s, group16);
+		__m128i shade = _mm_and_si128(s, low16);
+		__m128i recolored = s;
+		__m128i done = _mm_setzero_si128();
+		for (int i = 0; i < colorSize; ++i)
+		{
+			__m128i match = _mm_andnot_si128(done, _mm_cmpeq_epi8(group, _mm_set1_epi8((char)colors[i].first)));
+			__m128i color = _mm_add_epi8(_mm_set1_epi8((char)colors[i].second), shade);
+			recolored = _mm_or_si128(_mm_and_si128(match, color), _mm_andnot_si128(match, recolored));
+			done = _mm_or_si128(done, match);
+		}
+		__m128i transparent = _mm_cmpeq_epi8(s, _mm_setzero_si128());
+		_mm_storeu_si128((__m128i*)(dest + x), _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, recolored)));
+	}
+#endif
+	for (; x < size; ++x)
+	{
+		if (src[x])
+		{
+			int i = 0;
+			while (i < colorSize && (src[x] & (15<<4)) != colors[i].first)
+			{
+				++i;
+			}
+			if (i < colorSize)
+				dest[x] = colors[i].second + (src[x] & 15);
+			else
+				dest[x] = src[x];
+		}
+	}
+}
+
+}//namespace helper
+
+}//namespace OpenXcom
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_SHADERROW_H
+#define OPENXCOM_SHADERROW_H
+
+#include <utility>
+#include <SDL.h>
+
+namespace OpenXcom
+{
+namespace helper
+{
+
+/// Shades a row of palette indices, skipping transparent ones.
+void shadeRow(Uint8 *dest, const Uint8 *src, int size, int shade);
+/// Shades a row of palette indices in a new color group, skipping transparent ones.
+void shadeRowReplace(Uint8 *dest, const Uint8 *src, int size, int shade, int newColor);
+/// Copies a row of palette indices, skipping transparent ones.
+void maskedCopyRow(Uint8 *dest, const Uint8 *src, int size);
+/// Moves the color groups of a row of palette indices, skipping transparent ones.
+void recolorRow(Uint8 *dest, const Uint8 *src, int size, const std::pair<Uint8, Uint8> *colors, int colorSize);
+
+}//namespace helper
+
+}//namespace OpenXcom
+
+#endif	/* OPENXCOM_SHADERROW_H */
@@ -64,8 +64,8 @@ void SoundSet::loadCat(const std::string &filename, bool wav)
 	// Load each sound file
 	for (int i = 0; i < sndFile.getAmount(); ++i)
 	{
-		// Read WAV chunk
-		unsigned char *sound = (unsigned char*) sndFile.load(i);
+		// Read WAV chunk straight from the file
+		const unsigned char *sound = (const unsigned char*) sndFile.getObject(i);
 		unsigned int size = sndFile.getObjectSize(i);
 
 		// If there's no WAV header (44 bytes), add it
@@ -79,7 +79,6 @@ void SoundSet::loadCat(const std::string &filename, bool wav)
 								 0x10, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x11, 0x2b, 0x00, 0x00, 0x11, 0x2b, 0x00, 0x00, 0x01, 0x00, 0x08, 0x00,
 								 'd', 'a', 't', 'a', 0x00, 0x00, 0x00, 0x00};
 
-				for (unsigned int n = 0; n < size; ++n) sound[n] *= 4; // scale to 8 bits
 				if (size > 5) size -= 5; // skip 5 garbage name bytes at beginning
 				if (size) size--; // omit trailing null byte
 
@@ -90,30 +89,30 @@ void SoundSet::loadCat(const std::string &filename, bool wav)
 
 				newsound = new unsigned char[44 + size*2];
 				memcpy(newsound, header, 44);
-				if (size) memcpy(newsound + 44, sound+5, size);
 				Uint32 step16 = (8000<<16)/11025;
 				Uint8 *w = newsound+44;
 				int newsize = 0;
 				for (Uint32 offset16 = 0; (offset16>>16) < size; offset16 += step16, ++w, ++newsize)
 				{
-					*w = sound[5 + (offset16>>16)];
+					*w = sound[5 + (offset16>>16)] * 4; // scale to 8 bits
 				}
 				size = newsize + 44;
 			}
 		}
-		else if (0x40 == sound[0x18] && 0x1F == sound[0x19] && 0x00 == sound[0x1A] && 0x00 == sound[0x1B])
+		else if (size >= 44 && 0x40 == sound[0x18] && 0x1F == sound[0x19] && 0x00 == sound[0x1A] && 0x00 == sound[0x1B])
 		{
 			// so it's WAV, but in 8 khz, we have to convert it to 11 khz sound
 
-			unsigned char *sound2 = new unsigned char[size*2];
+			newsound = new unsigned char[size*2];
+
+			// copy and do the conversion...
+			memcpy(newsound, sound, 44);
 
 			// rewrite the samplerate in the header to 11 khz
-			sound[0x18]=0x11; sound[0x19]=0x2B; sound[0x1C]=0x11; sound[0x1D]=0x2B;
+			newsound[0x18]=0x11; newsound[0x19]=0x2B; newsound[0x1C]=0x11; newsound[0x1D]=0x2B;
 
-			// copy and do the conversion...
-			memcpy(sound2, sound, size);
 			Uint32 step16 = (8000<<16)/11025;
-			Uint8 *w = sound2+44;
+			Uint8 *w = newsound+44;
 			int newsize = 0;
 			for (Uint32 offset16 = 0; (offset16>>16) < size-44; offset16 += step16, ++w, ++newsize)
 			{
@@ -122,11 +121,7 @@ void SoundSet::loadCat(const std::string &filename, bool wav)
 			size = newsize + 44;
 
 			// Rewrite the number of samples in the WAV file
-			memcpy(sound2 + 0x28, &newsize, sizeof(newsize));
-
-			// Ok, now replace the original with the converted:
-			delete[] sound;
-			sound = sound2;
+			memcpy(newsound + 0x28, &newsize, sizeof(newsize));
 		}
 
 		Sound *s = new Sound();
@@ -136,7 +131,7 @@ void SoundSet::loadCat(const std::string &filename, bool wav)
 			{
 				throw Exception("Invalid sound file");
 			}
-			if (wav)
+			if (newsound == 0)
 				s->load(sound, size);
 			else
 				s->load(newsound, size);
@@ -147,11 +142,7 @@ void SoundSet::loadCat(const std::string &filename, bool wav)
 		}
 		_sounds[i] = s;
 
-		delete[] sound;
-		if (!wav)
-		{
-			delete[] newsound;
-		}
+		delete[] newsound;
 	}
 }
 
@@ -215,8 +206,8 @@ void SoundSet::loadCatbyIndex(const std::string &filename, int index)
 		throw Exception(err.str());
 	}
 
-	// Read WAV chunk
-	unsigned char *sound = (unsigned char*) sndFile.load(index);
+	// Read WAV chunk straight from the file
+	const unsigned char *sound = (const unsigned char*) sndFile.getObject(index);
 	unsigned int size = sndFile.getObjectSize(index);
 
 	// there's no WAV header (44 bytes), add it
@@ -242,13 +233,11 @@ void SoundSet::loadCatbyIndex(const std::string &filename, int index)
 		memcpy(newsound, header, 44);
 
 		// TFTD sounds are signed, so we need to convert them.
-		for (unsigned int n = 5; n < size + 5; ++n)
+		for (unsigned int n = 0; n < size; ++n)
 		{
-			int value = (int)sound[n] + 128;
-			sound[n] = (uint8_t)value;
+			int value = (int)sound[n + 5] + 128;
+			newsound[n + 44] = (uint8_t)value;
 		}
-
-		if (size) memcpy(newsound + 44, sound+5, size);
 		size = size + 44;
 	}
 
@@ -267,7 +256,6 @@ void SoundSet::loadCatbyIndex(const std::string &filename, int index)
 	}
 	_sounds[getTotalSounds()] = s;
 
-	delete[] sound;
 	delete[] newsound;
 }
 
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "SpriteAtlas.h"
+#include <algorithm>
+#include "Surface.h"
+#include "SurfaceSet.h"
+#include "ShaderDraw.h"
+#include "ShaderMove.h"
+#include "ShaderRow.h"
+#include "Options.h"
+#include "Logger.h"
+
+namespace OpenXcom
+{
+
+size_t SpriteAtlas::_memoryUsed = 0;
+bool SpriteAtlas::_limitReported = false;
+int SpriteAtlas::_atlases = 0;
+SDL_mutex *SpriteAtlas::_mutex = 0;
+
+/**
+ * help class used for SpriteAtlas::blit
+ */
+struct MaskedCopy
+{
+	/**
+	* Function used by ShaderDraw in SpriteAtlas::blit
+	* copy pixel unless it's transparent
+	* @param dest destination pixel
+	* @param src source pixel
+	*/
+	static inline void func(Uint8& dest, const Uint8& src, const int&, const int&, const int&)
+	{
+		if (src)
+			dest = src;
+	}
+};
+
+namespace helper
+{
+
+/**
+ * Copies whole rows of a shaded frame at once in SpriteAtlas::blit.
+ */
+template<>
+struct row_draw<MaskedCopy>
+{
+	static inline void draw(int size, controler<ShaderMove<Uint8> >& dest, controler<ShaderMove<Uint8> >& src, controler<Nothing>&, controler<Nothing>&, controler<Nothing>&)
+	{
+		maskedCopyRow(&dest.get_ref(), &src.get_ref(), size);
+	}
+};
+
+}//namespace helper
+
+/**
+ * Packs all the frames of a surface set into an atlas
+ * and links them to it, so their shaded blits go through it.
+ * Frames of a different size than the set are left alone.
+ * @param set Surface set to pack.
+ */
+SpriteAtlas::SpriteAtlas(SurfaceSet *set) : _set(set), _width(set->getWidth()), _height(set->getHeight()), _frames(set->getTotalFrames())
+{
+	if (_atlases++ == 0)
+	{
+		_mutex = SDL_CreateMutex();
+	}
+	_shades[0].resize(_width * _height * _frames);
+	int frame = 0;
+	for (std::map<int, Surface*>::iterator i = set->getFrames()->begin(); i != set->getFrames()->end(); ++i, ++frame)
+	{
+		SDL_Surface *surface = i->second->getSurface();
+		if (surface->w != _width || surface->h != _height || surface->format->BytesPerPixel != 1)
+		{
+			continue;
+		}
+		for (int y = 0; y < _height; ++y)
+		{
+			std::copy((Uint8*)surface->pixels + y * surface->pitch, (Uint8*)surface->pixels + y * surface->pitch + _width, _shades[0].begin() + (frame * _height + y) * _width);
+		}
+		i->second->setAtlas(this, frame);
+	}
+	_memoryUsed += getMemory();
+}
+
+/**
+ * Unlinks the frames from the atlas and frees its memory.
+ */
+SpriteAtlas::~SpriteAtlas()
+{
+	for (std::map<int, Surface*>::iterator i = _set->getFrames()->begin(); i != _set->getFrames()->end(); ++i)
+	{
+		i->second->setAtlas(0, 0);
+	}
+	_memoryUsed -= getMemory();
+	if (--_atlases == 0)
+	{
+		SDL_DestroyMutex(_mutex);
+		_mutex = 0;
+	}
+}
+
+/**
+ * Makes the copy of all the frames in a shade, unless
+ * it would take the atlases past their memory limit.
+ * Must be called with the mutex locked.
+ * @param shade Shade level.
+ * @return True if the copy is ready.
+ */
+bool SpriteAtlas::makeShade(int shade)
+{
+	size_t size = _shades[0].size();
+	if (_memoryUsed + size > (size_t)std::max(Options::atlasMemoryLimit, 0) * 1024 * 1024)
+	{
+		if (!_limitReported)
+		{
+			Log(LOG_INFO) << "Sprite atlases reached their memory limit at " << _memoryUsed / 1024 << "KB, more shades are drawn the slow way";
+			_limitReported = true;
+		}
+		return false;
+	}
+	_shades[shade].resize(size, 0);
+	helper::shadeRow(&_shades[shade][0], &_shades[0][0], size, shade);
+	_memoryUsed += size;
+	Log(LOG_DEBUG) << "Sprite atlas of " << _frames << " frames made shade " << shade << ", atlases use " << _memoryUsed / 1024 << "KB";
+	return true;
+}
+
+/**
+ * Blits a frame of the atlas onto another surface in a shade,
+ * giving the same result as Surface::blitNShade with no new color.
+ * @param frame Frame of the atlas.
+ * @param surface Surface to blit to.
+ * @param x X position to blit to.
+ * @param y Y position to blit to.
+ * @param shade Shade to blit in.
+ * @param half Only blit the right half of the frame.
+ * @return False if the shade isn't in the atlas, so the frame has to be shaded on the spot.
+ */
+bool SpriteAtlas::blit(int frame, Surface *surface, int x, int y, int shade, bool half)
+{
+	if (shade < 0)
+	{
+		return false;
+	}
+	// every shade past black looks the same
+	shade = std::min(shade, SHADES - 1);
+	SDL_LockMutex(_mutex);
+	bool ready = !_shades[shade].empty() || makeShade(shade);
+	SDL_UnlockMutex(_mutex);
+	if (!ready)
+	{
+		return false;
+	}
+
+	ShaderMove<Uint8> src(_shades[shade], _width, _height * _frames, x, y - frame * _height);
+	GraphSubset g(std::make_pair(half ? _width/2 : 0, _width), std::make_pair(frame * _height, (frame + 1) * _height));
+	src.setDomain(g);
+	ShaderDraw<MaskedCopy>(ShaderSurface(surface), src);
+	return true;
+}
+
+/**
+ * Gets the memory taken by the frames of the atlas
+ * in all the shades it has copies of.
+ * @return Size in bytes.
+ */
+size_t SpriteAtlas::getMemory() const
+{
+	size_t memory = 0;
+	for (int i = 0; i < SHADES; ++i)
+	{
+		memory += _shades[i].size();
+	}
+	return memory;
+}
+
+/**
+ * Gets the memory taken by all the atlases, to
+ * keep track of it against the memory limit.
+ * @return Size in bytes.
+ */
+size_t SpriteAtlas::getMemoryUsed()
+{
+	return _memoryUsed;
+}
+
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_SPRITEATLAS_H
+#define OPENXCOM_SPRITEATLAS_H
+
+#include <vector>
+#include <SDL.h>
+#include <SDL_thread.h>
+
+namespace OpenXcom
+{
+
+class Surface;
+class SurfaceSet;
+
+/**
+ * Copy of all the frames of a surface set packed in one block
+ * of memory, along with copies of them in each shade, so shaded
+ * frames can be blit straight without working out every pixel.
+ * The shaded copies are made the first time each shade is used,
+ * as long as all the atlases fit in the memory limit.
+ */
+class SpriteAtlas
+{
+private:
+	static const int SHADES = 17;
+	static size_t _memoryUsed;
+	static bool _limitReported;
+	static int _atlases;
+	static SDL_mutex *_mutex;
+	SurfaceSet *_set;
+	int _width, _height, _frames;
+	std::vector<Uint8> _shades[SHADES];
+	/// Makes the copy of the frames in a shade.
+	bool makeShade(int shade);
+public:
+	/// Creates an atlas of a surface set.
+	SpriteAtlas(SurfaceSet *set);
+	/// Cleans up the atlas.
+	~SpriteAtlas();
+	/// Blits a shaded frame of the atlas onto another surface.
+	bool blit(int frame, Surface *surface, int x, int y, int shade, bool half);
+	/// Gets the memory used by the atlas.
+	size_t getMemory() const;
+	/// Gets the memory used by all the atlases.
+	static size_t getMemoryUsed();
+};
+
+}
+
+#endif
@@ -27,6 +27,8 @@
 #include "Palette.h"
 #include "Exception.h"
 #include "ShaderMove.h"
+#include "ShaderRow.h"
+#include "SpriteAtlas.h"
 #include <stdlib.h>
 #ifdef _WIN32
 #include <malloc.h>
@@ -134,7 +136,7 @@ inline void DeleteAligned(void* buffer)
  * @param y Y position in pixels.
  * @param bpp Bits-per-pixel depth.
  */
-Surface::Surface(int width, int height, int x, int y, int bpp) : _x(x), _y(y), _visible(true), _hidden(false), _redraw(false), _tftdMode(false), _alignedBuffer(0)
+Surface::Surface(int width, int height, int x, int y, int bpp) : _x(x), _y(y), _visible(true), _hidden(false), _redraw(false), _tftdMode(false), _alignedBuffer(0), _atlas(0), _atlasFrame(0)
 {
 	_alignedBuffer = NewAligned(bpp, width, height);
 	_surface = SDL_CreateRGBSurfaceFrom(_alignedBuffer, width, height, bpp, GetPitch(bpp, width), 0, 0, 0, 0);
@@ -199,6 +201,8 @@ Surface::Surface(const Surface& other)
 	_visible = other._visible;
 	_hidden = other._hidden;
 	_redraw = other._redraw;
+	_atlas = 0;
+	_atlasFrame = 0;
 }
 
 /**
@@ -809,6 +813,35 @@ struct StandardShade
 
 };
 
+namespace helper
+{
+
+/**
+ * Shades whole rows of terrain at once in Surface::blitNShade.
+ */
+template<>
+struct row_draw<StandardShade>
+{
+	static inline void draw(int size, controler<ShaderMove<Uint8> >& dest, controler<ShaderMove<Uint8> >& src, controler<Scalar<int> >& shade, controler<Nothing>&, controler<Nothing>&)
+	{
+		shadeRow(&dest.get_ref(), &src.get_ref(), size, shade.get_ref());
+	}
+};
+
+/**
+ * Shades and recolors whole rows of terrain at once in Surface::blitNShade.
+ */
+template<>
+struct row_draw<ColorReplace>
+{
+	static inline void draw(int size, controler<ShaderMove<Uint8> >& dest, controler<ShaderMove<Uint8> >& src, controler<Scalar<int> >& shade, controler<Scalar<int> >& newColor, controler<Nothing>&)
+	{
+		shadeRowReplace(&dest.get_ref(), &src.get_ref(), size, shade.get_ref(), newColor.get_ref());
+	}
+};
+
+}//namespace helper
+
 
 
 /**
@@ -824,6 +857,10 @@ struct StandardShade
  */
 void Surface::blitNShade(Surface *surface, int x, int y, int off, bool half, int newBaseColor)
 {
+	if (_atlas && !newBaseColor && _atlas->blit(_atlasFrame, surface, x, y, off, half))
+	{
+		return;
+	}
 	ShaderMove<Uint8> src(this, x, y);
 	if (half)
 	{
@@ -842,6 +879,18 @@ void Surface::blitNShade(Surface *surface, int x, int y, int off, bool half, int
 
 }
 
+/**
+ * Links the surface to an atlas with shaded copies of it,
+ * so blitNShade() can copy them instead of shading every pixel.
+ * @param atlas Atlas holding the surface, 0 for none.
+ * @param frame Frame of the surface in the atlas.
+ */
+void Surface::setAtlas(SpriteAtlas *atlas, int frame)
+{
+	_atlas = atlas;
+	_atlasFrame = frame;
+}
+
 /**
  * Set the surface to be redrawn.
  * @param valid true means redraw.
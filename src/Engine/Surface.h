@@ -28,6 +28,7 @@ namespace OpenXcom
 
 class Font;
 class Language;
+class SpriteAtlas;
 
 /**
  * Element that is blit (rendered) onto the screen.
@@ -44,6 +45,8 @@ protected:
 	SDL_Rect _crop, _clear;
 	bool _visible, _hidden, _redraw, _tftdMode;
 	void *_alignedBuffer;
+	SpriteAtlas *_atlas;
+	int _atlasFrame;
 	std::string _tooltip;
 
 	void resize(int width, int height);
@@ -213,6 +216,8 @@ public:
 	void unlock();
 	/// Specific blit function to blit battlescape terrain data in different shades in a fast way.
 	void blitNShade(Surface *surface, int x, int y, int off, bool half = false, int newBaseColor = 0);
+	/// Sets the atlas holding shaded copies of the surface.
+	void setAtlas(SpriteAtlas *atlas, int frame);
 	/// Invalidate the surface: force it to be redrawn
 	void invalidate(bool valid = true);
 	/// Gets the tooltip of the surface.
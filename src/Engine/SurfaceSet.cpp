@@ -18,9 +18,11 @@
  */
 #include "SurfaceSet.h"
 #include <SDL_endian.h>
-#include <fstream>
+#include <cstring>
+#include <algorithm>
 #include "Surface.h"
 #include "Exception.h"
+#include "MappedFile.h"
 
 namespace OpenXcom
 {
@@ -77,18 +79,14 @@ void SurfaceSet::loadPck(const std::string &pck, const std::string &tab)
 	// Load TAB and get image offsets
 	if (!tab.empty())
 	{
-		std::ifstream offsetFile(tab.c_str(), std::ios::in | std::ios::binary);
+		MappedFile offsetFile(tab);
 		if (!offsetFile)
 		{
 			throw Exception(tab + " not found");
 		}
-		std::streampos begin, end;
-		begin = offsetFile.tellg();
-		int off;
-		offsetFile.read((char*)&off, sizeof(off));
-		offsetFile.seekg(0, std::ios::end);
-		end = offsetFile.tellg();
-		int size = end - begin;
+		int off = 0;
+		memcpy(&off, offsetFile.getData(), std::min(sizeof(off), offsetFile.getSize()));
+		int size = offsetFile.getSize();
 		// 16-bit offsets
 		if (off != 0)
 		{
@@ -99,7 +97,6 @@ void SurfaceSet::loadPck(const std::string &pck, const std::string &tab)
 		{
 			nframes = size / 4;
 		}
-		offsetFile.close();
 		for (int frame = 0; frame < nframes; ++frame)
 		{
 			_frames[frame] = new Surface(_width, _height);
@@ -112,12 +109,14 @@ void SurfaceSet::loadPck(const std::string &pck, const std::string &tab)
 	}
 
 	// Load PCK and put pixels in surfaces
-	std::ifstream imgFile (pck.c_str(), std::ios::in | std::ios::binary);
+	MappedFile imgFile(pck);
 	if (!imgFile)
 	{
 		throw Exception(pck + " not found");
 	}
 
+	const Uint8 *data = (const Uint8*)imgFile.getData();
+	const Uint8 *end = data + imgFile.getSize();
 	Uint8 value;
 
 	for (int frame = 0; frame < nframes; ++frame)
@@ -127,7 +126,7 @@ void SurfaceSet::loadPck(const std::string &pck, const std::string &tab)
 		// Lock the surface
 		_frames[frame]->lock();
 
-		imgFile.read((char*)&value, 1);
+		value = (data < end) ? *data++ : 0;
 		for (int i = 0; i < value; ++i)
 		{
 			for (int j = 0; j < _width; ++j)
@@ -136,11 +135,11 @@ void SurfaceSet::loadPck(const std::string &pck, const std::string &tab)
 			}
 		}
 
-		while (imgFile.read((char*)&value, 1) && value != 255)
+		while (data < end && (value = *data++) != 255)
 		{
 			if (value == 254)
 			{
-				imgFile.read((char*)&value, 1);
+				value = (data < end) ? *data++ : 0;
 				for (int i = 0; i < value; ++i)
 				{
 					_frames[frame]->setPixelIterative(&x, &y, 0);
@@ -155,8 +154,6 @@ void SurfaceSet::loadPck(const std::string &pck, const std::string &tab)
 		// Unlock the surface
 		_frames[frame]->unlock();
 	}
-
-	imgFile.close();
 }
 
 /**
@@ -172,15 +169,13 @@ void SurfaceSet::loadDat(const std::string &filename)
 	int nframes = 0;
 
 	// Load file and put pixels in surface
-	std::ifstream imgFile (filename.c_str(), std::ios::in | std::ios::binary);
+	MappedFile imgFile(filename);
 	if (!imgFile)
 	{
 		throw Exception(filename + " not found");
 	}
 
-	imgFile.seekg(0, std::ios::end);
-	std::streamoff size = imgFile.tellg();
-	imgFile.seekg(0, std::ios::beg);
+	size_t size = imgFile.getSize();
 
 	nframes = (int)size / (_width * _height);
 
@@ -190,15 +185,16 @@ void SurfaceSet::loadDat(const std::string &filename)
 		_frames[i] = surface;
 	}
 
-	Uint8 value;
+	const Uint8 *data = (const Uint8*)imgFile.getData();
+	const Uint8 *end = data + size;
 	int x = 0, y = 0, frame = 0;
 
 	// Lock the surface
 	_frames[frame]->lock();
 
-	while (imgFile.read((char*)&value, 1))
+	while (data < end)
 	{
-		_frames[frame]->setPixelIterative(&x, &y, value);
+		_frames[frame]->setPixelIterative(&x, &y, *data++);
 
 		if (y >= _height)
 		{
@@ -215,8 +211,6 @@ void SurfaceSet::loadDat(const std::string &filename)
 				_frames[frame]->lock();
 		}
 	}
-
-	imgFile.close();
 }
 
 /**
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ThreadPool.h"
+#include <algorithm>
+#include "Options.h"
+#include "CrossPlatform.h"
+
+namespace OpenXcom
+{
+
+ThreadPool *ThreadPool::_instance = 0;
+
+/**
+ * Creates a thread pool and starts its worker threads.
+ * @param threads Number of threads doing work, including the caller,
+ * so a pool of 1 runs everything on the calling thread.
+ */
+ThreadPool::ThreadPool(int threads) : _job(0), _next(0), _count(0), _pending(0), _busy(false), _quit(false)
+{
+	_mutex = SDL_CreateMutex();
+	_wake = SDL_CreateCond();
+	_done = SDL_CreateCond();
+	for (int i = 1; i < threads; ++i)
+	{
+		SDL_Thread *thread = SDL_CreateThread(worker, (void*)this);
+		if (thread == 0)
+		{
+			break;
+		}
+		_threads.push_back(thread);
+	}
+}
+
+/**
+ * Tells the worker threads to quit and waits for them.
+ */
+ThreadPool::~ThreadPool()
+{
+	SDL_mutexP(_mutex);
+	_quit = true;
+	SDL_CondBroadcast(_wake);
+	SDL_mutexV(_mutex);
+	for (std::vector<SDL_Thread*>::iterator i = _threads.begin(); i != _threads.end(); ++i)
+	{
+		SDL_WaitThread(*i, 0);
+	}
+	SDL_DestroyCond(_done);
+	SDL_DestroyCond(_wake);
+	SDL_DestroyMutex(_mutex);
+}
+
+/**
+ * Waits for jobs and runs their items until the pool is stopped.
+ * @param data Pointer to the thread pool.
+ * @return Thread exit code.
+ */
+int ThreadPool::worker(void *data)
+{
+	ThreadPool *pool = (ThreadPool*)data;
+	SDL_mutexP(pool->_mutex);
+	while (true)
+	{
+		while (!pool->_quit && (pool->_job == 0 || pool->_next >= pool->_count))
+		{
+			SDL_CondWait(pool->_wake, pool->_mutex);
+		}
+		if (pool->_quit)
+		{
+			break;
+		}
+		SDL_mutexV(pool->_mutex);
+		pool->work();
+		SDL_mutexP(pool->_mutex);
+	}
+	SDL_mutexV(pool->_mutex);
+	return 0;
+}
+
+/**
+ * Takes items of the current job one at a time and runs them,
+ * signaling the caller once the last one is finished.
+ */
+void ThreadPool::work()
+{
+	SDL_mutexP(_mutex);
+	while (_job != 0 && _next < _count)
+	{
+		ThreadJob *job = _job;
+		int index = _next++;
+		SDL_mutexV(_mutex);
+		job->run(index);
+		SDL_mutexP(_mutex);
+		if (--_pending == 0)
+		{
+			SDL_CondSignal(_done);
+		}
+	}
+	SDL_mutexV(_mutex);
+}
+
+/**
+ * Gets the number of threads that take part in a job.
+ * @return Number of worker threads plus the calling thread.
+ */
+int ThreadPool::getThreadCount() const
+{
+	return _threads.size() + 1;
+}
+
+/**
+ * Runs items 0 to count-1 of a job across the pool and waits until all
+ * of them are done. Items can run in any order and on any thread, so they
+ * must not touch anything shared with other items. Jobs started from
+ * inside another job run on the calling thread.
+ * @param job Job to run.
+ * @param count Number of items in the job.
+ */
+void ThreadPool::run(ThreadJob *job, int count)
+{
+	bool serial = _threads.empty() || count < 2;
+	if (!serial)
+	{
+		SDL_mutexP(_mutex);
+		serial = _busy;
+		if (!serial)
+		{
+			_busy = true;
+			_job = job;
+			_next = 0;
+			_count = count;
+			_pending = count;
+			SDL_CondBroadcast(_wake);
+		}
+		SDL_mutexV(_mutex);
+	}
+	if (serial)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			job->run(i);
+		}
+		return;
+	}
+
+	work();
+
+	SDL_mutexP(_mutex);
+	while (_pending > 0)
+	{
+		SDL_CondWait(_done, _mutex);
+	}
+	_job = 0;
+	_busy = false;
+	SDL_mutexV(_mutex);
+}
+
+/**
+ * Gets the thread pool shared by the game, creating it on first use.
+ * Its size comes from the maxThreads option, or the number of processors if 0.
+ * @return Pointer to the thread pool.
+ */
+ThreadPool *ThreadPool::get()
+{
+	if (_instance == 0)
+	{
+		int threads = Options::maxThreads;
+		if (threads <= 0)
+		{
+			threads = std::min(CrossPlatform::getCPUCount(), 16);
+		}
+		_instance = new ThreadPool(threads);
+	}
+	return _instance;
+}
+
+/**
+ * Stops the shared thread pool, if it was ever started.
+ */
+void ThreadPool::shutdown()
+{
+	delete _instance;
+	_instance = 0;
+}
+
+}
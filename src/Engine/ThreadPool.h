@@ -0,0 +1,80 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_THREADPOOL_H
+#define OPENXCOM_THREADPOOL_H
+
+#include <vector>
+#include <SDL.h>
+#include <SDL_thread.h>
+
+namespace OpenXcom
+{
+
+/**
+ * A batch of independent work items that can be
+ * spread across the threads of a ThreadPool.
+ */
+class ThreadJob
+{
+public:
+	/// Cleans up the job.
+	virtual ~ThreadJob() {}
+	/// Runs one work item of the job.
+	virtual void run(int index) = 0;
+};
+
+/**
+ * Fixed set of worker threads used to split heavy
+ * calculations (line of sight, lighting...) across processors.
+ * The calling thread takes part in the work and waits until
+ * every item is finished, so results are ready when run() returns.
+ */
+class ThreadPool
+{
+private:
+	static ThreadPool *_instance;
+	std::vector<SDL_Thread*> _threads;
+	SDL_mutex *_mutex;
+	SDL_cond *_wake, *_done;
+	ThreadJob *_job;
+	int _next, _count, _pending;
+	bool _busy, _quit;
+
+	/// Entry point of the worker threads.
+	static int worker(void *data);
+	/// Runs work items of the current job until there are none left.
+	void work();
+public:
+	/// Creates a pool with a number of threads.
+	ThreadPool(int threads);
+	/// Stops and cleans up the pool.
+	~ThreadPool();
+	/// Gets the number of threads doing work, including the caller.
+	int getThreadCount() const;
+	/// Runs all the items of a job and waits for them.
+	void run(ThreadJob *job, int count);
+	/// Gets the shared thread pool.
+	static ThreadPool *get();
+	/// Stops the shared thread pool.
+	static void shutdown();
+};
+
+}
+
+#endif
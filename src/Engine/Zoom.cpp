@@ -18,12 +18,16 @@
  */
 
 #include "Zoom.h"
+#include <vector>
+#include <algorithm>
+#include <cstring>
 
 #include "Exception.h"
 #include "Surface.h"
 #include "Logger.h"
 #include "Options.h"
 #include "Screen.h"
+#include "ThreadPool.h"
 
 #include "OpenGL.h"
 
@@ -649,6 +653,187 @@ bool Zoom::haveSSE2()
 
 #endif
 
+/**
+ * 32bpp filters that can scale the screen a slice of rows at a time.
+ */
+enum SliceFilter { FILTER_NONE, FILTER_XBRZ, FILTER_HQX };
+
+/// Fewest source rows worth handing to a thread.
+static const int MIN_SLICE_ROWS = 16;
+
+/**
+ * Gets how many source rows around a pixel a filter looks at,
+ * so changing a row also changes the output of that many rows
+ * above and below it.
+ * @param filter Filter to check.
+ * @return Number of rows.
+ */
+static int getFilterReach(SliceFilter filter)
+{
+	return filter == FILTER_XBRZ ? 2 : 1;
+}
+
+/**
+ * Fills the lookup table of the HQX filters the first time they're used.
+ */
+static void initHQX()
+{
+	static bool initDone = false;
+
+	if (!initDone)
+	{
+		hqxInit();
+		initDone = true;
+	}
+}
+
+/**
+ * Gets the 32bpp filter selected in the options that scales src
+ * to a surface of the given size, if any.
+ * @param src The surface to zoom (input).
+ * @param width Width of the zoomed surface.
+ * @param height Height of the zoomed surface.
+ * @param pitch Bytes per row of the zoomed surface.
+ * @param factor Returns the scaling factor.
+ * @return Filter to use, FILTER_NONE if there's none.
+ */
+static SliceFilter getSliceFilter(SDL_Surface *src, int width, int height, int pitch, int *factor)
+{
+	if (!Screen::is32bitEnabled())
+	{
+		return FILTER_NONE;
+	}
+	if (Options::useXBRZFilter)
+	{
+		// check the resolution to see which scale we need
+		for (int f = 2; f <= 5; f++)
+		{
+			// xBRZ takes packed rows
+			if (width == src->w * f && height == src->h * f && pitch == width * 4)
+			{
+				*factor = f;
+				return FILTER_XBRZ;
+			}
+		}
+	}
+	if (Options::useHQXFilter)
+	{
+		for (int f = 2; f <= 4; f++)
+		{
+			if (width == src->w * f && height == src->h * f)
+			{
+				*factor = f;
+				return FILTER_HQX;
+			}
+		}
+	}
+	return FILTER_NONE;
+}
+
+/**
+ * Scales a slice of rows of a 32bpp surface with a filter.
+ * The rows are drawn exactly as when scaling the whole surface.
+ * @param src The surface to zoom (input).
+ * @param dst The zoomed surface (output).
+ * @param filter Filter to use.
+ * @param factor Scaling factor.
+ * @param yFirst First source row to scale.
+ * @param yLast Source row after the last one to scale.
+ */
+static void filterSlice(SDL_Surface *src, SDL_Surface *dst, SliceFilter filter, int factor, int yFirst, int yLast)
+{
+	if (filter == FILTER_XBRZ)
+	{
+		xbrz::scale(factor, (uint32_t*)src->pixels, (uint32_t*)dst->pixels, src->w, src->h, xbrz::ScalerCfg(), yFirst, yLast);
+	}
+	else if (factor == 2)
+	{
+		hq2x_32_rb_slice((uint32_t*)src->pixels, src->pitch, (uint32_t*)dst->pixels, dst->pitch, src->w, src->h, yFirst, yLast);
+	}
+	else if (factor == 3)
+	{
+		hq3x_32_rb_slice((uint32_t*)src->pixels, src->pitch, (uint32_t*)dst->pixels, dst->pitch, src->w, src->h, yFirst, yLast);
+	}
+	else if (factor == 4)
+	{
+		hq4x_32_rb_slice((uint32_t*)src->pixels, src->pitch, (uint32_t*)dst->pixels, dst->pitch, src->w, src->h, yFirst, yLast);
+	}
+}
+
+/**
+ * Scales a range of rows split in slices, one per item.
+ * Slices don't share any output rows, so they can run at the same time.
+ */
+class FilterJob : public ThreadJob
+{
+private:
+	SDL_Surface *_src, *_dst;
+	SliceFilter _filter;
+	int _factor, _yFirst, _rows, _slices;
+public:
+	FilterJob(SDL_Surface *src, SDL_Surface *dst, SliceFilter filter, int factor, int yFirst, int yLast, int slices) : _src(src), _dst(dst), _filter(filter), _factor(factor), _yFirst(yFirst), _rows(yLast - yFirst), _slices(slices)
+	{
+	}
+	void run(int index)
+	{
+		int first = _yFirst + _rows * index / _slices;
+		int last = _yFirst + _rows * (index + 1) / _slices;
+		filterSlice(_src, _dst, _filter, _factor, first, last);
+	}
+};
+
+/**
+ * Scales a range of rows of a 32bpp surface with a filter,
+ * spreading slices of them across the thread pool.
+ * @param src The surface to zoom (input).
+ * @param dst The zoomed surface (output).
+ * @param filter Filter to use.
+ * @param factor Scaling factor.
+ * @param yFirst First source row to scale.
+ * @param yLast Source row after the last one to scale.
+ */
+static void filterRows(SDL_Surface *src, SDL_Surface *dst, SliceFilter filter, int factor, int yFirst, int yLast)
+{
+	if (filter == FILTER_HQX)
+	{
+		initHQX();
+	}
+	int slices = std::min(ThreadPool::get()->getThreadCount(), (yLast - yFirst) / MIN_SLICE_ROWS);
+	if (slices > 1)
+	{
+		FilterJob job(src, dst, filter, factor, yFirst, yLast, slices);
+		ThreadPool::get()->run(&job, slices);
+	}
+	else if (yFirst < yLast)
+	{
+		filterSlice(src, dst, filter, factor, yFirst, yLast);
+	}
+}
+
+/**
+ * Scales the rows of a 32bpp surface affected by a change with a filter.
+ * @param src The surface to zoom (input).
+ * @param dst The zoomed surface (output).
+ * @param filter Filter to use.
+ * @param factor Scaling factor.
+ * @param area Part of src that changed, changed to the part of dst that was drawn.
+ */
+static void filterArea(SDL_Surface *src, SDL_Surface *dst, SliceFilter filter, int factor, SDL_Rect *area)
+{
+	int reach = getFilterReach(filter);
+	int yFirst = std::max(area->y - reach, 0);
+	int yLast = std::min(area->y + area->h + reach, src->h);
+	if (area->w == 0 || area->h == 0)
+	{
+		yLast = yFirst;
+	}
+	filterRows(src, dst, filter, factor, yFirst, yLast);
+	area->x = 0;
+	area->y = yFirst * factor;
+	area->w = dst->w;
+	area->h = std::max(yLast - yFirst, 0) * factor;
+}
+
 /**
  * Wrapper around various software and OpenGL screen buffer pushing functions which zoom.
  * Basically called just from Screen::flip()
@@ -660,15 +845,28 @@ bool Zoom::haveSSE2()
  * @param leftBlackBand Size of left black band in pixels (letterboxing).
  * @param rightBlackBand Size of right black band in pixels (letterboxing).
  * @param glOut OpenGL output.
+ * @param area [Optional] Part of src that changed since the last flip, changed to the part of dst that was redrawn.
+ * Without it, or when the output can't be redrawn in parts, the whole of dst is redrawn.
  */
-void Zoom::flipWithZoom(SDL_Surface *src, SDL_Surface *dst, int topBlackBand, int bottomBlackBand, int leftBlackBand, int rightBlackBand, OpenGL *glOut)
+void Zoom::flipWithZoom(SDL_Surface *src, SDL_Surface *dst, int topBlackBand, int bottomBlackBand, int leftBlackBand, int rightBlackBand, OpenGL *glOut, SDL_Rect *area)
 {
+	// plain resizing of 8bpp surfaces keeps each pixel to itself,
+	// the 32bpp filters only reach a few rows around it
+	SliceFilter filter = FILTER_NONE;
+	int factor = 1;
+	if (area != 0 && !Screen::isOpenGLEnabled())
+	{
+		filter = getSliceFilter(src, dst->w - leftBlackBand - rightBlackBand, dst->h - topBlackBand - bottomBlackBand, dst->pitch, &factor);
+	}
+	bool partial = area != 0 && !Screen::isOpenGLEnabled() && (filter != FILTER_NONE || (!Screen::is32bitEnabled() && !Options::useScaleFilter &&
+		src->format->BytesPerPixel == 1 && dst->format->BytesPerPixel == 1));
 	if (Screen::isOpenGLEnabled())
 	{
 #ifndef __NO_OPENGL
 		if (glOut->buffer_surface)
 		{
-			SDL_BlitSurface(src, 0, glOut->buffer_surface->getSurface(), 0); // TODO; this is less than ideal...
+			// the texture keeps the last frame, so only the changed part goes to the card
+			glOut->upload(src, area);
 
 			glOut->refresh(glOut->linear, glOut->iwidth, glOut->iheight, dst->w, dst->h, topBlackBand, bottomBlackBand, leftBlackBand, rightBlackBand);
 			SDL_GL_SwapBuffers();
@@ -677,13 +875,50 @@ void Zoom::flipWithZoom(SDL_Surface *src, SDL_Surface *dst, int topBlackBand, in
 	}
 	else if (topBlackBand <= 0 && bottomBlackBand <= 0 && leftBlackBand <= 0 && rightBlackBand <= 0)
 	{
+		if (partial)
+		{
+			if (filter != FILTER_NONE)
+			{
+				filterArea(src, dst, filter, factor, area);
+			}
+			else
+			{
+				zoomArea(src, dst, area);
+			}
+			return;
+		}
 		_zoomSurfaceY(src, dst, 0, 0);
 	}
 	else if (dst->w - leftBlackBand - rightBlackBand == src->w && dst->h - topBlackBand - bottomBlackBand == src->h)
 	{
+		if (area != 0)
+		{
+			SDL_Rect dstrect = {(Sint16)(leftBlackBand + area->x), (Sint16)(topBlackBand + area->y), area->w, area->h};
+			SDL_BlitSurface(src, area, dst, &dstrect);
+			*area = dstrect;
+			return;
+		}
 		SDL_Rect dstrect = {(Sint16)leftBlackBand, (Sint16)topBlackBand, (Uint16)src->w, (Uint16)src->h};
 		SDL_BlitSurface(src, NULL, dst, &dstrect);
 	}
+	else if (partial)
+	{
+		// zoom straight into the part of dst inside the black bands
+		SDL_Surface *inner = SDL_CreateRGBSurfaceFrom((Uint8*)dst->pixels + topBlackBand * dst->pitch + leftBlackBand * dst->format->BytesPerPixel, dst->w - leftBlackBand - rightBlackBand, dst->h - topBlackBand - bottomBlackBand,
+			dst->format->BitsPerPixel, dst->pitch, dst->format->Rmask, dst->format->Gmask, dst->format->Bmask, dst->format->Amask);
+		if (filter != FILTER_NONE)
+		{
+			filterArea(src, inner, filter, factor, area);
+		}
+		else
+		{
+			zoomArea(src, inner, area);
+		}
+		SDL_FreeSurface(inner);
+		area->x += leftBlackBand;
+		area->y += topBlackBand;
+		return;
+	}
 	else
 	{
 		SDL_Surface *tmp = SDL_CreateRGBSurface(dst->flags, dst->w - leftBlackBand - rightBlackBand, dst->h - topBlackBand - bottomBlackBand, dst->format->BitsPerPixel, 0, 0, 0, 0);
@@ -696,8 +931,53 @@ void Zoom::flipWithZoom(SDL_Surface *src, SDL_Surface *dst, int topBlackBand, in
 		SDL_BlitSurface(tmp, NULL, dst, &dstrect);
 		SDL_FreeSurface(tmp);
 	}
+	if (area != 0)
+	{
+		area->x = 0;
+		area->y = 0;
+		area->w = dst->w;
+		area->h = dst->h;
+	}
 }
 
+/**
+ * Zooms part of an 8bpp surface onto another without smoothing.
+ * Each pixel of dst takes the pixel of src it falls on, the same
+ * as the software routine of _zoomSurfaceY(), so the result is
+ * what zooming the whole surface would give in that part.
+ * @param src The surface to zoom (input).
+ * @param dst The zoomed surface (output).
+ * @param area Part of src to zoom, changed to the part of dst that was drawn.
+ */
+void Zoom::zoomArea(SDL_Surface *src, SDL_Surface *dst, SDL_Rect *area)
+{
+	// first and last+1 pixels of dst falling in the area
+	int x0 = (area->x * dst->w + src->w - 1) / src->w;
+	int x1 = ((area->x + area->w) * dst->w + src->w - 1) / src->w;
+	int y0 = (area->y * dst->h + src->h - 1) / src->h;
+	int y1 = ((area->y + area->h) * dst->h + src->h - 1) / src->h;
+	x1 = std::min(x1, dst->w);
+	y1 = std::min(y1, dst->h);
+
+	std::vector<int> columns(std::max(x1 - x0, 0));
+	for (int x = x0; x < x1; ++x)
+	{
+		columns[x - x0] = x * src->w / dst->w;
+	}
+	for (int y = y0; y < y1; ++y)
+	{
+		const Uint8 *sp = (const Uint8*)src->pixels + (y * src->h / dst->h) * src->pitch;
+		Uint8 *dp = (Uint8*)dst->pixels + y * dst->pitch + x0;
+		for (std::vector<int>::const_iterator x = columns.begin(); x != columns.end(); ++x)
+		{
+			*dp++ = sp[*x];
+		}
+	}
+	area->x = x0;
+	area->y = y0;
+	area->w = std::max(x1 - x0, 0);
+	area->h = std::max(y1 - y0, 0);
+}
 
 /**
  * Internal 8-bit Zoomer without smoothing.
@@ -723,51 +1003,12 @@ int Zoom::_zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int fli
 	int dgap;
 	static bool proclaimed = false;
 
-	if (Screen::is32bitEnabled())
+	int factor;
+	SliceFilter filter = getSliceFilter(src, dst->w, dst->h, dst->pitch, &factor);
+	if (filter != FILTER_NONE)
 	{
-		if (Options::useXBRZFilter)
-		{
-			// check the resolution to see which scale we need
-			for (size_t factor = 2; factor <= 5; factor++)
-			{
-				if (dst->w == src->w * (int)factor && dst->h == src->h * (int)factor)
-				{
-					xbrz::scale(factor, (uint32_t*)src->pixels, (uint32_t*)dst->pixels, src->w, src->h);
-					return 0;
-				}
-			}
-		}
-
-		if (Options::useHQXFilter)
-		{
-			static bool initDone = false;
-
-			if (!initDone)
-			{
-				hqxInit();
-				initDone = true;
-			}
-
-			// HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height );
-
-			if (dst->w == src->w * 2 && dst->h == src->h * 2)
-			{
-				hq2x_32_rb((uint32_t*)src->pixels, src->pitch, (uint32_t*)dst->pixels, dst->pitch, src->w, src->h);
-				return 0;
-			}
-
-			if (dst->w == src->w * 3 && dst->h == src->h * 3)
-			{
-				hq3x_32_rb((uint32_t*)src->pixels, src->pitch, (uint32_t*)dst->pixels, dst->pitch, src->w, src->h);
-				return 0;
-			}
-
-			if (dst->w == src->w * 4 && dst->h == src->h * 4)
-			{
-				hq4x_32_rb((uint32_t*)src->pixels, src->pitch, (uint32_t*)dst->pixels, dst->pitch, src->w, src->h);
-				return 0;
-			}
-		}
+		filterRows(src, dst, filter, factor, 0, src->h);
+		return 0;
 	}
 
 	if (Options::useScaleFilter)
@@ -930,6 +1171,92 @@ int Zoom::_zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int fli
 	return 0;
 }
 
+/**
+ * Times each 32bpp filter and scaling factor on a test image,
+ * scaling it whole on one thread, whole across the thread pool,
+ * and just the rows around a small moving change, like the cursor.
+ * Also checks that the faster ways give the same picture.
+ * @param frames Number of frames to time each way.
+ */
+void Zoom::benchmark(int frames)
+{
+	const int width = 320, height = 200, change = 16;
+	const SliceFilter filters[] = { FILTER_XBRZ, FILTER_XBRZ, FILTER_XBRZ, FILTER_XBRZ, FILTER_HQX, FILTER_HQX, FILTER_HQX };
+	const int factors[] = { 2, 3, 4, 5, 2, 3, 4 };
+	frames = std::max(frames, 1);
+
+	SDL_Surface *src = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 32, 0xff0000, 0x00ff00, 0x0000ff, 0);
+	for (size_t i = 0; i < sizeof(factors) / sizeof(factors[0]); ++i)
+	{
+		SliceFilter filter = filters[i];
+		int factor = factors[i];
+		SDL_Surface *ref = SDL_CreateRGBSurface(SDL_SWSURFACE, width * factor, height * factor, 32, 0xff0000, 0x00ff00, 0x0000ff, 0);
+		SDL_Surface *dst = SDL_CreateRGBSurface(SDL_SWSURFACE, width * factor, height * factor, 32, 0xff0000, 0x00ff00, 0x0000ff, 0);
+
+		// blocks of a few colors, so there's plenty of edges to smooth
+		Uint32 seed = 1;
+		for (int y = 0; y < height; y += 4)
+		{
+			for (int x = 0; x < width; x += 4)
+			{
+				seed = seed * 1103515245 + 12345;
+				Uint32 color = ((seed >> 16) & 7) * 0x242424;
+				for (int py = y; py < y + 4; ++py)
+				{
+					for (int px = x; px < x + 4; ++px)
+					{
+						((Uint32*)((Uint8*)src->pixels + py * src->pitch))[px] = color;
+					}
+				}
+			}
+		}
+		if (filter == FILTER_HQX)
+		{
+			initHQX();
+		}
+
+		Uint32 start = SDL_GetTicks();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			filterSlice(src, ref, filter, factor, 0, height);
+		}
+		double serial = (double)(SDL_GetTicks() - start) / frames;
+
+		start = SDL_GetTicks();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			filterRows(src, dst, filter, factor, 0, height);
+		}
+		double threaded = (double)(SDL_GetTicks() - start) / frames;
+		bool same = memcmp(ref->pixels, dst->pixels, ref->pitch * ref->h) == 0;
+
+		start = SDL_GetTicks();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			SDL_Rect area;
+			area.x = (frame * 7) % (width - change);
+			area.y = (frame * 5) % (height - change);
+			area.w = change;
+			area.h = change;
+			SDL_FillRect(src, &area, (frame * 0x131313) & 0xffffff);
+			filterArea(src, dst, filter, factor, &area);
+		}
+		double partial = (double)(SDL_GetTicks() - start) / frames;
+		filterSlice(src, ref, filter, factor, 0, height);
+		same = same && memcmp(ref->pixels, dst->pixels, ref->pitch * ref->h) == 0;
+
+		Log(LOG_INFO) << (filter == FILTER_XBRZ ? "xBRZ " : "HQX ") << factor << "x: "
+			<< serial << " ms/frame on one thread, "
+			<< threaded << " ms/frame on " << ThreadPool::get()->getThreadCount() << " threads, "
+			<< partial << " ms/frame redrawing a " << change << "x" << change << " change, "
+			<< (same ? "output matches" : "OUTPUT DIFFERS");
+
+		SDL_FreeSurface(dst);
+		SDL_FreeSurface(ref);
+	}
+	SDL_FreeSurface(src);
+}
+
 
 }
 
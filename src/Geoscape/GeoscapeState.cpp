@@ -1245,24 +1245,16 @@ void GeoscapeState::time30Minutes()
 		case Ufo::FLYING:
 			points++;
 			// Get area
-			for (std::vector<Region*>::iterator k = _game->getSavedGame()->getRegions()->begin(); k != _game->getSavedGame()->getRegions()->end(); ++k)
+			if (Region *region = _game->getSavedGame()->locateRegion(**u))
 			{
-				if ((*k)->getRules()->insideRegion((*u)->getLongitude(), (*u)->getLatitude()))
-				{
-					//one point per UFO in-flight per half hour
-					(*k)->addActivityAlien(points);
-					break;
-				}
+				//one point per UFO in-flight per half hour
+				region->addActivityAlien(points);
 			}
 			// Get country
-			for (std::vector<Country*>::iterator k = _game->getSavedGame()->getCountries()->begin(); k != _game->getSavedGame()->getCountries()->end(); ++k)
+			if (Country *country = _game->getSavedGame()->locateCountry(**u))
 			{
-				if ((*k)->getRules()->insideCountry((*u)->getLongitude(), (*u)->getLatitude()))
-				{
-					//one point per UFO in-flight per half hour
-					(*k)->addActivityAlien(points);
-					break;
-				}
+				//one point per UFO in-flight per half hour
+				country->addActivityAlien(points);
 			}
 			if (!(*u)->getDetected())
 			{
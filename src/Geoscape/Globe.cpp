@@ -59,6 +59,8 @@
 #include "../Ruleset/RuleGlobe.h"
 #include "../Interface/Cursor.h"
 #include "../Engine/Screen.h"
+#include "../Engine/ThreadPool.h"
+#include "PolygonGrid.h"
 
 namespace OpenXcom
 {
@@ -247,6 +249,62 @@ struct CreateShadow
 	}
 };
 
+/**
+ * Paints the land a band of rows at a time, one band per item.
+ * Every pixel of the globe is turned back into a direction from
+ * its center and looked up in the grid of land polygons, so
+ * moving the globe needs no polygon work at all.
+ * Textures stay fixed on the screen, same as the polygon fill did.
+ */
+class DrawLand : public ThreadJob
+{
+private:
+	SDL_Surface *_dest;
+	const std::vector<Cord> &_earth;
+	const PolygonGrid *_land;
+	const std::vector<SDL_Surface*> &_textures;
+	int _moveX, _moveY, _bands;
+	double _sinLon, _cosLon, _sinLat, _cosLat;
+public:
+	DrawLand(SDL_Surface *dest, const std::vector<Cord> &earth, const PolygonGrid *land, const std::vector<SDL_Surface*> &textures, int moveX, int moveY, double cenLon, double cenLat, int bands) :
+		_dest(dest), _earth(earth), _land(land), _textures(textures), _moveX(moveX), _moveY(moveY), _bands(bands),
+		_sinLon(sin(cenLon)), _cosLon(cos(cenLon)), _sinLat(sin(cenLat)), _cosLat(cos(cenLat))
+	{
+	}
+	void run(int index)
+	{
+		const int width = _dest->w, height = _dest->h;
+		const int first = height * index / _bands;
+		const int last = height * (index + 1) / _bands;
+		for (int y = first; y < last; ++y)
+		{
+			const int earthY = y - _moveY;
+			if (earthY < 0 || earthY >= height)
+				continue;
+			Uint8 *row = (Uint8*)_dest->pixels + y * _dest->pitch;
+			const Cord *earthRow = &_earth[earthY * width];
+			for (int x = std::max(0, _moveX); x < std::min(width, width + _moveX); ++x)
+			{
+				const Cord &n = earthRow[x - _moveX];
+				if (!n.z)
+					continue;
+				// undo the rotation of polarToCart
+				const double w = _cosLat * n.z - _sinLat * n.y;
+				const Cord p(n.x * _cosLon + w * _sinLon, _cosLat * n.y + _sinLat * n.z, w * _cosLon - n.x * _sinLon);
+				const Polygon *polygon = _land->find(p);
+				if (!polygon || polygon->getTexture() < 0 || polygon->getTexture() >= (int)_textures.size())
+					continue;
+				const SDL_Surface *texture = _textures[polygon->getTexture()];
+				if (!texture)
+					continue;
+				const Uint8 pixel = ((const Uint8*)texture->pixels)[(y % texture->h) * texture->pitch + x % texture->w];
+				if (pixel)
+					row[x] = pixel;
+			}
+		}
+	}
+};
+
 }//namespace
 
 
@@ -292,7 +350,7 @@ Globe::Globe(Game* game, int cenX, int cenY, int width, int height, int x, int y
 	for (size_t i=0; i<_randomNoiseData.size(); ++i)
 		_randomNoiseData[i] = rand()%4;
 
-	cachePolygons();
+	_land = new PolygonGrid(*_rules->getPolygons());
 }
 
 /**
@@ -310,11 +368,7 @@ Globe::~Globe()
 	//delete _markerSet;
 	delete _radars;
 	delete _clipper;
-
-	for (std::list<Polygon*>::iterator i = _cacheLand.begin(); i != _cacheLand.end(); ++i)
-	{
-		delete *i;
-	}
+	delete _land;
 }
 
 /**
@@ -401,45 +455,6 @@ double Globe::lastVisibleLat(double lon) const
 	return atan(-cos(_cenLat) * cos(lon - _cenLon)/sin(_cenLat));
 }
 
-/**
- * Checks if a polar point is inside a certain polygon.
- * @param lon Longitude of the point.
- * @param lat Latitude of the point.
- * @param poly Pointer to the polygon.
- * @return True if it's inside, False if it's outside.
- */
-bool Globe::insidePolygon(double lon, double lat, Polygon *poly) const
-{
-	bool backFace = true;
-	for (int i = 0; i < poly->getPoints(); ++i)
-	{
-		backFace = backFace && pointBack(poly->getLongitude(i), poly->getLatitude(i));
-	}
-	if (backFace != pointBack(lon, lat))
-		return false;
-
-	bool odd = false;
-	for (int i = 0; i < poly->getPoints(); ++i)
-	{
-		int j = (i + 1) % poly->getPoints();
-
-		/*double x = lon, y = lat,
-			   x_i = poly->getLongitude(i), y_i = poly->getLatitude(i),
-			   x_j = poly->getLongitude(j), y_j = poly->getLatitude(j);*/
-
-		double x, y, x_i, x_j, y_i, y_j;
-		polarToCart(poly->getLongitude(i), poly->getLatitude(i), &x_i, &y_i);
-		polarToCart(poly->getLongitude(j), poly->getLatitude(j), &x_j, &y_j);
-		polarToCart(lon, lat, &x, &y);
-
-		if (((y_i < y && y_j >= y) || (y_j < y && y_i >= y)) && (x_i <= x || x_j <= x))
-		{
-			odd ^= (x_i + (y - y_i) / (y_j - y_i) * (x_j - x_i) < x);
-		}
-	}
-	return odd;
-}
-
 /**
  * Sets a leftwards rotation speed and starts the timer.
  */
@@ -654,19 +669,7 @@ void Globe::center(double lon, double lat)
  */
 bool Globe::insideLand(double lon, double lat) const
 {
-	bool inside = false;
-	// We're only temporarily changing cenLon/cenLat so the "const" is actually preserved
-	Globe* const globe = const_cast<Globe* const>(this); // WARNING: BAD CODING PRACTICE
-	double oldLon = _cenLon, oldLat = _cenLat;
-	globe->_cenLon = lon;
-	globe->_cenLat = lat;
-	for (std::list<Polygon*>::iterator i = _rules->getPolygons()->begin(); i != _rules->getPolygons()->end() && !inside; ++i)
-	{
-		inside = insidePolygon(lon, lat, *i);
-	}
-	globe->_cenLon = oldLon;
-	globe->_cenLat = oldLat;
-	return inside;
+	return _land->find(lon, lat) != 0;
 }
 
 /**
@@ -772,63 +775,6 @@ std::vector<Target*> Globe::getTargets(int x, int y, bool craft) const
 	return v;
 }
 
-/**
- * Takes care of pre-calculating all the polygons currently visible
- * on the globe and caching them so they only need to be recalculated
- * when the globe is actually moved.
- */
-void Globe::cachePolygons()
-{
-	cache(_rules->getPolygons(), &_cacheLand);
-}
-
-/**
- * Caches a set of polygons.
- * @param polygons Pointer to list of polygons.
- * @param cache Pointer to cache.
- */
-void Globe::cache(std::list<Polygon*> *polygons, std::list<Polygon*> *cache)
-{
-	// Clear existing cache
-	for (std::list<Polygon*>::iterator i = cache->begin(); i != cache->end(); ++i)
-	{
-		delete *i;
-	}
-	cache->clear();
-
-	// Pre-calculate values to cache
-	for (std::list<Polygon*>::iterator i = polygons->begin(); i != polygons->end(); ++i)
-	{
-		// Is quad on the back face?
-		double closest = 0.0;
-		double z;
-		double furthest = 0.0;
-		for (int j = 0; j < (*i)->getPoints(); ++j)
-		{
-			z = cos(_cenLat) * cos((*i)->getLatitude(j)) * cos((*i)->getLongitude(j) - _cenLon) + sin(_cenLat) * sin((*i)->getLatitude(j));
-			if (z > closest)
-				closest = z;
-			else if (z < furthest)
-				furthest = z;
-		}
-		if (-furthest > closest)
-			continue;
-
-		Polygon* p = new Polygon(**i);
-
-		// Convert coordinates
-		for (int j = 0; j < p->getPoints(); ++j)
-		{
-			Sint16 x, y;
-			polarToCart(p->getLongitude(j), p->getLatitude(j), &x, &y);
-			p->setX(j, x);
-			p->setY(j, y);
-		}
-
-		cache->push_back(p);
-	}
-}
-
 /**
  * Replaces a certain amount of colors in the palette of the globe.
  * @param colors Pointer to the set of colors.
@@ -891,10 +837,6 @@ void Globe::rotate()
  */
 void Globe::draw()
 {
-	if (_redraw)
-	{
-		cachePolygons();
-	}
 	Surface::draw();
 	drawOcean();
 	drawLand();
@@ -921,25 +863,26 @@ void Globe::drawOcean()
 
 
 /**
- * Renders the land, taking all the visible world polygons
- * and texturing and shading them accordingly.
+ * Renders the land, looking up the world polygon under every
+ * pixel of the globe and texturing it accordingly.
  */
 void Globe::drawLand()
 {
-	Sint16 x[4], y[4];
-
-	for (std::list<Polygon*>::iterator i = _cacheLand.begin(); i != _cacheLand.end(); ++i)
+	std::vector<SDL_Surface*> textures(_texture->getTotalFrames() / 3, 0);
+	for (size_t i = 0; i < textures.size(); ++i)
 	{
-		// Convert coordinates
-		for (int j = 0; j < (*i)->getPoints(); ++j)
+		Surface *frame = _texture->getFrame(i + _zoomTexture);
+		if (frame)
 		{
-			x[j] = (*i)->getX(j);
-			y[j] = (*i)->getY(j);
+			textures[i] = frame->getSurface();
 		}
-
-		// Apply textures according to zoom and shade
-		drawTexturedPolygon(x, y, (*i)->getPoints(), _texture->getFrame((*i)->getTexture() + _zoomTexture), 0, 0);
 	}
+
+	int bands = std::max(1, std::min(ThreadPool::get()->getThreadCount(), getHeight() / MIN_LAND_BAND));
+	DrawLand job(getSurface(), _earthData[_zoom], _land, textures, _cenX - getWidth() / 2, _cenY - getHeight() / 2, _cenLon, _cenLat, bands);
+	lock();
+	ThreadPool::get()->run(&job, bands);
+	unlock();
 }
 
 /**
@@ -1819,21 +1762,11 @@ void Globe::getPolygonTextureAndShade(double lon, double lat, int *texture, int
 	*texture = -1;
 	*shade = worldshades[ CreateShadow::getShadowValue(0, Cord(0.,0.,1.), getSunDirection(lon, lat), 0) ];
 
-	// We're only temporarily changing cenLon/cenLat so the "const" is actually preserved
-	Globe* const globe = const_cast<Globe* const>(this); // WARNING: BAD CODING PRACTICE
-	double oldLon = _cenLon, oldLat = _cenLat;
-	globe->_cenLon = lon;
-	globe->_cenLat = lat;
-	for (std::list<Polygon*>::iterator i = _rules->getPolygons()->begin(); i != _rules->getPolygons()->end(); ++i)
+	Polygon *polygon = _land->find(lon, lat);
+	if (polygon)
 	{
-		if (insidePolygon(lon, lat, *i))
-		{
-			*texture = (*i)->getTexture();
-			break;
-		}
+		*texture = polygon->getTexture();
 	}
-	globe->_cenLon = oldLon;
-	globe->_cenLat = oldLat;
 }
 
 /**
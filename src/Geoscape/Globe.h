@@ -35,6 +35,7 @@ class Timer;
 class Target;
 class LocalizedText;
 class RuleGlobe;
+class PolygonGrid;
 
 /**
  * Interactive globe view of the world.
@@ -50,6 +51,7 @@ private:
 	static const int NEAR_RADIUS = 25;
 	static const int DOGFIGHT_ZOOM = 3;
 	static const int CITY_MARKER = 8;
+	static const int MIN_LAND_BAND = 16;
 	static const double ROTATE_LONGITUDE;
 	static const double ROTATE_LATITUDE;
 
@@ -63,7 +65,7 @@ private:
 	bool _hover;
 	int _blink;
 	Timer *_blinkTimer, *_rotTimer;
-	std::list<Polygon*> _cacheLand;
+	PolygonGrid *_land;
 	FastLineClip *_clipper;
 	double _radius, _radiusStep;
 	///normal of each pixel in earth globe per zoom level
@@ -86,12 +88,8 @@ private:
 	bool pointBack(double lon, double lat) const;
 	/// Return latitude of last visible to player point on given longitude.
 	double lastVisibleLat(double lon) const;
-	/// Checks if a point is inside a polygon.
-	bool insidePolygon(double lon, double lat, Polygon *poly) const;
 	/// Checks if a target is near a point.
 	bool targetNear(Target* target, int x, int y) const;
-	/// Caches a set of polygons.
-	void cache(std::list<Polygon*> *polygons, std::list<Polygon*> *cache);
 	/// Get position of sun relative to given position in polar cords and date.
 	Cord getSunDirection(double lon, double lat) const;
 	/// Draw globe range circle.
@@ -161,8 +159,6 @@ public:
 	void toggleDetail();
 	/// Gets all the targets near a point on the globe.
 	std::vector<Target*> getTargets(int x, int y, bool craft) const;
-	/// Caches visible globe polygons.
-	void cachePolygons();
 	/// Sets the palette of the globe.
 	void setPalette(SDL_Color *colors, int firstcolor = 0, int ncolors = 256);
 	/// Handles the timers.
@@ -0,0 +1,382 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "PolygonGrid.h"
+#include <cmath>
+#include "../Ruleset/Polygon.h"
+
+namespace OpenXcom
+{
+
+namespace
+{
+
+inline double dot(const Cord &a, const Cord &b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Cord cross(const Cord &a, const Cord &b)
+{
+	return Cord(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+/**
+ * Splits a direction into its part along the axis of a cube
+ * face and the two parts across it.
+ * @param p Direction.
+ * @param axis Axis of the face (0 = x, 1 = y, 2 = z).
+ * @param d Output part along the axis.
+ * @param u Output first part across the axis.
+ * @param v Output second part across the axis.
+ */
+inline void split(const Cord &p, int axis, double *d, double *u, double *v)
+{
+	switch (axis)
+	{
+	case 0:
+		*d = p.x; *u = p.y; *v = p.z;
+		break;
+	case 1:
+		*d = p.y; *u = p.x; *v = p.z;
+		break;
+	default:
+		*d = p.z; *u = p.x; *v = p.y;
+		break;
+	}
+}
+
+/**
+ * Turns a position on a cube face into the cell holding it.
+ * @param t Position across the face, from -1 to 1.
+ * @return Cell index along that side of the face.
+ */
+inline int toCell(double t)
+{
+	int cell = (int)floor((t + 1.0) * 0.5 * PolygonGrid::FACE_CELLS);
+	if (cell < 0)
+		return 0;
+	if (cell >= PolygonGrid::FACE_CELLS)
+		return PolygonGrid::FACE_CELLS - 1;
+	return cell;
+}
+
+}
+
+/**
+ * Sorts the polygons into the cells they touch. Polygons later
+ * in the list are drawn over earlier ones, so a cell fully inside
+ * a polygon forgets about every polygon before it.
+ * @param polygons List of world polygons.
+ */
+PolygonGrid::PolygonGrid(const std::list<Polygon*> &polygons)
+{
+	const int cells = 6 * FACE_CELLS * FACE_CELLS;
+	std::vector<std::vector<int> > lists(cells);
+	std::vector<int> covers(cells, -1);
+
+	_shapes.resize(polygons.size());
+	int index = 0;
+	for (std::list<Polygon*>::const_iterator i = polygons.begin(); i != polygons.end(); ++i, ++index)
+	{
+		Shape &shape = _shapes[index];
+		makeShape(*i, &shape);
+		if (shape.points.size() < 3)
+			continue;
+
+		for (int face = 0; face < 6; ++face)
+		{
+			double sign = (face % 2) ? -1.0 : 1.0;
+			bool front = true, back = true;
+			double uMin = 1.0, uMax = -1.0, vMin = 1.0, vMax = -1.0;
+			for (size_t k = 0; k < shape.points.size(); ++k)
+			{
+				double d, u, v;
+				split(shape.points[k], face / 2, &d, &u, &v);
+				d *= sign;
+				if (d > 0.0)
+				{
+					back = false;
+					// edges are great circles, which stay straight lines on the face
+					u /= d;
+					v /= d;
+					if (k == 0 || u < uMin) uMin = u;
+					if (k == 0 || u > uMax) uMax = u;
+					if (k == 0 || v < vMin) vMin = v;
+					if (k == 0 || v > vMax) vMax = v;
+				}
+				else
+				{
+					front = false;
+				}
+			}
+			if (back)
+				continue;
+			int iFirst = 0, iLast = FACE_CELLS - 1, jFirst = 0, jLast = FACE_CELLS - 1;
+			if (front)
+			{
+				if (uMax < -1.0 || uMin > 1.0 || vMax < -1.0 || vMin > 1.0)
+					continue;
+				iFirst = toCell(uMin);
+				iLast = toCell(uMax);
+				jFirst = toCell(vMin);
+				jLast = toCell(vMax);
+			}
+
+			for (int j = jFirst; j <= jLast; ++j)
+			{
+				for (int i = iFirst; i <= iLast; ++i)
+				{
+					int cell = (face * FACE_CELLS + j) * FACE_CELLS + i;
+					// cell edges are great circles too, so a convex polygon
+					// holding all four corners holds the whole cell
+					bool cover = shape.convex;
+					for (int corner = 0; corner < 4 && cover; ++corner)
+					{
+						cover = inside(shape, getCorner(face, i + corner % 2, j + corner / 2));
+					}
+					if (cover)
+					{
+						covers[cell] = index;
+						lists[cell].clear();
+					}
+					else
+					{
+						lists[cell].push_back(index);
+					}
+				}
+			}
+		}
+	}
+
+	_cells.resize(cells);
+	for (int cell = 0; cell < cells; ++cell)
+	{
+		_cells[cell].cover = covers[cell];
+		_cells[cell].first = _candidates.size();
+		_candidates.insert(_candidates.end(), lists[cell].begin(), lists[cell].end());
+		_cells[cell].last = _candidates.size();
+	}
+}
+
+/**
+ *
+ */
+PolygonGrid::~PolygonGrid()
+{
+}
+
+/**
+ * Converts a polar point into a direction from the center of the globe.
+ * @param lon Longitude of the point.
+ * @param lat Latitude of the point.
+ * @return Unit vector.
+ */
+Cord PolygonGrid::toCord(double lon, double lat)
+{
+	return Cord(CordPolar(lon, lat));
+}
+
+/**
+ * Finds the cell of the cube holding a direction.
+ * @param p Direction from the center of the globe.
+ * @return Cell index.
+ */
+int PolygonGrid::getCell(const Cord &p)
+{
+	double ax = fabs(p.x), ay = fabs(p.y), az = fabs(p.z);
+	int axis;
+	double sign;
+	if (ax >= ay && ax >= az)
+	{
+		axis = 0;
+		sign = p.x;
+	}
+	else if (ay >= az)
+	{
+		axis = 1;
+		sign = p.y;
+	}
+	else
+	{
+		axis = 2;
+		sign = p.z;
+	}
+	double d, u, v;
+	split(p, axis, &d, &u, &v);
+	if (d == 0.0)
+		return 0;
+	d = fabs(d);
+	int face = axis * 2 + (sign < 0.0 ? 1 : 0);
+	return (face * FACE_CELLS + toCell(v / d)) * FACE_CELLS + toCell(u / d);
+}
+
+/**
+ * Gets the direction of a corner of a cell, going out from
+ * the center of the globe.
+ * @param face Cube face.
+ * @param i Corner column, from 0 to FACE_CELLS.
+ * @param j Corner row, from 0 to FACE_CELLS.
+ * @return Direction (not normalized).
+ */
+Cord PolygonGrid::getCorner(int face, int i, int j)
+{
+	double d = (face % 2) ? -1.0 : 1.0;
+	double u = -1.0 + 2.0 * i / FACE_CELLS;
+	double v = -1.0 + 2.0 * j / FACE_CELLS;
+	switch (face / 2)
+	{
+	case 0:
+		return Cord(d, u, v);
+	case 1:
+		return Cord(u, d, v);
+	default:
+		return Cord(u, v, d);
+	}
+}
+
+/**
+ * Works out the vectors needed to test points against a polygon:
+ * the planes of its edges when it's convex, or else a flat
+ * projection around its center where its edges stay straight.
+ * Polygons with less than three distinct corners end up with no
+ * points, and nothing is ever inside them.
+ * @param polygon Pointer to the polygon.
+ * @param shape Output shape.
+ */
+void PolygonGrid::makeShape(Polygon *polygon, Shape *shape)
+{
+	shape->polygon = polygon;
+	shape->convex = false;
+	for (int i = 0; i < polygon->getPoints(); ++i)
+	{
+		shape->points.push_back(toCord(polygon->getLongitude(i), polygon->getLatitude(i)));
+		shape->center += shape->points.back();
+	}
+	double norm = shape->center.norm();
+	if (shape->points.size() < 3 || norm == 0.0)
+	{
+		shape->points.clear();
+		return;
+	}
+	shape->center /= norm;
+
+	size_t n = shape->points.size();
+	for (size_t i = 0; i < n; ++i)
+	{
+		Cord edge = cross(shape->points[i], shape->points[(i + 1) % n]);
+		if (edge.norm() < 1e-12)
+			continue;
+		if (dot(edge, shape->center) < 0.0)
+			edge = -edge;
+		shape->edges.push_back(edge);
+	}
+	if (shape->edges.size() < 3)
+	{
+		shape->points.clear();
+		return;
+	}
+
+	shape->convex = true;
+	for (size_t i = 0; i < shape->edges.size() && shape->convex; ++i)
+	{
+		for (size_t k = 0; k < n && shape->convex; ++k)
+		{
+			shape->convex = dot(shape->points[k], shape->edges[i]) > -1e-12;
+		}
+	}
+
+	// gnomonic projection for the rest
+	shape->axisU = cross(shape->center, fabs(shape->center.y) < 0.9 ? Cord(0.0, 1.0, 0.0) : Cord(1.0, 0.0, 0.0));
+	shape->axisU /= shape->axisU.norm();
+	shape->axisV = cross(shape->center, shape->axisU);
+	for (size_t k = 0; k < n; ++k)
+	{
+		double d = dot(shape->points[k], shape->center);
+		shape->u.push_back(dot(shape->points[k], shape->axisU) / d);
+		shape->v.push_back(dot(shape->points[k], shape->axisV) / d);
+	}
+}
+
+/**
+ * Checks if a direction points inside a shape.
+ * @param shape Polygon shape.
+ * @param p Direction from the center of the globe.
+ * @return True if it's inside.
+ */
+bool PolygonGrid::inside(const Shape &shape, const Cord &p)
+{
+	if (shape.points.empty())
+		return false;
+	double d = dot(p, shape.center);
+	if (d <= 0.0)
+		return false;
+	if (shape.convex)
+	{
+		for (std::vector<Cord>::const_iterator i = shape.edges.begin(); i != shape.edges.end(); ++i)
+		{
+			if (dot(p, *i) < 0.0)
+				return false;
+		}
+		return true;
+	}
+
+	double x = dot(p, shape.axisU) / d;
+	double y = dot(p, shape.axisV) / d;
+	bool odd = false;
+	size_t n = shape.u.size();
+	for (size_t i = 0, j = n - 1; i < n; j = i++)
+	{
+		if ((shape.v[i] < y && shape.v[j] >= y) || (shape.v[j] < y && shape.v[i] >= y))
+		{
+			odd ^= (shape.u[i] + (y - shape.v[i]) / (shape.v[j] - shape.v[i]) * (shape.u[j] - shape.u[i]) < x);
+		}
+	}
+	return odd;
+}
+
+/**
+ * Gets the polygon drawn on top at a point of the globe.
+ * @param lon Longitude of the point.
+ * @param lat Latitude of the point.
+ * @return Pointer to the polygon, or 0 if it's ocean.
+ */
+Polygon *PolygonGrid::find(double lon, double lat) const
+{
+	return find(toCord(lon, lat));
+}
+
+/**
+ * Gets the polygon drawn on top in a direction from the
+ * center of the globe.
+ * @param p Direction (doesn't need to be normalized).
+ * @return Pointer to the polygon, or 0 if it's ocean.
+ */
+Polygon *PolygonGrid::find(const Cord &p) const
+{
+	const Cell &cell = _cells[getCell(p)];
+	for (int i = cell.last - 1; i >= cell.first; --i)
+	{
+		const Shape &shape = _shapes[_candidates[i]];
+		if (inside(shape, p))
+			return shape.polygon;
+	}
+	return cell.cover >= 0 ? _shapes[cell.cover].polygon : 0;
+}
+
+}
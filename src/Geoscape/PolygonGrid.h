@@ -0,0 +1,85 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_POLYGONGRID_H
+#define OPENXCOM_POLYGONGRID_H
+
+#include <list>
+#include <vector>
+#include "Cord.h"
+
+namespace OpenXcom
+{
+
+class Polygon;
+
+/**
+ * Sorts the world polygons into the cells of a cube wrapped
+ * around the globe, so finding the polygon under a point only
+ * has to look at the few polygons around it.
+ * Cells lying fully inside a polygon remember it and need
+ * no test at all. Built once, since the polygons never move.
+ */
+class PolygonGrid
+{
+public:
+	/// Number of cells along each side of a cube face.
+	static const int FACE_CELLS = 64;
+private:
+	/// A polygon turned into vectors for testing points.
+	struct Shape
+	{
+		Polygon *polygon;
+		std::vector<Cord> points, edges;
+		std::vector<double> u, v;
+		Cord center, axisU, axisV;
+		bool convex;
+	};
+	/// The polygons that touch a cell.
+	struct Cell
+	{
+		int cover, first, last;
+	};
+	std::vector<Shape> _shapes;
+	std::vector<Cell> _cells;
+	std::vector<int> _candidates;
+
+	/// Gets the cell holding a direction.
+	static int getCell(const Cord &p);
+	/// Gets the direction of a corner of a cell.
+	static Cord getCorner(int face, int i, int j);
+	/// Sets up the shape of a polygon.
+	static void makeShape(Polygon *polygon, Shape *shape);
+	/// Checks if a direction is inside a shape.
+	static bool inside(const Shape &shape, const Cord &p);
+public:
+	/// Sorts a list of polygons into the grid.
+	PolygonGrid(const std::list<Polygon*> &polygons);
+	/// Cleans up the grid.
+	~PolygonGrid();
+	/// Gets the polygon on top at a point of the globe.
+	Polygon *find(double lon, double lat) const;
+	/// Gets the polygon on top in a direction from the center of the globe.
+	Polygon *find(const Cord &p) const;
+	/// Gets the direction of a point of the globe.
+	static Cord toCord(double lon, double lat);
+};
+
+}
+
+#endif
@@ -20,6 +20,7 @@
 #include <cctype>
 #include <cmath>
 #include <sstream>
+#include <map>
 #include "../Engine/Font.h"
 #include "../Engine/Options.h"
 #include "../Engine/Language.h"
@@ -29,6 +30,42 @@
 namespace OpenXcom
 {
 
+namespace
+{
+
+/// Everything the layout of a text depends on.
+struct LayoutKey
+{
+	int font, small, width, wrapping;
+	bool wrap, indent;
+	std::wstring text;
+
+	bool operator<(const LayoutKey &other) const
+	{
+		if (font != other.font) return font < other.font;
+		if (small != other.small) return small < other.small;
+		if (width != other.width) return width < other.width;
+		if (wrapping != other.wrapping) return wrapping < other.wrapping;
+		if (wrap != other.wrap) return wrap < other.wrap;
+		if (indent != other.indent) return indent < other.indent;
+		return text < other.text;
+	}
+};
+
+/// A text after wrapping, with the size of each line.
+struct Layout
+{
+	std::wstring text;
+	std::vector<int> lineWidth, lineHeight;
+};
+
+/// Lists and screens keep setting the same strings over and over,
+/// so remember how the latest ones were laid out.
+const size_t MAX_LAYOUTS = 2048;
+std::map<LayoutKey, Layout> layouts;
+
+}
+
 /**
  * Sets up a blank text with the specified size and position.
  * @param width Width in pixels.
@@ -361,10 +398,33 @@ void Text::processText()
 	// Use a separate string for wordwrapping text
 	if (_wrap)
 	{
-		_wrappedText = _text;
 		str = &_wrappedText;
 	}
 
+	// The width and wrapping only matter for wrapped text
+	LayoutKey key;
+	key.font = _font->getId();
+	key.small = _small ? _small->getId() : -1;
+	key.width = _wrap ? getWidth() : 0;
+	key.wrapping = _wrap ? (int)_lang->getTextWrapping() : 0;
+	key.wrap = _wrap;
+	key.indent = _wrap && _indent;
+	key.text = _text;
+	std::map<LayoutKey, Layout>::const_iterator cached = layouts.find(key);
+	if (cached != layouts.end())
+	{
+		*str = cached->second.text;
+		_lineWidth = cached->second.lineWidth;
+		_lineHeight = cached->second.lineHeight;
+		_redraw = true;
+		return;
+	}
+
+	if (_wrap)
+	{
+		_wrappedText = _text;
+	}
+
 	_lineWidth.clear();
 	_lineHeight.clear();
 
@@ -457,6 +517,15 @@ void Text::processText()
 		}
 	}
 
+	if (layouts.size() >= MAX_LAYOUTS)
+	{
+		layouts.clear();
+	}
+	Layout &layout = layouts[key];
+	layout.text = *str;
+	layout.lineWidth = _lineWidth;
+	layout.lineHeight = _lineHeight;
+
 	_redraw = true;
 }
 
@@ -19,6 +19,8 @@
 #include "TextList.h"
 #include <cstdarg>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <algorithm>
 #include "../Engine/Action.h"
 #include "../Engine/Font.h"
@@ -929,6 +931,115 @@ void TextList::draw()
 	}
 }
 
+/**
+ * Gets the height a text row takes up in the list,
+ * including the spacing below it.
+ * @param text Text row.
+ * @return Height in pixels.
+ */
+int TextList::getRowHeight(size_t text) const
+{
+	if (!_texts[text].empty())
+	{
+		return _texts[text].front()->getHeight() + _font->getSpacing();
+	}
+	return _font->getHeight() + _font->getSpacing();
+}
+
+/**
+ * Works out how far down from the top of the first row
+ * the list is showing at a scroll position.
+ * @param scroll Scroll position.
+ * @param filled Returns whether the rows drawn at that position
+ * reach the bottom of the list, or run out of rows first.
+ * @return Offset in pixels.
+ */
+int TextList::getScrollOffset(size_t scroll, bool *filled) const
+{
+	int offset = 0;
+	for (size_t i = 0; i < _rows[scroll]; ++i)
+	{
+		offset += getRowHeight(i);
+	}
+	// wrapped items can start above the visible surface
+	int y = 0;
+	for (size_t row = scroll; row > 0 && _rows[row] == _rows[row - 1]; --row)
+	{
+		y -= _font->getHeight() + _font->getSpacing();
+	}
+	offset -= y;
+	size_t last = std::min(_texts.size(), _rows[scroll] + _visibleRows);
+	for (size_t i = _rows[scroll]; i < last; ++i)
+	{
+		y += getRowHeight(i);
+	}
+	*filled = (last == _texts.size() || y >= getHeight());
+	return offset;
+}
+
+/**
+ * Draws the list after scrolling without redrawing every row:
+ * the rows still in view are moved up or down and only the ones
+ * coming into view get drawn. Falls back to drawing everything
+ * if the rows don't fill the list.
+ * @param oldScroll Scroll position at the last draw.
+ */
+void TextList::drawScroll(size_t oldScroll)
+{
+	bool oldFilled, newFilled;
+	int shift = getScrollOffset(_scroll, &newFilled) - getScrollOffset(oldScroll, &oldFilled);
+	if (!oldFilled || !newFilled || abs(shift) >= getHeight())
+	{
+		draw();
+		return;
+	}
+	if (shift == 0)
+	{
+		return;
+	}
+
+	SDL_Surface *surface = getSurface();
+	int keep = (getHeight() - abs(shift)) * surface->pitch;
+	lock();
+	if (shift > 0)
+	{
+		memmove(surface->pixels, (Uint8*)surface->pixels + shift * surface->pitch, keep);
+	}
+	else
+	{
+		memmove((Uint8*)surface->pixels - shift * surface->pitch, surface->pixels, keep);
+	}
+	unlock();
+
+	SDL_Rect strip;
+	strip.x = 0;
+	strip.y = (shift > 0) ? getHeight() - shift : 0;
+	strip.w = getWidth();
+	strip.h = abs(shift);
+	SDL_FillRect(surface, &strip, 0);
+	SDL_SetClipRect(surface, &strip);
+
+	int y = 0;
+	for (int row = _scroll; row > 0 && _rows[row] == _rows[row - 1]; --row)
+	{
+		y -= _font->getHeight() + _font->getSpacing();
+	}
+	for (size_t i = _rows[_scroll]; i < _texts.size() && i < _rows[_scroll] + _visibleRows; ++i)
+	{
+		int height = getRowHeight(i);
+		for (std::vector<Text*>::iterator j = _texts[i].begin(); j < _texts[i].end(); ++j)
+		{
+			(*j)->setY(y);
+			if (y < strip.y + strip.h && y + height > strip.y)
+			{
+				(*j)->blit(this);
+			}
+		}
+		y += height;
+	}
+	SDL_SetClipRect(surface, 0);
+}
+
 /**
  * Blits the text list and selector.
  * @param surface Pointer to surface to blit onto.
@@ -1196,8 +1307,16 @@ void TextList::scrollTo(size_t scroll)
 {
 	if (!_scrolling)
 		return;
+	size_t oldScroll = _scroll;
 	_scroll = std::max((size_t)(0), std::min(_rows.size() - _visibleRows, scroll));
-	draw(); // can't just set _redraw here because reasons
+	if (_redraw || _rows.empty())
+	{
+		draw(); // can't just set _redraw here because reasons
+	}
+	else
+	{
+		drawScroll(oldScroll);
+	}
 	updateArrows();
 }
 
@@ -66,6 +66,12 @@ private:
 	void updateArrows();
 	/// Updates the visible rows.
 	void updateVisible();
+	/// Gets the height taken by a text row.
+	int getRowHeight(size_t text) const;
+	/// Gets how far down the list a scroll position starts.
+	int getScrollOffset(size_t scroll, bool *filled) const;
+	/// Moves the drawn rows after scrolling and draws the new ones.
+	void drawScroll(size_t oldScroll);
 public:
 	/// Creates a text list with the specified size and position.
 	TextList(int width, int height, int x = 0, int y = 0);
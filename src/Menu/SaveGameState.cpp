@@ -32,6 +32,7 @@
 #include "MainMenuState.h"
 #include "../Savegame/SavedGame.h"
 #include "../Savegame/SavedBattleGame.h"
+#include "../Savegame/SaveWriter.h"
 
 namespace OpenXcom
 {
@@ -43,7 +44,7 @@ namespace OpenXcom
  * @param filename Name of the save file without extension.
  * @param palette Parent state palette.
  */
-SaveGameState::SaveGameState(OptionsOrigin origin, const std::string &filename, SDL_Color *palette) : _firstRun(0), _origin(origin), _filename(filename), _type(SAVE_DEFAULT)
+SaveGameState::SaveGameState(OptionsOrigin origin, const std::string &filename, SDL_Color *palette) : _firstRun(0), _progress(-1), _origin(origin), _filename(filename), _type(SAVE_DEFAULT), _writer(0)
 {
 	buildUi(palette);
 }
@@ -55,7 +56,7 @@ SaveGameState::SaveGameState(OptionsOrigin origin, const std::string &filename,
  * @param type Type of auto-save being used.
  * @param palette Parent state palette.
  */
-SaveGameState::SaveGameState(OptionsOrigin origin, SaveType type, SDL_Color *palette) : _firstRun(0), _origin(origin), _type(type)
+SaveGameState::SaveGameState(OptionsOrigin origin, SaveType type, SDL_Color *palette) : _firstRun(0), _progress(-1), _origin(origin), _type(type), _writer(0)
 {
 	switch (type)
 	{
@@ -84,7 +85,7 @@ SaveGameState::SaveGameState(OptionsOrigin origin, SaveType type, SDL_Color *pal
  */
 SaveGameState::~SaveGameState()
 {
-
+	delete _writer;
 }
 
 /**
@@ -121,7 +122,8 @@ void SaveGameState::buildUi(SDL_Color *palette)
 }
 
 /**
- * Saves the current save.
+ * Snapshots the current save and writes it in the background,
+ * updating the progress until it's done.
  */
 void SaveGameState::think()
 {
@@ -131,21 +133,10 @@ void SaveGameState::think()
 	{
 		_firstRun++;
 	}
-	else
+	else if (_writer == 0)
 	{
-		_game->popState();
-
 		switch (_type)
 		{
-		case SAVE_DEFAULT:
-			// manual save, close the save screen
-			_game->popState();
-			if (!_game->getSavedGame()->isIronman())
-			{
-				// and pause screen too
-				_game->popState();
-			}
-			break;
 		case SAVE_QUICK:
 		case SAVE_AUTO_GEOSCAPE:
 		case SAVE_AUTO_BATTLESCAPE:
@@ -156,16 +147,41 @@ void SaveGameState::think()
 		}
 
 		// Save the game
+		_writer = new SaveWriter(_filename);
 		try
 		{
-			std::string backup = _filename + ".bak";
-			_game->getSavedGame()->save(backup);
-			std::string fullPath = Options::getUserFolder() + _filename;
-			std::string bakPath = Options::getUserFolder() + backup;
-			if (!CrossPlatform::moveFile(bakPath, fullPath))
-			{
-				throw Exception("Save backed up in " + backup);
-			}
+			_game->getSavedGame()->save(_writer);
+			_writer->start();
+		}
+		catch (Exception &e)
+		{
+			close();
+			error(e.what());
+		}
+		catch (YAML::Exception &e)
+		{
+			close();
+			error(e.what());
+		}
+	}
+	else if (!_writer->isDone())
+	{
+		int progress = _writer->getProgress();
+		if (progress != _progress)
+		{
+			_progress = progress;
+			std::wostringstream ss;
+			ss << tr("STR_SAVING_GAME") << L' ' << Text::formatPercentage(progress);
+			_txtStatus->setText(ss.str());
+		}
+	}
+	else
+	{
+		close();
+		try
+		{
+			_writer->finish();
+			Log(LOG_INFO) << "Saved " << _filename << " (snapshot in " << _writer->getSnapshotTime() << "ms, written in " << _writer->getWriteTime() << "ms)";
 
 			if (_type == SAVE_IRONMAN_END)
 			{
@@ -178,25 +194,43 @@ void SaveGameState::think()
 		}
 		catch (Exception &e)
 		{
-			Log(LOG_ERROR) << e.what();
-			std::wostringstream error;
-			error << tr("STR_SAVE_UNSUCCESSFUL") << L'\x02' << Language::fsToWstr(e.what());
-			if (_origin != OPT_BATTLESCAPE)
-				_game->pushState(new ErrorMessageState(error.str(), _palette, _game->getRuleset()->getInterface("errorMessages")->getElement("geoscapeColor")->color, "BACK01.SCR", _game->getRuleset()->getInterface("errorMessages")->getElement("geoscapePalette")->color));
-			else
-				_game->pushState(new ErrorMessageState(error.str(), _palette, _game->getRuleset()->getInterface("errorMessages")->getElement("battlescapeColor")->color, "TAC00.SCR", _game->getRuleset()->getInterface("errorMessages")->getElement("battlescapePalette")->color));
+			error(e.what());
 		}
-		catch (YAML::Exception &e)
+	}
+}
+
+/**
+ * Closes the save screen, along with the screens it came from.
+ */
+void SaveGameState::close()
+{
+	_game->popState();
+
+	if (_type == SAVE_DEFAULT)
+	{
+		// manual save, close the save screen
+		_game->popState();
+		if (!_game->getSavedGame()->isIronman())
 		{
-			Log(LOG_ERROR) << e.what();
-			std::wostringstream error;
-			error << tr("STR_SAVE_UNSUCCESSFUL") << L'\x02' << Language::fsToWstr(e.what());
-			if (_origin != OPT_BATTLESCAPE)
-				_game->pushState(new ErrorMessageState(error.str(), _palette, _game->getRuleset()->getInterface("errorMessages")->getElement("geoscapeColor")->color, "BACK01.SCR", _game->getRuleset()->getInterface("errorMessages")->getElement("geoscapePalette")->color));
-			else
-				_game->pushState(new ErrorMessageState(error.str(), _palette, _game->getRuleset()->getInterface("errorMessages")->getElement("battlescapeColor")->color, "TAC00.SCR", _game->getRuleset()->getInterface("errorMessages")->getElement("battlescapePalette")->color));
+			// and pause screen too
+			_game->popState();
 		}
 	}
 }
 
+/**
+ * Pops up a window with an error if the game couldn't be saved.
+ * @param msg Error message.
+ */
+void SaveGameState::error(const std::string &msg)
+{
+	Log(LOG_ERROR) << msg;
+	std::wostringstream error;
+	error << tr("STR_SAVE_UNSUCCESSFUL") << L'\x02' << Language::fsToWstr(msg);
+	if (_origin != OPT_BATTLESCAPE)
+		_game->pushState(new ErrorMessageState(error.str(), _palette, _game->getRuleset()->getInterface("errorMessages")->getElement("geoscapeColor")->color, "BACK01.SCR", _game->getRuleset()->getInterface("errorMessages")->getElement("geoscapePalette")->color));
+	else
+		_game->pushState(new ErrorMessageState(error.str(), _palette, _game->getRuleset()->getInterface("errorMessages")->getElement("battlescapeColor")->color, "TAC00.SCR", _game->getRuleset()->getInterface("errorMessages")->getElement("battlescapePalette")->color));
+}
+
 }
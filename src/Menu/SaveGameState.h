@@ -29,6 +29,7 @@ namespace OpenXcom
 {
 
 class Text;
+class SaveWriter;
 
 /**
  * Saves the current game, with an optional message.
@@ -36,11 +37,17 @@ class Text;
 class SaveGameState : public State
 {
 private:
-	int _firstRun;
+	int _firstRun, _progress;
 	OptionsOrigin _origin;
 	Text *_txtStatus;
 	std::string _filename;
 	SaveType _type;
+	SaveWriter *_writer;
+
+	/// Closes the save screens.
+	void close();
+	/// Shows a save error.
+	void error(const std::string &msg);
 public:
 	/// Creates the Save Game state.
 	SaveGameState(OptionsOrigin origin, const std::string &filename, SDL_Color *palette);
@@ -50,7 +57,7 @@ public:
 	~SaveGameState();
 	/// Creates the interface.
 	void buildUi(SDL_Color *palette);
-	/// Saves the game.
+	/// Saves the game in the background.
 	void think();
 };
 
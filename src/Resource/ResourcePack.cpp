@@ -27,6 +27,8 @@
 #include "../Engine/SoundSet.h"
 #include "../Engine/Sound.h"
 #include "../Engine/Options.h"
+#include "../Engine/Exception.h"
+#include "../Engine/Logger.h"
 
 namespace OpenXcom
 {
@@ -65,10 +67,11 @@ std::string ResourcePack::DEBRIEF_MUSIC_BAD;
 /**
  * Initializes a blank resource set pointing to a folder.
  */
-ResourcePack::ResourcePack()
+ResourcePack::ResourcePack() : _hasColors(false), _prefetchThread(0)
 {
 	_muteMusic = new Music();
 	_muteSound = new Sound();
+	_mutex = SDL_CreateMutex();
 }
 
 /**
@@ -76,6 +79,8 @@ ResourcePack::ResourcePack()
  */
 ResourcePack::~ResourcePack()
 {
+	waitPrefetch();
+	SDL_DestroyMutex(_mutex);
 	delete _muteMusic;
 	delete _muteSound;
 	for (std::map<std::string, Font*>::iterator i = _fonts.begin(); i != _fonts.end(); ++i)
@@ -128,13 +133,151 @@ Surface *ResourcePack::getSurface(const std::string &name) const
 
 /**
  * Returns a specific surface set from the resource set.
+ * Sets loaded on demand are decoded without holding the lock,
+ * so other threads can keep looking up sets in the meantime,
+ * and only the finished set is added to the resource set.
  * @param name Name of the surface set.
  * @return Pointer to the surface set.
  */
 SurfaceSet *ResourcePack::getSurfaceSet(const std::string &name) const
 {
+	SurfaceSet *set = 0;
+	bool lazy = false;
+	SDL_mutexP(_mutex);
 	std::map<std::string, SurfaceSet*>::const_iterator i = _sets.find(name);
-	if (_sets.end() != i) return i->second; else return 0;
+	if (_sets.end() != i)
+	{
+		set = i->second;
+	}
+	else
+	{
+		lazy = (_lazySets.find(name) != _lazySets.end());
+	}
+	SDL_mutexV(_mutex);
+	if (!lazy)
+	{
+		return set;
+	}
+
+	set = createSurfaceSet(name);
+	if (set == 0)
+	{
+		return 0;
+	}
+	SDL_mutexP(_mutex);
+	i = _sets.find(name);
+	if (_sets.end() != i)
+	{
+		// another thread got there first
+		delete set;
+		set = i->second;
+	}
+	else
+	{
+		if (_hasColors)
+		{
+			set->setPalette(const_cast<SDL_Color*>(_colors), 0, 256);
+		}
+		_sets[name] = set;
+	}
+	SDL_mutexV(_mutex);
+	return set;
+}
+
+/**
+ * Starts loading some surface sets on another thread, so they're
+ * likely ready by the time they're needed. Any set asked for
+ * before it's ready is just loaded right away as usual.
+ * @param names Names of the surface sets.
+ */
+void ResourcePack::prefetchSurfaceSets(const std::vector<std::string> &names)
+{
+	waitPrefetch();
+	_prefetchSets = names;
+	_prefetchThread = SDL_CreateThread(prefetch, (void*)this);
+}
+
+/**
+ * Loads the surface sets queued for prefetching.
+ * @param data Pointer to the resource pack.
+ * @return Thread exit code.
+ */
+int ResourcePack::prefetch(void *data)
+{
+	ResourcePack *pack = (ResourcePack*)data;
+	for (std::vector<std::string>::const_iterator i = pack->_prefetchSets.begin(); i != pack->_prefetchSets.end(); ++i)
+	{
+		try
+		{
+			pack->getSurfaceSet(*i);
+		}
+		catch (Exception &e)
+		{
+			Log(LOG_WARNING) << e.what();
+		}
+	}
+	return 0;
+}
+
+/**
+ * Waits until the prefetch thread, if any, is done loading.
+ */
+void ResourcePack::waitPrefetch()
+{
+	if (_prefetchThread != 0)
+	{
+		SDL_WaitThread(_prefetchThread, 0);
+		_prefetchThread = 0;
+	}
+}
+
+/**
+ * Unloads every surface set that was loaded on demand, so they
+ * don't stay in memory once they're no longer used. They'll be
+ * loaded again the next time they're needed.
+ * @warning Any pointers to these sets become invalid.
+ */
+void ResourcePack::releaseSurfaceSets()
+{
+	waitPrefetch();
+	size_t count = 0, memory = 0;
+	for (std::set<std::string>::const_iterator i = _lazySets.begin(); i != _lazySets.end(); ++i)
+	{
+		std::map<std::string, SurfaceSet*>::iterator set = _sets.find(*i);
+		if (set != _sets.end())
+		{
+			memory += set->second->getTotalFrames() * set->second->getWidth() * set->second->getHeight();
+			delete set->second;
+			_sets.erase(set);
+			count++;
+		}
+	}
+	if (count != 0)
+	{
+		Log(LOG_INFO) << "Released " << count << " surface sets (" << memory / 1024 << " KB)";
+	}
+}
+
+/**
+ * Loads a surface set that was registered to be loaded on demand.
+ * This can run on the prefetch thread without the lock, so it must
+ * not change any surface that's already in the resource set.
+ * @param name Name of the surface set.
+ * @return Pointer to the new surface set, or NULL if there's none.
+ */
+SurfaceSet *ResourcePack::createSurfaceSet(const std::string &) const
+{
+	return 0;
+}
+
+/**
+ * Loads a music that was registered to be loaded on demand.
+ * @param name Name of the music.
+ * @return Pointer to the new music, or NULL if it couldn't be loaded.
+ */
+Music *ResourcePack::createMusic(const std::string &) const
+{
+	return 0;
 }
 
 /**
@@ -151,7 +294,20 @@ Music *ResourcePack::getMusic(const std::string &name) const
 	else
 	{
 		std::map<std::string, Music*>::const_iterator i = _musics.find(name);
-		if (_musics.end() != i) return i->second; else return 0;
+		if (_musics.end() != i) return i->second;
+
+		Music *music = 0;
+		std::set<std::string>::iterator lazy = _lazyMusics.find(name);
+		if (lazy != _lazyMusics.end())
+		{
+			_lazyMusics.erase(lazy);
+			music = createMusic(name);
+			if (music != 0)
+			{
+				_musics[name] = music;
+			}
+		}
+		return music;
 	}
 }
 
@@ -168,6 +324,19 @@ Music *ResourcePack::getRandomMusic(const std::string &name) const
 	}
 	else
 	{
+		std::vector<std::string> lazy;
+		for (std::set<std::string>::const_iterator i = _lazyMusics.begin(); i != _lazyMusics.end(); ++i)
+		{
+			if (i->find(name) != std::string::npos)
+			{
+				lazy.push_back(*i);
+			}
+		}
+		for (std::vector<std::string>::const_iterator i = lazy.begin(); i != lazy.end(); ++i)
+		{
+			getMusic(*i);
+		}
+
 		std::vector<Music*> music;
 		for (std::map<std::string, Music*>::const_iterator i = _musics.begin(); i != _musics.end(); ++i)
 		{
@@ -176,7 +345,7 @@ Music *ResourcePack::getRandomMusic(const std::string &name) const
 				music.push_back(i->second);
 			}
 		}
-		if (_musics.empty())
+		if (music.empty())
 			return _muteMusic;
 		else
 			return music[RNG::seedless(0, music.size()-1)];
@@ -250,6 +419,13 @@ Palette *ResourcePack::getPalette(const std::string &name) const
  */
 void ResourcePack::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 {
+	SDL_mutexP(_mutex);
+	// remember it for the sets that aren't loaded yet
+	for (int i = 0; i < ncolors; ++i)
+	{
+		_colors[firstcolor + i] = colors[i];
+	}
+	_hasColors = true;
 	for (std::map<std::string, Font*>::iterator i = _fonts.begin(); i != _fonts.end(); ++i)
 	{
 		i->second->getSurface()->setPalette(colors, firstcolor, ncolors);
@@ -263,6 +439,7 @@ void ResourcePack::setPalette(SDL_Color *colors, int firstcolor, int ncolors)
 	{
 		i->second->setPalette(colors, firstcolor, ncolors);
 	}
+	SDL_mutexV(_mutex);
 }
 
 /**
@@ -20,9 +20,11 @@
 #define OPENXCOM_RESOURCEPACK_H
 
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <SDL.h>
+#include <SDL_thread.h>
 
 namespace OpenXcom
 {
@@ -43,6 +45,8 @@ class Sound;
  * @note The game is still hardcoded to X-Com resources,
  * so for now this just serves to keep all the file loading
  * in one place.
+ * Some surface sets and musics are only registered up front
+ * and get loaded the first time they're asked for.
  */
 class ResourcePack
 {
@@ -50,15 +54,30 @@ private:
 	Music *_muteMusic;
 	Sound *_muteSound;
 	std::string _playingMusic;
+	SDL_Color _colors[256];
+	bool _hasColors;
+	SDL_mutex *_mutex;
+	SDL_Thread *_prefetchThread;
+	std::vector<std::string> _prefetchSets;
+
+	/// Entry point of the prefetch thread.
+	static int prefetch(void *data);
 protected:
 	std::map<std::string, Palette*> _palettes;
 	std::map<std::string, Font*> _fonts;
 	std::map<std::string, Surface*> _surfaces;
-	std::map<std::string, SurfaceSet*> _sets;
+	mutable std::map<std::string, SurfaceSet*> _sets;
 	std::map<std::string, SoundSet*> _sounds;
-	std::map<std::string, Music*> _musics;
+	mutable std::map<std::string, Music*> _musics;
+	std::set<std::string> _lazySets;
+	mutable std::set<std::string> _lazyMusics;
 	std::vector<Uint16> _voxelData;
 	std::vector<std::vector<Uint8> > _transparencyLUTs;
+
+	/// Loads a surface set the first time it's needed.
+	virtual SurfaceSet *createSurfaceSet(const std::string &name) const;
+	/// Loads a music the first time it's needed.
+	virtual Music *createMusic(const std::string &name) const;
 public:
 	static int DOOR_OPEN;
 	static int SLIDING_DOOR_OPEN;
@@ -100,6 +119,12 @@ public:
 	Surface *getSurface(const std::string &name) const;
 	/// Gets a particular surface set.
 	SurfaceSet *getSurfaceSet(const std::string &name) const;
+	/// Starts loading surface sets in the background.
+	void prefetchSurfaceSets(const std::vector<std::string> &names);
+	/// Waits for the surface sets being loaded in the background.
+	void waitPrefetch();
+	/// Unloads the surface sets that were loaded on demand.
+	void releaseSurfaceSets();
 	/// Gets a particular music.
 	Music *getMusic(const std::string &name) const;
 	/// Plays a particular music.
@@ -19,6 +19,8 @@
 #include "XcomResourcePack.h"
 #include <sstream>
 #include <climits>
+#include <cstring>
+#include <algorithm>
 #include "../Engine/CrossPlatform.h"
 #include "../Engine/FileMap.h"
 #include "../Engine/Palette.h"
@@ -328,50 +330,14 @@ XcomResourcePack::XcomResourcePack(Ruleset *rules) : ResourcePack()
 
 	if (!Options::mute)
 	{
-#ifndef __NO_MUSIC
-		// Load musics
-		const std::map<std::string, RuleMusic *> musics = *rules->getMusic();
-
-		// Check which music version is available
-		CatFile *adlibcat = 0, *aintrocat = 0;
-		GMCatFile *gmcat = 0;
-
 		const std::set<std::string> &soundFiles(FileMap::getVFolderContents("SOUND"));
-		for (std::set<std::string>::iterator i = soundFiles.begin(); i != soundFiles.end(); ++i)
-		{
-			if (0 == i->compare("adlib.cat"))
-			{
-				adlibcat = new CatFile(FileMap::getFilePath("SOUND/" + *i).c_str());
-			}
-			else if (0 == i->compare("aintro.cat"))
-			{
-				aintrocat = new CatFile(FileMap::getFilePath("SOUND/" + *i).c_str());
-			}
-			else if (0 == i->compare("gm.cat"))
-			{
-				gmcat = new GMCatFile(FileMap::getFilePath("SOUND/" + *i).c_str());
-			}
-		}
-
-		// Try the preferred format first, otherwise use the default priority
-		MusicFormat priority[] = {Options::preferredMusic, MUSIC_FLAC, MUSIC_OGG, MUSIC_MP3, MUSIC_MOD, MUSIC_WAV, MUSIC_ADLIB, MUSIC_MIDI};
-		for (std::map<std::string, RuleMusic *>::const_iterator i = musics.begin(); i != musics.end(); ++i)
+#ifndef __NO_MUSIC
+		// Musics are loaded when they're first played
+		const std::map<std::string, RuleMusic *> *musics = rules->getMusic();
+		for (std::map<std::string, RuleMusic *>::const_iterator i = musics->begin(); i != musics->end(); ++i)
 		{
-			Music *music = 0;
-			for (size_t j = 0; j < sizeof(priority)/sizeof(priority[0]) && music == 0; ++j)
-			{
-				music = loadMusic(priority[j], (*i).first, (*i).second->getCatPos(), (*i).second->getNormalization(), adlibcat, aintrocat, gmcat);
-			}
-			if (music)
-			{
-				_musics[(*i).first] = music;
-			}
-
+			_lazyMusics.insert(i->first);
 		}
-
-		delete gmcat;
-		delete adlibcat;
-		delete aintrocat;
 #endif
 
 		if (rules->getSoundDefinitions()->empty())
@@ -528,6 +494,12 @@ XcomResourcePack::XcomResourcePack(Ruleset *rules) : ResourcePack()
 		}
 		else
 		{
+			// sets loaded on demand have to be loaded now to be modded, and then stay loaded
+			if (_lazySets.find(sheetName) != _lazySets.end())
+			{
+				getSurfaceSet(sheetName);
+				_lazySets.erase(sheetName);
+			}
 			bool adding = false;
 			if (_sets.find(sheetName) == _sets.end())
 			{
@@ -653,18 +625,6 @@ XcomResourcePack::XcomResourcePack(Ruleset *rules) : ResourcePack()
 		}
 	}
 
-	// copy constructor doesn't like doing this directly, so let's make a second handobs file the old fashioned way.
-	// handob2 is used for all the left handed sprites.
-	_sets["HANDOB2.PCK"] = new SurfaceSet(_sets["HANDOB.PCK"]->getWidth(), _sets["HANDOB.PCK"]->getHeight());
-	std::map<int, Surface*> *handob = _sets["HANDOB.PCK"]->getFrames();
-	for (std::map<int, Surface*>::const_iterator i = handob->begin(); i != handob->end(); ++i)
-	{
-		Surface *surface1 = _sets["HANDOB2.PCK"]->addFrame(i->first);
-		Surface *surface2 = i->second;
-		surface1->setPalette(surface2->getPalette());
-		surface2->blit(surface1);
-	}
-
 	std::vector< std::pair<std::string, ExtraSounds *> >extraSounds = rules->getExtraSounds();
 	for (std::vector< std::pair<std::string, ExtraSounds *> >::const_iterator i = extraSounds.begin(); i != extraSounds.end(); ++i)
 	{
@@ -756,23 +716,19 @@ void XcomResourcePack::loadBattlescapeResources()
 	_sets["BLANKS.PCK"] = new SurfaceSet(32, 40);
 	_sets["BLANKS.PCK"]->loadPck(FileMap::getFilePath("TERRAIN/BLANKS.PCK"), FileMap::getFilePath("TERRAIN/BLANKS.TAB"));
 
-	// Load Battlescape units
+	// Load Battlescape units (only registered, they're loaded when first needed)
 	std::set<std::string> unitsContents = FileMap::getVFolderContents("UNITS");
 	std::set<std::string> usets = FileMap::filterFiles(unitsContents, "PCK");
 	for (std::set<std::string>::iterator i = usets.begin(); i != usets.end(); ++i)
 	{
-		std::string path = FileMap::getFilePath("UNITS/" + *i);
-		std::string tab = FileMap::getFilePath("UNITS/" + CrossPlatform::noExt(*i) + ".TAB");
 		std::string fname = *i;
 		std::transform(i->begin(), i->end(), fname.begin(), toupper);
-		if (fname != "BIGOBS.PCK")
-			_sets[fname] = new SurfaceSet(32, 40);
-		else
-			_sets[fname] = new SurfaceSet(32, 48);
-		_sets[fname]->loadPck(path, tab);
+		_unitSets[fname] = *i;
+		_lazySets.insert(fname);
 	}
+	_lazySets.insert("HANDOB2.PCK");
 	// incomplete chryssalid set: 1.0 data: stop loading.
-	if (_sets.find("CHRYS.PCK") != _sets.end() && !_sets["CHRYS.PCK"]->getFrame(225))
+	if (_unitSets.find("CHRYS.PCK") != _unitSets.end() && !getSurfaceSet("CHRYS.PCK")->getFrame(225))
 	{
 		Log(LOG_FATAL) << "Version 1.0 data detected";
 		throw Exception("Invalid CHRYS.PCK, please patch your X-COM data to the latest version");
@@ -887,139 +843,244 @@ void XcomResourcePack::loadBattlescapeResources()
 		_surfaces[fname] = new Surface(320, 200);
 		_surfaces[fname]->loadSpk(FileMap::getFilePath("UFOGRAPH/" + fname));
 	}
+}
+
+/**
+ * Loads a surface set that was registered to be loaded on demand,
+ * which are the Battlescape units.
+ * @param name Name of the surface set.
+ * @return Pointer to the new surface set, or NULL if there's none.
+ */
+SurfaceSet *XcomResourcePack::createSurfaceSet(const std::string &name) const
+{
+	if (name == "HANDOB2.PCK")
+	{
+		// copy constructor doesn't like doing this directly, so let's make a second handobs file the old fashioned way.
+		// handob2 is used for all the left handed sprites.
+		// this can run on the prefetch thread while the palette changes, so only
+		// the pixels are copied, and the palette is set once the set is added.
+		SurfaceSet *handob = getSurfaceSet("HANDOB.PCK");
+		SurfaceSet *handob2 = new SurfaceSet(handob->getWidth(), handob->getHeight());
+		std::map<int, Surface*> *frames = handob->getFrames();
+		for (std::map<int, Surface*>::const_iterator i = frames->begin(); i != frames->end(); ++i)
+		{
+			SDL_Surface *dest = handob2->addFrame(i->first)->getSurface();
+			SDL_Surface *src = i->second->getSurface();
+			SDL_LockSurface(dest);
+			for (int y = 0; y < src->h && y < dest->h; ++y)
+			{
+				memcpy((Uint8*)dest->pixels + y * dest->pitch, (const Uint8*)src->pixels + y * src->pitch, std::min(src->w, dest->w));
+			}
+			SDL_UnlockSurface(dest);
+		}
+		return handob2;
+	}
 
-	//"fix" of color index in original solders sprites
+	std::map<std::string, std::string>::const_iterator file = _unitSets.find(name);
+	if (file == _unitSets.end())
+	{
+		return 0;
+	}
+	std::string path = FileMap::getFilePath("UNITS/" + file->second);
+	std::string tab = FileMap::getFilePath("UNITS/" + CrossPlatform::noExt(file->second) + ".TAB");
+	SurfaceSet *set;
+	if (name != "BIGOBS.PCK")
+		set = new SurfaceSet(32, 40);
+	else
+		set = new SurfaceSet(32, 48);
+	set->loadPck(path, tab);
 	if (Options::battleHairBleach)
 	{
-		std::string name;
+		fixSoldierSprites(name, set);
+	}
+	return set;
+}
 
-		//personal armor
-		name = "XCOM_1.PCK";
-		if (_sets.find(name) != _sets.end())
+/**
+ * "Fixes" the color indexes of the hair and faces in the original
+ * soldier sprites, so they can be recolored.
+ * @param name Name of the surface set.
+ * @param set Pointer to the surface set.
+ */
+void XcomResourcePack::fixSoldierSprites(const std::string &name, SurfaceSet *set) const
+{
+	//personal armor
+	if (name == "XCOM_1.PCK")
+	{
+		SurfaceSet *xcom_1 = set;
+
+		for (int i = 0; i < 8; ++i)
+		{
+			//chest frame
+			Surface *surf = xcom_1->getFrame(4 * 8 + i);
+			ShaderMove<Uint8> head = ShaderMove<Uint8>(surf);
+			GraphSubset dim = head.getBaseDomain();
+			surf->lock();
+			dim.beg_y = 6;
+			dim.end_y = 9;
+			head.setDomain(dim);
+			ShaderDraw<HairXCOM1>(head, ShaderScalar<Uint8>(HairXCOM1::Face + 5));
+			dim.beg_y = 9;
+			dim.end_y = 10;
+			head.setDomain(dim);
+			ShaderDraw<HairXCOM1>(head, ShaderScalar<Uint8>(HairXCOM1::Face + 6));
+			surf->unlock();
+		}
+
+		for (int i = 0; i < 3; ++i)
 		{
-			SurfaceSet *xcom_1 = _sets[name];
+			//fall frame
+			Surface *surf = xcom_1->getFrame(264 + i);
+			ShaderMove<Uint8> head = ShaderMove<Uint8>(surf);
+			GraphSubset dim = head.getBaseDomain();
+			dim.beg_y = 0;
+			dim.end_y = 24;
+			dim.beg_x = 11;
+			dim.end_x = 20;
+			head.setDomain(dim);
+			surf->lock();
+			ShaderDraw<HairXCOM1>(head, ShaderScalar<Uint8>(HairXCOM1::Face + 6));
+			surf->unlock();
+		}
+	}
 
-			for (int i = 0; i < 8; ++i)
+	//all TFDT armors
+	std::string tdxcom = "TDXCOM_?.PCK";
+	for (int j = 0; j < 3; ++j)
+	{
+		tdxcom[7] = '0' + j;
+		if (name == tdxcom)
+		{
+			SurfaceSet *xcom_2 = set;
+			for (int i = 0; i < 16; ++i)
 			{
-				//chest frame
-				Surface *surf = xcom_1->getFrame(4 * 8 + i);
-				ShaderMove<Uint8> head = ShaderMove<Uint8>(surf);
-				GraphSubset dim = head.getBaseDomain();
+				//chest frame without helm
+				Surface *surf = xcom_2->getFrame(262 + i);
 				surf->lock();
-				dim.beg_y = 6;
-				dim.end_y = 9;
-				head.setDomain(dim);
-				ShaderDraw<HairXCOM1>(head, ShaderScalar<Uint8>(HairXCOM1::Face + 5));
-				dim.beg_y = 9;
-				dim.end_y = 10;
-				head.setDomain(dim);
-				ShaderDraw<HairXCOM1>(head, ShaderScalar<Uint8>(HairXCOM1::Face + 6));
+				if (i < 8)
+				{
+					//female chest frame
+					ShaderMove<Uint8> head = ShaderMove<Uint8>(surf);
+					GraphSubset dim = head.getBaseDomain();
+					dim.beg_y = 6;
+					dim.end_y = 18;
+					head.setDomain(dim);
+					ShaderDraw<HairXCOM2>(head);
+
+					if (j == 2)
+					{
+						//fix some pixels in ION armor that was overwrite by previous function
+						if (i == 0)
+						{
+							surf->setPixel(18, 14, 16);
+						}
+						else if (i == 3)
+						{
+							surf->setPixel(19, 12, 20);
+						}
+						else if (i == 6)
+						{
+							surf->setPixel(13, 14, 16);
+						}
+					}
+				}
+
+				//we change face to pink, to prevent mixup with ION armor backpack that have same color group.
+				ShaderDraw<FaceXCOM2>(ShaderMove<Uint8>(surf));
 				surf->unlock();
 			}
 
-			for (int i = 0; i < 3; ++i)
+			for (int i = 0; i < 2; ++i)
 			{
-				//fall frame
-				Surface *surf = xcom_1->getFrame(264 + i);
+				//fall frame (first and second)
+				Surface *surf = xcom_2->getFrame(256 + i);
+				surf->lock();
+
 				ShaderMove<Uint8> head = ShaderMove<Uint8>(surf);
 				GraphSubset dim = head.getBaseDomain();
 				dim.beg_y = 0;
-				dim.end_y = 24;
-				dim.beg_x = 11;
-				dim.end_x = 20;
+				if (j == 3)
+				{
+					dim.end_y = 11 + 5 * i;
+				}
+				else
+				{
+					dim.end_y = 17;
+				}
 				head.setDomain(dim);
-				surf->lock();
-				ShaderDraw<HairXCOM1>(head, ShaderScalar<Uint8>(HairXCOM1::Face + 6));
+				ShaderDraw<FallXCOM2>(head);
+
+				//we change face to pink, to prevent mixup with ION armor backpack that have same color group.
+				ShaderDraw<FaceXCOM2>(ShaderMove<Uint8>(surf));
 				surf->unlock();
 			}
-		}
 
-		//all TFDT armors
-		name = "TDXCOM_?.PCK";
-		for (int j = 0; j < 3; ++j)
-		{
-			name[7] = '0' + j;
-			if (_sets.find(name) != _sets.end())
+			//Palette fix for ION armor
+			if (j == 2)
 			{
-				SurfaceSet *xcom_2 = _sets[name];
-				for (int i = 0; i < 16; ++i)
+				int size = xcom_2->getTotalFrames();
+				for (int i = 0; i < size; ++i)
 				{
-					//chest frame without helm
-					Surface *surf = xcom_2->getFrame(262 + i);
+					Surface *surf = xcom_2->getFrame(i);
 					surf->lock();
-					if (i < 8)
-					{
-						//female chest frame
-						ShaderMove<Uint8> head = ShaderMove<Uint8>(surf);
-						GraphSubset dim = head.getBaseDomain();
-						dim.beg_y = 6;
-						dim.end_y = 18;
-						head.setDomain(dim);
-						ShaderDraw<HairXCOM2>(head);
-
-						if (j == 2)
-						{
-							//fix some pixels in ION armor that was overwrite by previous function
-							if (i == 0)
-							{
-								surf->setPixel(18, 14, 16);
-							}
-							else if (i == 3)
-							{
-								surf->setPixel(19, 12, 20);
-							}
-							else if (i == 6)
-							{
-								surf->setPixel(13, 14, 16);
-							}
-						}
-					}
-
-					//we change face to pink, to prevent mixup with ION armor backpack that have same color group.
-					ShaderDraw<FaceXCOM2>(ShaderMove<Uint8>(surf));
+					ShaderDraw<BodyXCOM2>(ShaderMove<Uint8>(surf));
 					surf->unlock();
 				}
+			}
+		}
+	}
+}
 
-				for (int i = 0; i < 2; ++i)
-				{
-					//fall frame (first and second)
-					Surface *surf = xcom_2->getFrame(256 + i);
-					surf->lock();
-
-					ShaderMove<Uint8> head = ShaderMove<Uint8>(surf);
-					GraphSubset dim = head.getBaseDomain();
-					dim.beg_y = 0;
-					if (j == 3)
-					{
-						dim.end_y = 11 + 5 * i;
-					}
-					else
-					{
-						dim.end_y = 17;
-					}
-					head.setDomain(dim);
-					ShaderDraw<FallXCOM2>(head);
+/**
+ * Loads a music that was registered to be loaded on demand,
+ * trying every format in order of preference.
+ * @param name Name of the music.
+ * @return Pointer to the new music, or NULL if it couldn't be loaded.
+ */
+Music *XcomResourcePack::createMusic(const std::string &name) const
+{
+	Music *music = 0;
+#ifndef __NO_MUSIC
+	const std::map<std::string, RuleMusic *> *musics = _ruleset->getMusic();
+	std::map<std::string, RuleMusic *>::const_iterator rule = musics->find(name);
+	if (rule == musics->end())
+	{
+		return 0;
+	}
 
-					//we change face to pink, to prevent mixup with ION armor backpack that have same color group.
-					ShaderDraw<FaceXCOM2>(ShaderMove<Uint8>(surf));
-					surf->unlock();
-				}
+	// Check which music version is available
+	CatFile *adlibcat = 0, *aintrocat = 0;
+	GMCatFile *gmcat = 0;
 
-				//Palette fix for ION armor
-				if (j == 2)
-				{
-					int size = xcom_2->getTotalFrames();
-					for (int i = 0; i < size; ++i)
-					{
-						Surface *surf = xcom_2->getFrame(i);
-						surf->lock();
-						ShaderDraw<BodyXCOM2>(ShaderMove<Uint8>(surf));
-						surf->unlock();
-					}
-				}
-			}
+	const std::set<std::string> &soundFiles(FileMap::getVFolderContents("SOUND"));
+	for (std::set<std::string>::iterator i = soundFiles.begin(); i != soundFiles.end(); ++i)
+	{
+		if (0 == i->compare("adlib.cat"))
+		{
+			adlibcat = new CatFile(FileMap::getFilePath("SOUND/" + *i).c_str());
+		}
+		else if (0 == i->compare("aintro.cat"))
+		{
+			aintrocat = new CatFile(FileMap::getFilePath("SOUND/" + *i).c_str());
 		}
+		else if (0 == i->compare("gm.cat"))
+		{
+			gmcat = new GMCatFile(FileMap::getFilePath("SOUND/" + *i).c_str());
+		}
+	}
+
+	// Try the preferred format first, otherwise use the default priority
+	MusicFormat priority[] = {Options::preferredMusic, MUSIC_FLAC, MUSIC_OGG, MUSIC_MP3, MUSIC_MOD, MUSIC_WAV, MUSIC_ADLIB, MUSIC_MIDI};
+	for (size_t j = 0; j < sizeof(priority)/sizeof(priority[0]) && music == 0; ++j)
+	{
+		music = loadMusic(priority[j], rule->first, rule->second->getCatPos(), rule->second->getNormalization(), adlibcat, aintrocat, gmcat);
 	}
+
+	delete gmcat;
+	delete adlibcat;
+	delete aintrocat;
+#endif
+	return music;
 }
 
 /**
@@ -1068,7 +1129,7 @@ bool XcomResourcePack::isImageFile(std::string extension)
  * @param gmcat Pointer to GM.CAT if available.
  * @return Pointer to the music file, or NULL if it couldn't be loaded.
  */
-Music *XcomResourcePack::loadMusic(MusicFormat fmt, const std::string &file, int track, float volume, CatFile *adlibcat, CatFile *aintrocat, GMCatFile *gmcat)
+Music *XcomResourcePack::loadMusic(MusicFormat fmt, const std::string &file, int track, float volume, CatFile *adlibcat, CatFile *aintrocat, GMCatFile *gmcat) const
 {
 	/* MUSIC_AUTO, MUSIC_FLAC, MUSIC_OGG, MUSIC_MP3, MUSIC_MOD, MUSIC_WAV, MUSIC_ADLIB, MUSIC_MIDI */
 	static const std::string exts[] = {"", ".flac", ".ogg", ".mp3", ".mod", ".wav", "", ".mid"};
@@ -1087,7 +1148,7 @@ Music *XcomResourcePack::loadMusic(MusicFormat fmt, const std::string &file, int
 				music = new AdlibMusic(volume);
 				if (track < adlibcat->getAmount())
 				{
-					music->load(adlibcat->load(track, true), adlibcat->getObjectSize(track));
+					music->load(adlibcat->load(track, true), adlibcat->getObjectSize(track, true));
 				}
 				// separate intro music
 				else if (aintrocat)
@@ -1095,7 +1156,7 @@ Music *XcomResourcePack::loadMusic(MusicFormat fmt, const std::string &file, int
 					track -= adlibcat->getAmount();
 					if (track < aintrocat->getAmount())
 					{
-						music->load(aintrocat->load(track, true), aintrocat->getObjectSize(track));
+						music->load(aintrocat->load(track, true), aintrocat->getObjectSize(track, true));
 					}
 					else
 					{
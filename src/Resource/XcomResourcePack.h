@@ -38,6 +38,15 @@ class XcomResourcePack : public ResourcePack
 {
 private:
 	Ruleset *_ruleset;
+	std::map<std::string, std::string> _unitSets;
+
+	/// Recolors parts of the soldier sprites.
+	void fixSoldierSprites(const std::string &name, SurfaceSet *set) const;
+protected:
+	/// Loads a surface set the first time it's needed.
+	SurfaceSet *createSurfaceSet(const std::string &name) const;
+	/// Loads a music the first time it's needed.
+	Music *createMusic(const std::string &name) const;
 public:
 	/// Creates the X-Com ruleset.
 	XcomResourcePack(Ruleset *rules);
@@ -48,7 +57,7 @@ public:
 	/// Checks if an extension is a valid image file.
 	bool isImageFile(std::string extension);
 	/// Loads a specified music file.
-	Music *loadMusic(MusicFormat fmt, const std::string &file, int track, float volume, CatFile *adlibcat, CatFile *aintrocat, GMCatFile *gmcat);
+	Music *loadMusic(MusicFormat fmt, const std::string &file, int track, float volume, CatFile *adlibcat, CatFile *aintrocat, GMCatFile *gmcat) const;
 	/// Creates a transparency lookup table for a given palette.
 	void createTransparencyLUT(Palette *pal);
 };
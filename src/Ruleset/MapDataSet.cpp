@@ -23,6 +23,7 @@
 #include <SDL_endian.h>
 #include "../Engine/Exception.h"
 #include "../Engine/SurfaceSet.h"
+#include "../Engine/SpriteAtlas.h"
 #include "../Engine/FileMap.h"
 
 namespace OpenXcom
@@ -34,7 +35,7 @@ MapData *MapDataSet::_scorchedTile = 0;
 /**
  * MapDataSet construction.
  */
-MapDataSet::MapDataSet(const std::string &name) : _name(name), _surfaceSet(0), _loaded(false)
+MapDataSet::MapDataSet(const std::string &name) : _name(name), _surfaceSet(0), _atlas(0), _loaded(false)
 {
 }
 
@@ -223,6 +224,8 @@ void MapDataSet::loadData()
 	_surfaceSet = new SurfaceSet(32, 40);
 	_surfaceSet->loadPck(FileMap::getFilePath("TERRAIN/" + _name + ".PCK"),
 			     FileMap::getFilePath("TERRAIN/" + _name + ".TAB"));
+	// pack them for the shaded blits of the battlescape
+	_atlas = new SpriteAtlas(_surfaceSet);
 }
 
 /**
@@ -237,6 +240,8 @@ void MapDataSet::unloadData()
 			delete *i;
 			i = _objects.erase(i);
 		}
+		delete _atlas;
+		_atlas = 0;
 		delete _surfaceSet;
 		_loaded = false;
 	}
@@ -29,6 +29,7 @@ namespace OpenXcom
 
 class MapData;
 class SurfaceSet;
+class SpriteAtlas;
 class ResourcePack;
 
 /**
@@ -43,6 +44,7 @@ private:
 	std::string _name;
 	std::vector<MapData*> _objects;
 	SurfaceSet *_surfaceSet;
+	SpriteAtlas *_atlas;
 	bool _loaded;
 	static MapData *_blankTile;
 	static MapData *_scorchedTile;
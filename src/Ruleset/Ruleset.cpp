@@ -49,6 +49,7 @@
 #include "RuleInterface.h"
 #include "SoundDefinition.h"
 #include "RuleMusic.h"
+#include "RulesetCache.h"
 #include "../Geoscape/Globe.h"
 #include "../Interface/TextButton.h"
 #include "../Interface/Window.h"
@@ -67,6 +68,7 @@
 #include "City.h"
 #include "MCDPatch.h"
 #include "../Engine/Logger.h"
+#include "../Engine/ThreadPool.h"
 #include "../Ufopaedia/Ufopaedia.h"
 #include "StatString.h"
 #include "RuleGlobe.h"
@@ -266,25 +268,93 @@ Ruleset::~Ruleset()
 	}
 }
 
-void Ruleset::loadModRulesets(const std::vector<std::string> &rulesetFiles, size_t modIdx)
+namespace
+{
+
+/**
+ * Parses one ruleset file per item.
+ */
+class ParseRulesetJob : public ThreadJob
+{
+	std::vector<RulesetFile> &_files;
+	RulesetCache *_cache;
+public:
+	ParseRulesetJob(std::vector<RulesetFile> &files, RulesetCache *cache) : _files(files), _cache(cache) {}
+	void run(int index)
+	{
+		RulesetFile &file = _files[index];
+		Uint32 start = SDL_GetTicks();
+		try
+		{
+			file.doc = (_cache != 0) ? _cache->load(file.path) : YAML::LoadFile(file.path);
+		}
+		catch (YAML::Exception &e)
+		{
+			file.failed = true;
+			file.errorMark = e.mark;
+			file.error = e.msg;
+		}
+		file.parseTime = SDL_GetTicks() - start;
+	}
+};
+
+}
+
+/**
+ * Parses all the ruleset files on the thread pool, since
+ * that's most of the loading time. Errors are kept with
+ * each file until the mod it belongs to gets loaded.
+ * @param files Ruleset files to parse.
+ * @param cache Cache of parsed files to load from, if any.
+ */
+void Ruleset::parseFiles(std::vector<RulesetFile> &files, RulesetCache *cache)
+{
+	ParseRulesetJob job(files, cache);
+	ThreadPool::get()->run(&job, files.size());
+}
+
+/**
+ * Loads the parsed ruleset files of a mod, in the order they were listed.
+ * @param files Parsed ruleset files of every mod.
+ * @param modIdx Index of the mod to load.
+ */
+void Ruleset::loadModRulesets(const std::vector<RulesetFile> &files, size_t modIdx)
 {
 	size_t spriteOffset = 1000 * modIdx;
 
-	for (std::vector<std::string>::const_iterator i = rulesetFiles.begin(); i != rulesetFiles.end(); ++i)
+	for (std::vector<RulesetFile>::const_iterator i = files.begin(); i != files.end(); ++i)
 	{
-		Log(LOG_INFO) << "- " << *i;
-		loadFile(*i, spriteOffset);
+		if (i->mod != modIdx)
+		{
+			continue;
+		}
+		if (i->failed)
+		{
+			Log(LOG_ERROR) << "- " << i->path << ": " << i->error;
+			throw YAML::Exception(i->errorMark, i->error);
+		}
+		Uint32 start = SDL_GetTicks();
+		try
+		{
+			loadFile(i->doc, spriteOffset);
+		}
+		catch (YAML::Exception &e)
+		{
+			Log(LOG_ERROR) << "- " << i->path << ": " << e.what();
+			throw;
+		}
+		Log(LOG_INFO) << "- " << i->path << " (parsed in " << i->parseTime << "ms, loaded in " << SDL_GetTicks() - start << "ms)";
 	}
 }
 
 /**
- * Loads a ruleset's contents from a YAML file.
+ * Loads a ruleset's contents from a YAML document.
  * Rules that match pre-existing rules overwrite them.
- * @param filename YAML filename.
+ * @param doc YAML document of a ruleset file.
+ * @param spriteOffset Offset for the mod's sprite and sound indexes.
  */
-void Ruleset::loadFile(const std::string &filename, size_t spriteOffset)
+void Ruleset::loadFile(const YAML::Node &doc, size_t spriteOffset)
 {
-	YAML::Node doc = YAML::LoadFile(filename);
 
 	for (YAML::const_iterator i = doc["countries"].begin(); i != doc["countries"].end(); ++i)
 	{
@@ -66,6 +66,23 @@ class SoundDefinition;
 class MapScript;
 class RuleVideo;
 class RuleMusic;
+class RulesetCache;
+
+/**
+ * A ruleset file that has been parsed and is waiting
+ * to be loaded into the ruleset, or the error it failed with.
+ */
+struct RulesetFile
+{
+	std::string path;
+	size_t mod;
+	YAML::Node doc;
+	bool failed;
+	YAML::Mark errorMark;
+	std::string error;
+	Uint32 parseTime;
+	RulesetFile(const std::string &path_, size_t mod_) : path(path_), mod(mod_), failed(false), parseTime(0) {}
+};
 
 /**
  * Set of rules and stats for a game.
@@ -121,8 +138,8 @@ protected:
 	std::vector<SDL_Color> _transparencies;
 	int _facilityListOrder, _craftListOrder, _itemListOrder, _researchListOrder,  _manufactureListOrder, _ufopaediaListOrder, _invListOrder;
 	std::vector<std::string> _psiRequirements; // it's a cache for psiStrengthEval
-	/// Loads a ruleset from a YAML file.
-	void loadFile(const std::string &filename, size_t spriteOffset);
+	/// Loads a ruleset from a YAML document.
+	void loadFile(const YAML::Node &doc, size_t spriteOffset);
 	/// Loads a ruleset element.
 	template <typename T>
 	T *loadRule(const YAML::Node &node, std::map<std::string, T*> *map, std::vector<std::string> *index = 0, const std::string &key = "type");
@@ -133,9 +150,11 @@ public:
 	Ruleset();
 	/// Cleans up the ruleset.
 	~Ruleset();
-	/// Loads a list of rulesets from YAML files for the mod at the specified index.  The first
+	/// Parses a list of ruleset files at the same time.
+	static void parseFiles(std::vector<RulesetFile> &files, RulesetCache *cache);
+	/// Loads the parsed rulesets for the mod at the specified index.  The first
 	// mod loaded should be the master at index 0, then 1, and so on.
-	void loadModRulesets(const std::vector<std::string> &rulesetFiles, size_t modIdx);
+	void loadModRulesets(const std::vector<RulesetFile> &files, size_t modIdx);
 	/// Generates the starting saved game.
 	SavedGame *newSave() const;
 	/// Gets the pool list for soldier names.
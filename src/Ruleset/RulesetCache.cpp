@@ -0,0 +1,339 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "RulesetCache.h"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include "../Engine/CrossPlatform.h"
+#include "../Engine/Exception.h"
+#include "../Engine/Logger.h"
+
+namespace OpenXcom
+{
+
+namespace
+{
+
+/// Marks the start of a cache file.
+const char MAGIC[8] = {'O', 'X', 'R', 'U', 'L', 'E', 'S', '\0'};
+/// Bump whenever the cache format changes.
+const Uint32 VERSION = 1;
+
+/// Node types in the cache format.
+enum CacheNode { CACHE_NULL, CACHE_SCALAR, CACHE_SEQUENCE, CACHE_MAP };
+
+void write32(std::string &data, Uint32 value)
+{
+	data.append((const char*)&value, sizeof(value));
+}
+
+void write64(std::string &data, Uint64 value)
+{
+	data.append((const char*)&value, sizeof(value));
+}
+
+void writeString(std::string &data, const std::string &s)
+{
+	write32(data, s.size());
+	data.append(s);
+}
+
+void read(const char *&data, const char *end, void *value, size_t size)
+{
+	if ((size_t)(end - data) < size)
+	{
+		throw Exception("ruleset cache is truncated");
+	}
+	memcpy(value, data, size);
+	data += size;
+}
+
+Uint32 read32(const char *&data, const char *end)
+{
+	Uint32 value;
+	read(data, end, &value, sizeof(value));
+	return value;
+}
+
+Uint64 read64(const char *&data, const char *end)
+{
+	Uint64 value;
+	read(data, end, &value, sizeof(value));
+	return value;
+}
+
+std::string readString(const char *&data, const char *end)
+{
+	Uint32 size = read32(data, end);
+	if ((size_t)(end - data) < size)
+	{
+		throw Exception("ruleset cache is truncated");
+	}
+	std::string s(data, size);
+	data += size;
+	return s;
+}
+
+/**
+ * Hashes the contents of a file (64-bit FNV-1a).
+ * @param s File contents.
+ * @return Hash value.
+ */
+Uint64 hash(const std::string &s)
+{
+	Uint64 h = 14695981039346656037ULL;
+	for (std::string::const_iterator i = s.begin(); i != s.end(); ++i)
+	{
+		h ^= (Uint8)*i;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+}
+
+/**
+ * Reads the cached files from a previous run.
+ * A missing or unreadable cache just starts out empty.
+ * @param path Full path to the cache file.
+ */
+RulesetCache::RulesetCache(const std::string &path) : _path(path), _changed(false)
+{
+	_mutex = SDL_CreateMutex();
+	std::ifstream file(_path.c_str(), std::ios::in | std::ios::binary);
+	if (!file)
+	{
+		return;
+	}
+	std::stringstream ss;
+	ss << file.rdbuf();
+	std::string contents = ss.str();
+	const char *data = contents.data(), *end = data + contents.size();
+	try
+	{
+		char magic[sizeof(MAGIC)];
+		read(data, end, magic, sizeof(magic));
+		if (memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || read32(data, end) != VERSION)
+		{
+			return;
+		}
+		Uint32 count = read32(data, end);
+		for (Uint32 i = 0; i < count; ++i)
+		{
+			std::string filename = readString(data, end);
+			Entry &entry = _old[filename];
+			entry.size = read64(data, end);
+			entry.date = read64(data, end);
+			entry.hash = read64(data, end);
+			entry.data = readString(data, end);
+		}
+	}
+	catch (Exception &e)
+	{
+		Log(LOG_WARNING) << _path << ": " << e.what();
+		_old.clear();
+	}
+}
+
+/**
+ *
+ */
+RulesetCache::~RulesetCache()
+{
+	SDL_DestroyMutex(_mutex);
+}
+
+/**
+ * Writes a YAML node and all its children to the end of a buffer.
+ * @param node YAML node.
+ * @param data Buffer to write to.
+ */
+void RulesetCache::encode(const YAML::Node &node, std::string &data)
+{
+	switch (node.Type())
+	{
+	case YAML::NodeType::Scalar:
+		data.push_back(CACHE_SCALAR);
+		writeString(data, node.Scalar());
+		break;
+	case YAML::NodeType::Sequence:
+		data.push_back(CACHE_SEQUENCE);
+		write32(data, node.size());
+		for (YAML::const_iterator i = node.begin(); i != node.end(); ++i)
+		{
+			encode(*i, data);
+		}
+		break;
+	case YAML::NodeType::Map:
+		data.push_back(CACHE_MAP);
+		write32(data, node.size());
+		for (YAML::const_iterator i = node.begin(); i != node.end(); ++i)
+		{
+			encode(i->first, data);
+			encode(i->second, data);
+		}
+		break;
+	default:
+		data.push_back(CACHE_NULL);
+		break;
+	}
+}
+
+/**
+ * Reads a YAML node and all its children from a buffer.
+ * @param data Position in the buffer, moved past the node.
+ * @param end End of the buffer.
+ * @return YAML node.
+ */
+YAML::Node RulesetCache::decode(const char *&data, const char *end)
+{
+	char type;
+	read(data, end, &type, sizeof(type));
+	switch (type)
+	{
+	case CACHE_NULL:
+		return YAML::Node();
+	case CACHE_SCALAR:
+		return YAML::Node(readString(data, end));
+	case CACHE_SEQUENCE:
+		{
+			YAML::Node node(YAML::NodeType::Sequence);
+			Uint32 size = read32(data, end);
+			for (Uint32 i = 0; i < size; ++i)
+			{
+				node.push_back(decode(data, end));
+			}
+			return node;
+		}
+	case CACHE_MAP:
+		{
+			YAML::Node node(YAML::NodeType::Map);
+			Uint32 size = read32(data, end);
+			for (Uint32 i = 0; i < size; ++i)
+			{
+				YAML::Node key = decode(data, end);
+				node[key] = decode(data, end);
+			}
+			return node;
+		}
+	default:
+		throw Exception("ruleset cache is corrupted");
+	}
+}
+
+/**
+ * Loads the YAML document in a ruleset file. If the file
+ * hasn't changed since it was cached, it's read straight
+ * from the cache instead of being parsed again.
+ * @param filename Full path to the ruleset file.
+ * @return YAML document.
+ */
+YAML::Node RulesetCache::load(const std::string &filename)
+{
+	std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!file)
+	{
+		// let yaml-cpp report it as usual
+		return YAML::LoadFile(filename);
+	}
+	std::stringstream ss;
+	ss << file.rdbuf();
+	std::string contents = ss.str();
+
+	Entry entry;
+	entry.size = contents.size();
+	entry.date = CrossPlatform::getDateModified(filename);
+	entry.hash = hash(contents);
+
+	std::map<std::string, Entry>::const_iterator cached = _old.find(filename);
+	if (cached != _old.end() &&
+		cached->second.size == entry.size &&
+		cached->second.date == entry.date &&
+		cached->second.hash == entry.hash)
+	{
+		const char *data = cached->second.data.data(), *end = data + cached->second.data.size();
+		try
+		{
+			YAML::Node doc = decode(data, end);
+			if (data == end)
+			{
+				SDL_mutexP(_mutex);
+				_new[filename] = cached->second;
+				SDL_mutexV(_mutex);
+				return doc;
+			}
+		}
+		catch (Exception &e)
+		{
+			SDL_mutexP(_mutex);
+			Log(LOG_WARNING) << _path << ": " << e.what();
+			SDL_mutexV(_mutex);
+		}
+	}
+
+	YAML::Node doc = YAML::Load(contents);
+	encode(doc, entry.data);
+	SDL_mutexP(_mutex);
+	_new[filename] = entry;
+	_changed = true;
+	SDL_mutexV(_mutex);
+	return doc;
+}
+
+/**
+ * Writes the files loaded this run to the cache file,
+ * dropping any that weren't used. Nothing is written
+ * if they all came from the cache already.
+ */
+void RulesetCache::save()
+{
+	if (!_changed && _new.size() == _old.size())
+	{
+		return;
+	}
+	std::string data(MAGIC, sizeof(MAGIC));
+	write32(data, VERSION);
+	write32(data, _new.size());
+	for (std::map<std::string, Entry>::const_iterator i = _new.begin(); i != _new.end(); ++i)
+	{
+		writeString(data, i->first);
+		write64(data, i->second.size);
+		write64(data, i->second.date);
+		write64(data, i->second.hash);
+		writeString(data, i->second.data);
+	}
+
+	// write to a temporary file first so a crash can't leave half a cache behind
+	std::string tmp = _path + ".tmp";
+	std::ofstream file(tmp.c_str(), std::ios::out | std::ios::binary);
+	if (!file)
+	{
+		Log(LOG_WARNING) << "Failed to save " << _path;
+		return;
+	}
+	file.write(data.data(), data.size());
+	file.close();
+	if (!file || !CrossPlatform::moveFile(tmp, _path))
+	{
+		Log(LOG_WARNING) << "Failed to save " << _path;
+		CrossPlatform::deleteFile(tmp);
+	}
+}
+
+}
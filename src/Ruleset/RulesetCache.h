@@ -0,0 +1,69 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_RULESETCACHE_H
+#define OPENXCOM_RULESETCACHE_H
+
+#include <yaml-cpp/yaml.h>
+#include <SDL_types.h>
+#include <SDL_mutex.h>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace OpenXcom
+{
+
+/**
+ * Keeps the parsed ruleset files in a binary file between runs,
+ * so unchanged files don't have to go through the YAML parser again.
+ * Each file is stored along with its size, modified date and a hash
+ * of its contents, and is parsed as usual if any of them changed.
+ * Files can be loaded from several threads at once.
+ */
+class RulesetCache
+{
+private:
+	struct Entry
+	{
+		Uint64 size, date, hash;
+		std::string data;
+	};
+	std::string _path;
+	std::map<std::string, Entry> _old, _new;
+	bool _changed;
+	SDL_mutex *_mutex;
+
+	/// Encodes a YAML node into the cache format.
+	static void encode(const YAML::Node &node, std::string &data);
+	/// Decodes a YAML node from the cache format.
+	static YAML::Node decode(const char *&data, const char *end);
+public:
+	/// Loads the cache from a file.
+	RulesetCache(const std::string &path);
+	/// Cleans up the cache.
+	~RulesetCache();
+	/// Loads a ruleset file, from the cache if possible.
+	YAML::Node load(const std::string &filename);
+	/// Saves the cache to its file.
+	void save();
+};
+
+}
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "AreaGrid.h"
+#include <cmath>
+#include "../fmath.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Creates a grid with no areas in it.
+ */
+AreaGrid::AreaGrid() : _cells(COLUMNS * ROWS), _areas(0)
+{
+}
+
+/**
+ *
+ */
+AreaGrid::~AreaGrid()
+{
+}
+
+/**
+ * Gets the column of the grid holding a longitude.
+ * @param lon Longitude in radians, wrapped around if needed.
+ * @return Column index.
+ */
+int AreaGrid::getColumn(double lon)
+{
+	int column = (int)floor(lon / (2 * M_PI) * COLUMNS) % COLUMNS;
+	return column < 0 ? column + COLUMNS : column;
+}
+
+/**
+ * Gets the row of the grid holding a latitude.
+ * @param lat Latitude in radians.
+ * @return Row index.
+ */
+int AreaGrid::getRow(double lat)
+{
+	int row = (int)floor((lat / M_PI + 0.5) * ROWS);
+	if (row < 0)
+		return 0;
+	if (row >= ROWS)
+		return ROWS - 1;
+	return row;
+}
+
+/**
+ * Adds an area to every cell its rectangles reach, the same
+ * way RuleRegion and RuleCountry read them: a minimum longitude
+ * above the maximum wraps around the 0 meridian.
+ * @param lonMin Minimum longitude of each rectangle.
+ * @param lonMax Maximum longitude of each rectangle.
+ * @param latMin Minimum latitude of each rectangle.
+ * @param latMax Maximum latitude of each rectangle.
+ */
+void AreaGrid::add(const std::vector<double> &lonMin, const std::vector<double> &lonMax, const std::vector<double> &latMin, const std::vector<double> &latMax)
+{
+	for (size_t i = 0; i < lonMin.size(); ++i)
+	{
+		int first = getColumn(lonMin[i]);
+		int last = getColumn(lonMax[i]);
+		int columns;
+		if (lonMin[i] <= lonMax[i])
+		{
+			// a rectangle can span the whole globe, and then both ends land in the same column
+			columns = (lonMax[i] - lonMin[i] >= 2 * M_PI - 2 * M_PI / COLUMNS) ? COLUMNS : (last - first + COLUMNS) % COLUMNS + 1;
+		}
+		else
+		{
+			columns = (last - first + COLUMNS) % COLUMNS + 1;
+		}
+		for (int row = getRow(latMin[i]); row <= getRow(latMax[i]); ++row)
+		{
+			for (int c = 0; c < columns; ++c)
+			{
+				std::vector<int> &cell = _cells[row * COLUMNS + (first + c) % COLUMNS];
+				if (cell.empty() || cell.back() != _areas)
+				{
+					cell.push_back(_areas);
+				}
+			}
+		}
+	}
+	_areas++;
+}
+
+/**
+ * Gets the number of areas added to the grid.
+ * @return Number of areas.
+ */
+int AreaGrid::getAreas() const
+{
+	return _areas;
+}
+
+/**
+ * Gets the areas with a rectangle reaching the cell of a point,
+ * in the order they were added. They still need checking
+ * against the point itself.
+ * @param lon Longitude of the point.
+ * @param lat Latitude of the point.
+ * @return List of area indexes.
+ */
+const std::vector<int> &AreaGrid::getCandidates(double lon, double lat) const
+{
+	return _cells[getRow(lat) * COLUMNS + getColumn(lon)];
+}
+
+}
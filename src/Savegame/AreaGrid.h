@@ -0,0 +1,63 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_AREAGRID_H
+#define OPENXCOM_AREAGRID_H
+
+#include <vector>
+
+namespace OpenXcom
+{
+
+/**
+ * Sorts the longitude/latitude rectangles of regions or countries
+ * into a grid of cells, so finding the ones holding a point only
+ * has to check the few that reach its cell.
+ * Areas are kept in the order they were added.
+ */
+class AreaGrid
+{
+public:
+	/// Number of cells around the globe.
+	static const int COLUMNS = 180;
+	/// Number of cells from pole to pole.
+	static const int ROWS = 90;
+private:
+	std::vector<std::vector<int> > _cells;
+	int _areas;
+
+	/// Gets the column of a longitude.
+	static int getColumn(double lon);
+	/// Gets the row of a latitude.
+	static int getRow(double lat);
+public:
+	/// Creates an empty grid.
+	AreaGrid();
+	/// Cleans up the grid.
+	~AreaGrid();
+	/// Adds an area made of rectangles.
+	void add(const std::vector<double> &lonMin, const std::vector<double> &lonMax, const std::vector<double> &latMin, const std::vector<double> &latMax);
+	/// Gets the number of areas added.
+	int getAreas() const;
+	/// Gets the areas that might hold a point.
+	const std::vector<int> &getCandidates(double lon, double lat) const;
+};
+
+}
+
+#endif
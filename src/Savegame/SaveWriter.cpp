@@ -0,0 +1,228 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "SaveWriter.h"
+#include <fstream>
+#include <SDL_timer.h>
+#include "../Engine/Exception.h"
+#include "../Engine/Options.h"
+#include "../Engine/CrossPlatform.h"
+
+namespace OpenXcom
+{
+
+/**
+ * Creates a writer for a save file, to be filled with
+ * the game's documents before it's started.
+ * @param filename Save filename, relative to the user folder.
+ */
+SaveWriter::SaveWriter(const std::string &filename) : _filename(filename), _thread(0), _chunks(0), _written(0), _done(false), _start(SDL_GetTicks()), _snapshotTime(0), _writeTime(0)
+{
+	_mutex = SDL_CreateMutex();
+}
+
+/**
+ * Waits for the save file to be written, so it's never
+ * cut short, and cleans up the writer.
+ */
+SaveWriter::~SaveWriter()
+{
+	if (_thread != 0)
+	{
+		SDL_WaitThread(_thread, 0);
+	}
+	SDL_DestroyMutex(_mutex);
+}
+
+/**
+ * Adds a document to the end of the save file. Each entry
+ * of a top-level map is written as a separate chunk.
+ * @param doc YAML document.
+ */
+void SaveWriter::addDocument(const YAML::Node &doc)
+{
+	_docs.push_back(doc);
+	_chunks += doc.IsMap() ? doc.size() : 1;
+}
+
+/**
+ * Starts writing the save file on another thread.
+ * The documents must not be touched anymore after this.
+ */
+void SaveWriter::start()
+{
+	_snapshotTime = SDL_GetTicks() - _start;
+	_thread = SDL_CreateThread(run, (void*)this);
+	if (_thread == 0)
+	{
+		write();
+	}
+}
+
+/**
+ * Writes the save file on the writer thread.
+ * @param data Pointer to the writer.
+ * @return Thread exit code.
+ */
+int SaveWriter::run(void *data)
+{
+	((SaveWriter*)data)->write();
+	return 0;
+}
+
+/**
+ * Emits the documents straight into a temporary file, then
+ * moves it over the save file. Any errors are kept until
+ * the writer is finished.
+ */
+void SaveWriter::write()
+{
+	Uint32 start = SDL_GetTicks();
+	std::string path = Options::getUserFolder() + _filename;
+	std::string backup = _filename + ".bak";
+	std::string error;
+	try
+	{
+		std::ofstream sav((path + ".bak").c_str());
+		if (!sav)
+		{
+			throw Exception("Failed to save " + backup);
+		}
+
+		YAML::Emitter out(sav);
+		for (std::vector<YAML::Node>::const_iterator i = _docs.begin(); i != _docs.end(); ++i)
+		{
+			if (i != _docs.begin())
+			{
+				out << YAML::BeginDoc;
+			}
+			if (i->IsMap())
+			{
+				out << YAML::BeginMap;
+				for (YAML::const_iterator j = i->begin(); j != i->end(); ++j)
+				{
+					out << YAML::Key << j->first << YAML::Value << j->second;
+					advance();
+				}
+				out << YAML::EndMap;
+			}
+			else
+			{
+				out << *i;
+				advance();
+			}
+		}
+		sav.close();
+		if (!out.good() || !sav)
+		{
+			throw Exception("Failed to save " + backup);
+		}
+		if (!CrossPlatform::moveFile(path + ".bak", path))
+		{
+			throw Exception("Save backed up in " + backup);
+		}
+	}
+	catch (Exception &e)
+	{
+		error = e.what();
+	}
+	catch (YAML::Exception &e)
+	{
+		error = e.what();
+	}
+
+	SDL_mutexP(_mutex);
+	_error = error;
+	_writeTime = SDL_GetTicks() - start;
+	_done = true;
+	SDL_mutexV(_mutex);
+}
+
+/**
+ * Marks another chunk of the save file as written.
+ */
+void SaveWriter::advance()
+{
+	SDL_mutexP(_mutex);
+	_written++;
+	SDL_mutexV(_mutex);
+}
+
+/**
+ * Waits for the save file to be written.
+ * @throws Exception if the save file couldn't be written.
+ */
+void SaveWriter::finish()
+{
+	if (_thread != 0)
+	{
+		SDL_WaitThread(_thread, 0);
+		_thread = 0;
+	}
+	if (!_error.empty())
+	{
+		throw Exception(_error);
+	}
+}
+
+/**
+ * Returns whether the save file is done writing,
+ * successfully or not.
+ * @return True if it's done.
+ */
+bool SaveWriter::isDone() const
+{
+	SDL_mutexP(_mutex);
+	bool done = _done;
+	SDL_mutexV(_mutex);
+	return done;
+}
+
+/**
+ * Returns how much of the save file is written so far.
+ * @return Progress percentage.
+ */
+int SaveWriter::getProgress() const
+{
+	SDL_mutexP(_mutex);
+	int progress = (_chunks == 0) ? 100 : (int)(_written * 100 / _chunks);
+	SDL_mutexV(_mutex);
+	return progress;
+}
+
+/**
+ * Returns how long it took to turn the game into documents,
+ * from the writer's creation until it was started.
+ * @return Time in milliseconds.
+ */
+Uint32 SaveWriter::getSnapshotTime() const
+{
+	return _snapshotTime;
+}
+
+/**
+ * Returns how long it took to write the save file,
+ * once it's done.
+ * @return Time in milliseconds.
+ */
+Uint32 SaveWriter::getWriteTime() const
+{
+	return _writeTime;
+}
+
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2010-2015 OpenXcom Developers.
+ *
+ * This file is part of OpenXcom.
+ *
+ * OpenXcom is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OpenXcom is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef OPENXCOM_SAVEWRITER_H
+#define OPENXCOM_SAVEWRITER_H
+
+#include <yaml-cpp/yaml.h>
+#include <SDL_types.h>
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+#include <string>
+#include <vector>
+
+namespace OpenXcom
+{
+
+/**
+ * Writes a save file from a snapshot of the game.
+ * The game is first turned into YAML documents on the main thread,
+ * which no longer depend on the game objects, so they can be emitted
+ * on another thread while the game keeps running. The file is streamed
+ * to disk one top-level entry at a time into a temporary file, which
+ * then replaces the old save so it's never left half-written.
+ */
+class SaveWriter
+{
+private:
+	std::string _filename, _error;
+	std::vector<YAML::Node> _docs;
+	SDL_Thread *_thread;
+	SDL_mutex *_mutex;
+	size_t _chunks, _written;
+	bool _done;
+	Uint32 _start, _snapshotTime, _writeTime;
+
+	/// Writes the save file on the writer thread.
+	static int run(void *data);
+	/// Marks another chunk as written.
+	void advance();
+public:
+	/// Creates a writer for a save file.
+	SaveWriter(const std::string &filename);
+	/// Waits for the writer and cleans up.
+	~SaveWriter();
+	/// Adds a document to the save file.
+	void addDocument(const YAML::Node &doc);
+	/// Starts writing the save file on another thread.
+	void start();
+	/// Writes the save file.
+	void write();
+	/// Waits for the save file to be written.
+	void finish();
+	/// Checks if the save file is written.
+	bool isDone() const;
+	/// Gets how much of the save file is written.
+	int getProgress() const;
+	/// Gets how long it took to snapshot the game.
+	Uint32 getSnapshotTime() const;
+	/// Gets how long it took to write the save file.
+	Uint32 getWriteTime() const;
+};
+
+}
+
+#endif
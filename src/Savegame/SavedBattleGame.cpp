@@ -1326,6 +1326,7 @@ void SavedBattleGame::prepareNewTurn()
 						}
 					}
 				}
+				getTileEngine()->markTerrainChanged((*i)->getPosition());
 				getTileEngine()->applyGravity(*i);
 			}
 		}
@@ -17,7 +17,6 @@
  * along with OpenXcom.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "SavedGame.h"
-#include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
@@ -32,6 +31,7 @@
 #include "../Engine/CrossPlatform.h"
 #include "../Engine/FileMap.h"
 #include "SavedBattleGame.h"
+#include "SaveWriter.h"
 #include "SerializationHelper.h"
 #include "GameTime.h"
 #include "Country.h"
@@ -52,6 +52,8 @@
 #include "AlienStrategy.h"
 #include "AlienMission.h"
 #include "../Ruleset/RuleRegion.h"
+#include "../Ruleset/RuleCountry.h"
+#include "AreaGrid.h"
 
 namespace OpenXcom
 {
@@ -97,7 +99,7 @@ bool equalProduction::operator()(const Production * p) const
 /**
  * Initializes a brand new saved game according to the specified difficulty.
  */
-SavedGame::SavedGame() : _difficulty(DIFF_BEGINNER), _ironman(false), _globeLon(0.0), _globeLat(0.0), _globeZoom(0), _battleGame(0), _debug(false), _warned(false), _monthsPassed(-1), _selectedBase(0)
+SavedGame::SavedGame() : _difficulty(DIFF_BEGINNER), _ironman(false), _globeLon(0.0), _globeLat(0.0), _globeZoom(0), _regionGrid(0), _countryGrid(0), _battleGame(0), _debug(false), _warned(false), _monthsPassed(-1), _selectedBase(0)
 {
 	_time = new GameTime(6, 1, 1, 1999, 12, 0, 0);
 	_alienStrategy = new AlienStrategy();
@@ -123,6 +125,8 @@ SavedGame::~SavedGame()
 	{
 		delete *i;
 	}
+	delete _regionGrid;
+	delete _countryGrid;
 	for (std::vector<Base*>::iterator i = _bases.begin(); i != _bases.end(); ++i)
 	{
 		delete *i;
@@ -496,15 +500,19 @@ void SavedGame::load(const std::string &filename, Ruleset *rule)
  */
 void SavedGame::save(const std::string &filename) const
 {
-	std::string s = Options::getUserFolder() + filename;
-	std::ofstream sav(s.c_str());
-	if (!sav)
-	{
-		throw Exception("Failed to save " + filename);
-	}
-
-	YAML::Emitter out;
+	SaveWriter writer(filename);
+	save(&writer);
+	writer.write();
+	writer.finish();
+}
 
+/**
+ * Saves a snapshot of the saved game's contents into a writer,
+ * which can then write it to a YAML file in the background.
+ * @param writer Save file writer.
+ */
+void SavedGame::save(SaveWriter *writer) const
+{
 	// Saves the brief game info used in the saves list
 	YAML::Node brief;
 	brief["name"] = Language::wstrToUtf8(_name);
@@ -528,9 +536,8 @@ void SavedGame::save(const std::string &filename) const
 	brief["mods"] = activeMods;
 	if (_ironman)
 		brief["ironman"] = _ironman;
-	out << brief;
+	writer->addDocument(brief);
 	// Saves the full game data to the save
-	out << YAML::BeginDoc;
 	YAML::Node node;
 	node["difficulty"] = (int)_difficulty;
 	node["monthsPassed"] = _monthsPassed;
@@ -600,9 +607,7 @@ void SavedGame::save(const std::string &filename) const
 	{
 		node["battleGame"] = _battleGame->save();
 	}
-	out << node;
-	sav << out.c_str();
-	sav.close();
+	writer->addDocument(node);
 }
 
 /**
@@ -1636,32 +1641,33 @@ void SavedGame::setWarned(bool warned)
 	_warned = warned;
 }
 
-/** @brief Check if a point is contained in a region.
- * This function object checks if a point is contained inside a region.
- */
-class ContainsPoint: public std::unary_function<const Region *, bool>
-{
-public:
-	/// Remember the coordinates.
-	ContainsPoint(double lon, double lat) : _lon(lon), _lat(lat) { /* Empty by design. */ }
-	/// Check is the region contains the stored point.
-	bool operator()(const Region *region) const { return region->getRules()->insideRegion(_lon, _lat); }
-private:
-	double _lon, _lat;
-};
-
 /**
  * Find the region containing this location.
+ * The regions are sorted into a grid the first time, and again
+ * whenever the list of regions changes.
  * @param lon The longtitude.
  * @param lat The latitude.
  * @return Pointer to the region, or 0.
  */
 Region *SavedGame::locateRegion(double lon, double lat) const
 {
-	std::vector<Region *>::const_iterator found = std::find_if (_regions.begin(), _regions.end(), ContainsPoint(lon, lat));
-	if (found != _regions.end())
+	if (!_regionGrid || _regionGrid->getAreas() != (int)_regions.size())
+	{
+		delete _regionGrid;
+		_regionGrid = new AreaGrid();
+		for (std::vector<Region*>::const_iterator i = _regions.begin(); i != _regions.end(); ++i)
+		{
+			const RuleRegion *rule = (*i)->getRules();
+			_regionGrid->add(rule->getLonMin(), rule->getLonMax(), rule->getLatMin(), rule->getLatMax());
+		}
+	}
+	const std::vector<int> &candidates = _regionGrid->getCandidates(lon, lat);
+	for (std::vector<int>::const_iterator i = candidates.begin(); i != candidates.end(); ++i)
 	{
-		return *found;
+		if (_regions[*i]->getRules()->insideRegion(lon, lat))
+		{
+			return _regions[*i];
+		}
 	}
 	return 0;
 }
@@ -1676,6 +1682,46 @@ Region *SavedGame::locateRegion(const Target &target) const
 	return locateRegion(target.getLongitude(), target.getLatitude());
 }
 
+/**
+ * Find the country containing this location.
+ * Works like locateRegion.
+ * @param lon The longtitude.
+ * @param lat The latitude.
+ * @return Pointer to the country, or 0.
+ */
+Country *SavedGame::locateCountry(double lon, double lat) const
+{
+	if (!_countryGrid || _countryGrid->getAreas() != (int)_countries.size())
+	{
+		delete _countryGrid;
+		_countryGrid = new AreaGrid();
+		for (std::vector<Country*>::const_iterator i = _countries.begin(); i != _countries.end(); ++i)
+		{
+			const RuleCountry *rule = (*i)->getRules();
+			_countryGrid->add(rule->getLonMin(), rule->getLonMax(), rule->getLatMin(), rule->getLatMax());
+		}
+	}
+	const std::vector<int> &candidates = _countryGrid->getCandidates(lon, lat);
+	for (std::vector<int>::const_iterator i = candidates.begin(); i != candidates.end(); ++i)
+	{
+		if (_countries[*i]->getRules()->insideCountry(lon, lat))
+		{
+			return _countries[*i];
+		}
+	}
+	return 0;
+}
+
+/**
+ * Find the country containing this target.
+ * @param target The target to locate.
+ * @return Pointer to the country, or 0.
+ */
+Country *SavedGame::locateCountry(const Target &target) const
+{
+	return locateCountry(target.getLongitude(), target.getLatitude());
+}
+
 /*
  * @return the month counter.
  */
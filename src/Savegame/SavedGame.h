@@ -38,6 +38,7 @@ class Region;
 class Ufo;
 class Waypoint;
 class SavedBattleGame;
+class SaveWriter;
 class TextList;
 class Language;
 class RuleResearch;
@@ -51,6 +52,7 @@ class AlienMission;
 class Target;
 class Soldier;
 class Craft;
+class AreaGrid;
 
 /**
  *Enumerator containing all the possible game difficulties.
@@ -103,6 +105,7 @@ private:
 	std::map<std::string, int> _ids;
 	std::vector<Country*> _countries;
 	std::vector<Region*> _regions;
+	mutable AreaGrid *_regionGrid, *_countryGrid;
 	std::vector<Base*> _bases;
 	std::vector<Ufo*> _ufos;
 	std::vector<Waypoint*> _waypoints;
@@ -137,6 +140,8 @@ public:
 	void load(const std::string &filename, Ruleset *rule);
 	/// Saves a saved game to YAML.
 	void save(const std::string &filename) const;
+	/// Saves a snapshot of the saved game for writing.
+	void save(SaveWriter *writer) const;
 	/// Gets the game name.
 	std::wstring getName() const;
 	/// Sets the game name.
@@ -259,6 +264,10 @@ public:
 	Region *locateRegion(double lon, double lat) const;
 	/// Locate a region containing a Target.
 	Region *locateRegion(const Target &target) const;
+	/// Locate a country containing a position.
+	Country *locateCountry(double lon, double lat) const;
+	/// Locate a country containing a Target.
+	Country *locateCountry(const Target &target) const;
 	/// Return the month counter.
 	int getMonthsPassed() const;
 	/// Return the GraphRegionToggles.
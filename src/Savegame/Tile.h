@@ -149,6 +149,17 @@ public:
 		return (_objects[part] && _objects[part]->isUFODoor() && _currentFrame[part] != 0);
 	}
 
+	/**
+	 * Check if the ufo door has only just started opening. It becomes cheaper
+	 * to walk through as it animates further.
+	 * @param part
+	 * @return bool
+	 */
+	bool isUfoDoorOpening(int part) const
+	{
+		return (_objects[part] && _objects[part]->isUFODoor() && _currentFrame[part] == 1);
+	}
+
 	/// Close ufo door.
 	int closeUfoDoor();
 	/// Sets the black fog of war status of this tile.
@@ -23,7 +23,9 @@
 #include "Engine/CrossPlatform.h"
 #include "Engine/Game.h"
 #include "Engine/Options.h"
+#include "Engine/Zoom.h"
 #include "Menu/StartState.h"
+#include "Battlescape/BattleBenchmark.h"
 
 /** @mainpage
  * @author OpenXcom Developers
@@ -48,6 +50,7 @@ int main(int argc, char *argv[])
 {
 	// Uncomment to check memory leaks in VS
 	//_CrtSetDbgFlag ( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
+	bool benchmark = false;
 
 #ifndef _DEBUG
 	try
@@ -58,14 +61,33 @@ int main(int argc, char *argv[])
 #endif
 		if (!Options::init(argc, argv))
 			return EXIT_SUCCESS;
+		benchmark = !Options::getBenchmarkFile().empty() || Options::getScalerBenchmarkFrames() > 0;
+		if (benchmark)
+		{
+			// nothing is shown or heard, so don't open a window or the sound card
+			SDL_putenv((char*)"SDL_VIDEODRIVER=dummy");
+			SDL_putenv((char*)"SDL_AUDIODRIVER=dummy");
+			Options::useOpenGL = false;
+		}
 		std::ostringstream title;
 		title << "OpenXcom " << OPENXCOM_VERSION_SHORT << OPENXCOM_VERSION_GIT;
 		Options::baseXResolution = Options::displayWidth;
 		Options::baseYResolution = Options::displayHeight;
 		game = new Game(title.str());
 		State::setGamePtr(game);
-		game->setState(new StartState);
-		game->run();
+		if (Options::getScalerBenchmarkFrames() > 0)
+		{
+			Zoom::benchmark(Options::getScalerBenchmarkFrames());
+		}
+		else if (benchmark)
+		{
+			BattleBenchmark(game).run(Options::getBenchmarkFile(), Options::getBenchmarkTurns(), Options::getBenchmarkSeed());
+		}
+		else
+		{
+			game->setState(new StartState);
+			game->run();
+		}
 #ifndef _DEBUG
 	}
 	catch (std::exception &e)
@@ -74,7 +96,9 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 #endif
-	Options::save();
+	// the benchmark changed the display options for itself
+	if (!benchmark)
+		Options::save();
 
 	// Comment this for faster exit.
 	delete game;
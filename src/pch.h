@@ -118,7 +118,6 @@
 #include "./Engine/Language.h"
 #include "./Engine/ShaderDrawHelper.h"
 #include "./dirent.h"
-#include "./Battlescape/PathfindingNode.h"
 #include "./Battlescape/PrimeGrenadeState.h"
 #include "./Battlescape/UnitInfoState.h"
 #include "./Battlescape/MedikitState.h"